@@ -136,136 +136,257 @@ rsvg_start_style (RsvgHandle * ctx, RsvgPropertyBag * atts)
 }
 
 
+/* Sorted by name for binary search. The elements handled by
+   rsvg_start_element itself never create a node, so they map to
+   RSVG_NODE_TYPE_INVALID and their end tags cannot pop one. */
+static const struct {
+    const char *name;
+    RsvgNodeType type;
+} rsvg_node_types[] = {
+    {"a", RSVG_NODE_TYPE_GROUP},
+    {"circle", RSVG_NODE_TYPE_CIRCLE},
+    {"clipPath", RSVG_NODE_TYPE_CLIP_PATH},
+    {"conicalGradient", RSVG_NODE_TYPE_CONICAL_GRADIENT},
+    {"defs", RSVG_NODE_TYPE_DEFS},
+    {"desc", RSVG_NODE_TYPE_INVALID},
+    {"ellipse", RSVG_NODE_TYPE_ELLIPSE},
+    {"feBlend", RSVG_NODE_TYPE_FILTER_PRIMITIVE_BLEND},
+    {"feColorMatrix", RSVG_NODE_TYPE_FILTER_PRIMITIVE_COLOUR_MATRIX},
+    {"feComponentTransfer", RSVG_NODE_TYPE_FILTER_PRIMITIVE_COMPONENT_TRANSFER},
+    {"feComposite", RSVG_NODE_TYPE_FILTER_PRIMITIVE_COMPOSITE},
+    {"feConvolveMatrix", RSVG_NODE_TYPE_FILTER_PRIMITIVE_CONVOLVE_MATRIX},
+    {"feDiffuseLighting", RSVG_NODE_TYPE_FILTER_PRIMITIVE_DIFFUSE_LIGHTING},
+    {"feDisplacementMap", RSVG_NODE_TYPE_FILTER_PRIMITIVE_DISPLACEMENT_MAP},
+    {"feDistantLight", RSVG_NODE_TYPE_LIGHT_SOURCE},
+    {"feFlood", RSVG_NODE_TYPE_FILTER_PRIMITIVE_FLOOD},
+    {"feFuncA", RSVG_NODE_TYPE_COMPONENT_TRANSFER_FUNCTION_A},
+    {"feFuncB", RSVG_NODE_TYPE_COMPONENT_TRANSFER_FUNCTION_B},
+    {"feFuncG", RSVG_NODE_TYPE_COMPONENT_TRANSFER_FUNCTION_G},
+    {"feFuncR", RSVG_NODE_TYPE_COMPONENT_TRANSFER_FUNCTION_R},
+    {"feGaussianBlur", RSVG_NODE_TYPE_FILTER_PRIMITIVE_GAUSSIAN_BLUR},
+    {"feImage", RSVG_NODE_TYPE_FILTER_PRIMITIVE_IMAGE},
+    {"feMerge", RSVG_NODE_TYPE_FILTER_PRIMITIVE_MERGE},
+    {"feMergeNode", RSVG_NODE_TYPE_FILTER_PRIMITIVE_MERGE_NODE},
+    {"feMorphology", RSVG_NODE_TYPE_FILTER_PRIMITIVE_ERODE},
+    {"feOffset", RSVG_NODE_TYPE_FILTER_PRIMITIVE_OFFSET},
+    {"fePointLight", RSVG_NODE_TYPE_LIGHT_SOURCE},
+    {"feSpecularLighting", RSVG_NODE_TYPE_FILTER_PRIMITIVE_SPECULAR_LIGHTING},
+    {"feSpotLight", RSVG_NODE_TYPE_LIGHT_SOURCE},
+    {"feTile", RSVG_NODE_TYPE_FILTER_PRIMITIVE_TILE},
+    {"feTurbulence", RSVG_NODE_TYPE_FILTER_PRIMITIVE_TURBULENCE},
+    {"filter", RSVG_NODE_TYPE_FILTER},
+    {"g", RSVG_NODE_TYPE_GROUP},
+    {"image", RSVG_NODE_TYPE_IMAGE},
+    {"include", RSVG_NODE_TYPE_INVALID},
+    {"line", RSVG_NODE_TYPE_LINE},
+    {"linearGradient", RSVG_NODE_TYPE_LINEAR_GRADIENT},
+    {"marker", RSVG_NODE_TYPE_MARKER},
+    {"mask", RSVG_NODE_TYPE_MASK},
+    {"metadata", RSVG_NODE_TYPE_INVALID},
+    {"multiImage", RSVG_NODE_TYPE_SWITCH},
+    {"path", RSVG_NODE_TYPE_PATH},
+    {"pattern", RSVG_NODE_TYPE_PATTERN},
+    {"polygon", RSVG_NODE_TYPE_POLYGON},
+    {"polyline", RSVG_NODE_TYPE_POLYLINE},
+    {"radialGradient", RSVG_NODE_TYPE_RADIAL_GRADIENT},
+    {"rect", RSVG_NODE_TYPE_RECT},
+    {"stop", RSVG_NODE_TYPE_STOP},
+    {"style", RSVG_NODE_TYPE_INVALID},
+    {"subImage", RSVG_NODE_TYPE_GROUP},
+    {"subImageRef", RSVG_NODE_TYPE_IMAGE},
+    {"svg", RSVG_NODE_TYPE_SVG},
+    {"switch", RSVG_NODE_TYPE_SWITCH},
+    {"symbol", RSVG_NODE_TYPE_SYMBOL},
+    {"text", RSVG_NODE_TYPE_TEXT},
+    {"title", RSVG_NODE_TYPE_INVALID},
+    {"tref", RSVG_NODE_TYPE_TREF},
+    {"tspan", RSVG_NODE_TYPE_TSPAN},
+    {"use", RSVG_NODE_TYPE_USE},
+};
+
+static RsvgNodeType
+rsvg_node_type_from_name (const char *name)
+{
+    gint lo = 0, hi = G_N_ELEMENTS (rsvg_node_types);
+
+    while (lo < hi) {
+        gint mid = (lo + hi) / 2;
+        int cmp = strcmp (name, rsvg_node_types[mid].name);
+
+        if (cmp == 0)
+            return rsvg_node_types[mid].type;
+        if (cmp < 0)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+
+    return RSVG_NODE_TYPE_UNKNOWN;
+}
+
 static void
 rsvg_standard_element_start (RsvgHandle * ctx, const char *name, RsvgPropertyBag * atts)
 {
-
-    /*replace this stuff with a hash for fast reading! */
+    RsvgNodeType type = rsvg_node_type_from_name (name);
+    RsvgArena *arena = ctx->priv->arena;
     RsvgNode *newnode = NULL;
-    if (!strcmp (name, "g"))
-        newnode = rsvg_new_group ();
-    else if (!strcmp (name, "a"))       /*treat anchors as groups for now */
-        newnode = rsvg_new_group ();
-    else if (!strcmp (name, "switch"))
-        newnode = rsvg_new_switch ();
-    else if (!strcmp (name, "defs"))
-        newnode = rsvg_new_defs ();
-    else if (!strcmp (name, "use"))
-        newnode = rsvg_new_use ();
-    else if (!strcmp (name, "path"))
-        newnode = rsvg_new_path ();
-    else if (!strcmp (name, "line"))
-        newnode = rsvg_new_line ();
-    else if (!strcmp (name, "rect"))
-        newnode = rsvg_new_rect ();
-    else if (!strcmp (name, "ellipse"))
-        newnode = rsvg_new_ellipse ();
-    else if (!strcmp (name, "circle"))
-        newnode = rsvg_new_circle ();
-    else if (!strcmp (name, "polygon"))
-        newnode = rsvg_new_polygon ();
-    else if (!strcmp (name, "polyline"))
-        newnode = rsvg_new_polyline ();
-    else if (!strcmp (name, "symbol"))
-        newnode = rsvg_new_symbol ();
-    else if (!strcmp (name, "svg"))
-        newnode = rsvg_new_svg ();
-    else if (!strcmp (name, "mask"))
-        newnode = rsvg_new_mask ();
-    else if (!strcmp (name, "clipPath"))
-        newnode = rsvg_new_clip_path ();
-    else if (!strcmp (name, "image"))
-        newnode = rsvg_new_image ();
-    else if (!strcmp (name, "marker"))
-        newnode = rsvg_new_marker ();
-    else if (!strcmp (name, "stop"))
-        newnode = rsvg_new_stop ();
-    else if (!strcmp (name, "pattern"))
-        newnode = rsvg_new_pattern ();
-    else if (!strcmp (name, "linearGradient"))
-        newnode = rsvg_new_linear_gradient ();
-    else if (!strcmp (name, "radialGradient"))
-        newnode = rsvg_new_radial_gradient ();
-    else if (!strcmp (name, "conicalGradient"))
-        newnode = rsvg_new_radial_gradient ();
-    else if (!strcmp (name, "filter"))
-        newnode = rsvg_new_filter ();
-    else if (!strcmp (name, "feBlend"))
-        newnode = rsvg_new_filter_primitive_blend ();
-    else if (!strcmp (name, "feColorMatrix"))
-        newnode = rsvg_new_filter_primitive_colour_matrix ();
-    else if (!strcmp (name, "feComponentTransfer"))
-        newnode = rsvg_new_filter_primitive_component_transfer ();
-    else if (!strcmp (name, "feComposite"))
-        newnode = rsvg_new_filter_primitive_composite ();
-    else if (!strcmp (name, "feConvolveMatrix"))
-        newnode = rsvg_new_filter_primitive_convolve_matrix ();
-    else if (!strcmp (name, "feDiffuseLighting"))
-        newnode = rsvg_new_filter_primitive_diffuse_lighting ();
-    else if (!strcmp (name, "feDisplacementMap"))
-        newnode = rsvg_new_filter_primitive_displacement_map ();
-    else if (!strcmp (name, "feFlood"))
-        newnode = rsvg_new_filter_primitive_flood ();
-    else if (!strcmp (name, "feGaussianBlur"))
-        newnode = rsvg_new_filter_primitive_gaussian_blur ();
-    else if (!strcmp (name, "feImage"))
-        newnode = rsvg_new_filter_primitive_image ();
-    else if (!strcmp (name, "feMerge"))
-        newnode = rsvg_new_filter_primitive_merge ();
-    else if (!strcmp (name, "feMorphology"))
-        newnode = rsvg_new_filter_primitive_erode ();
-    else if (!strcmp (name, "feOffset"))
-        newnode = rsvg_new_filter_primitive_offset ();
-    else if (!strcmp (name, "feSpecularLighting"))
-        newnode = rsvg_new_filter_primitive_specular_lighting ();
-    else if (!strcmp (name, "feTile"))
-        newnode = rsvg_new_filter_primitive_tile ();
-    else if (!strcmp (name, "feTurbulence"))
-        newnode = rsvg_new_filter_primitive_turbulence ();
-    else if (!strcmp (name, "feMergeNode"))
-        newnode = rsvg_new_filter_primitive_merge_node ();
-    else if (!strcmp (name, "feFuncR"))
-        newnode = rsvg_new_node_component_transfer_function ('r');
-    else if (!strcmp (name, "feFuncG"))
-        newnode = rsvg_new_node_component_transfer_function ('g');
-    else if (!strcmp (name, "feFuncB"))
-        newnode = rsvg_new_node_component_transfer_function ('b');
-    else if (!strcmp (name, "feFuncA"))
-        newnode = rsvg_new_node_component_transfer_function ('a');
-    else if (!strcmp (name, "feDistantLight"))
-        newnode = rsvg_new_filter_primitive_light_source ('d');
-    else if (!strcmp (name, "feSpotLight"))
-        newnode = rsvg_new_filter_primitive_light_source ('s');
-    else if (!strcmp (name, "fePointLight"))
-        newnode = rsvg_new_filter_primitive_light_source ('p');
-    /* hack to make multiImage sort-of work */
-    else if (!strcmp (name, "multiImage"))
-        newnode = rsvg_new_switch ();
-    else if (!strcmp (name, "subImageRef"))
-        newnode = rsvg_new_image ();
-    else if (!strcmp (name, "subImage"))
-        newnode = rsvg_new_group ();
-    else if (!strcmp (name, "text"))
-        newnode = rsvg_new_text ();
-    else if (!strcmp (name, "tspan"))
-        newnode = rsvg_new_tspan ();
-    else if (!strcmp (name, "tref"))
-        newnode = rsvg_new_tref ();
-	else {
-		/* hack for bug 401115. whenever we encounter a node we don't understand, push it into a group. 
-		   this will allow us to handle things like conditionals properly. */
-		newnode = rsvg_new_group ();
-	}
+
+    switch (type) {
+    case RSVG_NODE_TYPE_GROUP: /* g, and a and subImage are treated as groups for now */
+        newnode = rsvg_new_group (arena);
+        break;
+    case RSVG_NODE_TYPE_SWITCH: /* switch, and multiImage to make it sort-of work */
+        newnode = rsvg_new_switch (arena);
+        break;
+    case RSVG_NODE_TYPE_DEFS:
+        newnode = rsvg_new_defs (arena);
+        break;
+    case RSVG_NODE_TYPE_USE:
+        newnode = rsvg_new_use (arena);
+        break;
+    case RSVG_NODE_TYPE_PATH:
+        newnode = rsvg_new_path (arena);
+        break;
+    case RSVG_NODE_TYPE_LINE:
+        newnode = rsvg_new_line (arena);
+        break;
+    case RSVG_NODE_TYPE_RECT:
+        newnode = rsvg_new_rect (arena);
+        break;
+    case RSVG_NODE_TYPE_ELLIPSE:
+        newnode = rsvg_new_ellipse (arena);
+        break;
+    case RSVG_NODE_TYPE_CIRCLE:
+        newnode = rsvg_new_circle (arena);
+        break;
+    case RSVG_NODE_TYPE_POLYGON:
+        newnode = rsvg_new_polygon (arena);
+        break;
+    case RSVG_NODE_TYPE_POLYLINE:
+        newnode = rsvg_new_polyline (arena);
+        break;
+    case RSVG_NODE_TYPE_SYMBOL:
+        newnode = rsvg_new_symbol (arena);
+        break;
+    case RSVG_NODE_TYPE_SVG:
+        newnode = rsvg_new_svg (arena);
+        break;
+    case RSVG_NODE_TYPE_MASK:
+        newnode = rsvg_new_mask (arena);
+        break;
+    case RSVG_NODE_TYPE_CLIP_PATH:
+        newnode = rsvg_new_clip_path (arena);
+        break;
+    case RSVG_NODE_TYPE_IMAGE:  /* image and subImageRef */
+        newnode = rsvg_new_image (arena);
+        break;
+    case RSVG_NODE_TYPE_MARKER:
+        newnode = rsvg_new_marker (arena);
+        break;
+    case RSVG_NODE_TYPE_STOP:
+        newnode = rsvg_new_stop (arena);
+        break;
+    case RSVG_NODE_TYPE_PATTERN:
+        newnode = rsvg_new_pattern (arena);
+        break;
+    case RSVG_NODE_TYPE_LINEAR_GRADIENT:
+        newnode = rsvg_new_linear_gradient (arena);
+        break;
+    case RSVG_NODE_TYPE_RADIAL_GRADIENT:
+    case RSVG_NODE_TYPE_CONICAL_GRADIENT:
+        newnode = rsvg_new_radial_gradient (arena);
+        break;
+    case RSVG_NODE_TYPE_FILTER:
+        newnode = rsvg_new_filter (arena);
+        break;
+    case RSVG_NODE_TYPE_FILTER_PRIMITIVE_BLEND:
+        newnode = rsvg_new_filter_primitive_blend (arena);
+        break;
+    case RSVG_NODE_TYPE_FILTER_PRIMITIVE_COLOUR_MATRIX:
+        newnode = rsvg_new_filter_primitive_colour_matrix (arena);
+        break;
+    case RSVG_NODE_TYPE_FILTER_PRIMITIVE_COMPONENT_TRANSFER:
+        newnode = rsvg_new_filter_primitive_component_transfer (arena);
+        break;
+    case RSVG_NODE_TYPE_FILTER_PRIMITIVE_COMPOSITE:
+        newnode = rsvg_new_filter_primitive_composite (arena);
+        break;
+    case RSVG_NODE_TYPE_FILTER_PRIMITIVE_CONVOLVE_MATRIX:
+        newnode = rsvg_new_filter_primitive_convolve_matrix (arena);
+        break;
+    case RSVG_NODE_TYPE_FILTER_PRIMITIVE_DIFFUSE_LIGHTING:
+        newnode = rsvg_new_filter_primitive_diffuse_lighting (arena);
+        break;
+    case RSVG_NODE_TYPE_FILTER_PRIMITIVE_DISPLACEMENT_MAP:
+        newnode = rsvg_new_filter_primitive_displacement_map (arena);
+        break;
+    case RSVG_NODE_TYPE_FILTER_PRIMITIVE_FLOOD:
+        newnode = rsvg_new_filter_primitive_flood (arena);
+        break;
+    case RSVG_NODE_TYPE_FILTER_PRIMITIVE_GAUSSIAN_BLUR:
+        newnode = rsvg_new_filter_primitive_gaussian_blur (arena);
+        break;
+    case RSVG_NODE_TYPE_FILTER_PRIMITIVE_IMAGE:
+        newnode = rsvg_new_filter_primitive_image (arena);
+        break;
+    case RSVG_NODE_TYPE_FILTER_PRIMITIVE_MERGE:
+        newnode = rsvg_new_filter_primitive_merge (arena);
+        break;
+    case RSVG_NODE_TYPE_FILTER_PRIMITIVE_ERODE:
+        newnode = rsvg_new_filter_primitive_erode (arena);
+        break;
+    case RSVG_NODE_TYPE_FILTER_PRIMITIVE_OFFSET:
+        newnode = rsvg_new_filter_primitive_offset (arena);
+        break;
+    case RSVG_NODE_TYPE_FILTER_PRIMITIVE_SPECULAR_LIGHTING:
+        newnode = rsvg_new_filter_primitive_specular_lighting (arena);
+        break;
+    case RSVG_NODE_TYPE_FILTER_PRIMITIVE_TILE:
+        newnode = rsvg_new_filter_primitive_tile (arena);
+        break;
+    case RSVG_NODE_TYPE_FILTER_PRIMITIVE_TURBULENCE:
+        newnode = rsvg_new_filter_primitive_turbulence (arena);
+        break;
+    case RSVG_NODE_TYPE_FILTER_PRIMITIVE_MERGE_NODE:
+        newnode = rsvg_new_filter_primitive_merge_node (arena);
+        break;
+    case RSVG_NODE_TYPE_COMPONENT_TRANSFER_FUNCTION_R:
+    case RSVG_NODE_TYPE_COMPONENT_TRANSFER_FUNCTION_G:
+    case RSVG_NODE_TYPE_COMPONENT_TRANSFER_FUNCTION_B:
+    case RSVG_NODE_TYPE_COMPONENT_TRANSFER_FUNCTION_A:
+        newnode = rsvg_new_node_component_transfer_function
+            (arena, "rgba"[type - RSVG_NODE_TYPE_COMPONENT_TRANSFER_FUNCTION_R]);
+        break;
+    case RSVG_NODE_TYPE_LIGHT_SOURCE:
+        /* 'd', 's' or 'p' from feDistantLight, feSpotLight or fePointLight */
+        newnode = rsvg_new_filter_primitive_light_source (arena, g_ascii_tolower (name[2]));
+        break;
+    case RSVG_NODE_TYPE_TEXT:
+        newnode = rsvg_new_text (arena);
+        break;
+    case RSVG_NODE_TYPE_TSPAN:
+        newnode = rsvg_new_tspan (arena);
+        break;
+    case RSVG_NODE_TYPE_TREF:
+        newnode = rsvg_new_tref (arena);
+        break;
+    default:
+        /* hack for bug 401115. whenever we encounter a node we don't understand, push it into a group. 
+           this will allow us to handle things like conditionals properly. */
+        type = RSVG_NODE_TYPE_UNKNOWN;
+        newnode = rsvg_new_group (arena);
+        break;
+    }
 
     if (newnode) {
-        newnode->type = g_string_new (name);
+        newnode->type = type;
 	newnode->parent = ctx->priv->currentnode;
         rsvg_node_set_atts (newnode, ctx, atts);
         rsvg_defs_register_memory (ctx->priv->defs, newnode);
         if (ctx->priv->currentnode) {
             rsvg_node_group_pack (ctx->priv->currentnode, newnode);
             ctx->priv->currentnode = newnode;
-        } else if (!strcmp (name, "svg")) {
+        } else if (type == RSVG_NODE_TYPE_SVG) {
             ctx->priv->treebase = newnode;
             ctx->priv->currentnode = newnode;
         }
@@ -682,7 +803,7 @@ rsvg_end_element (void *data, const xmlChar * name)
         }
 
         if (ctx->priv->currentnode
-            && !strcmp ((const char *) name, ctx->priv->currentnode->type->str))
+            && rsvg_node_type_from_name ((const char *) name) == ctx->priv->currentnode->type)
             rsvg_pop_def_group (ctx);
 
     }
@@ -706,8 +827,8 @@ rsvg_characters_impl (RsvgHandle * ctx, const xmlChar * ch, int len)
 
 	if (ctx->priv->currentnode)
 		{
-			if (!strcmp ("tspan", ctx->priv->currentnode->type->str) ||
-				!strcmp ("text", ctx->priv->currentnode->type->str))
+			if (ctx->priv->currentnode->type == RSVG_NODE_TYPE_TSPAN ||
+				ctx->priv->currentnode->type == RSVG_NODE_TYPE_TEXT)
 				{
 					guint i;
 
@@ -716,7 +837,7 @@ rsvg_characters_impl (RsvgHandle * ctx, const xmlChar * ch, int len)
 					self = NULL;
 					for (i = 0; i < ctx->priv->currentnode->children->len; i++) {
 						RsvgNode *node = g_ptr_array_index (ctx->priv->currentnode->children, i);
-						if (!strcmp (node->type->str, "RSVG_NODE_CHARS")) {
+						if (node->type == RSVG_NODE_TYPE_CHARS) {
 							self = (RsvgNodeChars*)node;
 						}
 					}
@@ -736,8 +857,8 @@ rsvg_characters_impl (RsvgHandle * ctx, const xmlChar * ch, int len)
 				}
 		}
 
-    self = g_new (RsvgNodeChars, 1);
-    _rsvg_node_init (&self->super);
+    self = _rsvg_node_new (RsvgNodeChars, ctx->priv->arena);
+    _rsvg_node_init (&self->super, ctx->priv->arena);
 
     if (!g_utf8_validate ((char *) ch, len, NULL)) {
         char *utf8;
@@ -747,8 +868,7 @@ rsvg_characters_impl (RsvgHandle * ctx, const xmlChar * ch, int len)
     } else {
         self->contents = g_string_new_len ((char *) ch, len);
     }
-
-    self->super.type = g_string_new ("RSVG_NODE_CHARS");
+    self->super.type = RSVG_NODE_TYPE_CHARS;
     self->super.free = _rsvg_node_chars_free;
     self->super.state->cond_true = FALSE;
 
@@ -1100,6 +1220,7 @@ rsvg_handle_close_impl (RsvgHandle * handle, GError ** error)
     }
 
     rsvg_defs_resolve_all (handle->priv->defs);
+    rsvg_node_break_use_cycles ((RsvgNode *) handle->priv->treebase);
     handle->priv->finished = TRUE;
     handle->priv->error = NULL;
 
@@ -1111,29 +1232,30 @@ rsvg_handle_close_impl (RsvgHandle * handle, GError ** error)
     return TRUE;
 }
 
-static void
-rsvg_state_free_func (gpointer data, gpointer user_data)
-{
-    rsvg_state_finalize ((RsvgState *) data);
-    g_slice_free (RsvgState, data);
-}
-
 void
 rsvg_drawing_ctx_free (RsvgDrawingCtx * handle)
 {
+    /* the layouts hold on to the render's pango context */
+    if (handle->layout_cache)
+        g_hash_table_destroy (handle->layout_cache);
+
     rsvg_render_free (handle->render);
 
-    g_slist_foreach (handle->state, rsvg_state_free_func, (gpointer) handle);
-    g_slist_free (handle->state);
+    rsvg_state_stack_free (handle);
 
 	/* the drawsub stack's nodes are owned by the ->defs */
 	g_slist_free (handle->drawsub_stack);
 
+    if (handle->marker_cache)
+        g_hash_table_destroy (handle->marker_cache);
+    if (handle->use_cache)
+        g_hash_table_destroy (handle->use_cache);
+
     if (handle->base_uri)
         g_free (handle->base_uri);
 
     if (handle->pango_context != NULL)
-        g_object_unref (handle->pango_context);
+        rsvg_text_pango_context_release (handle->pango_context);
 
     g_free (handle);
 }
@@ -1293,6 +1415,7 @@ rsvg_bbox_render_new ()
     render->super.push_discrete_layer = rsvg_bbox_push_discrete_layer;
     render->super.add_clipping_rect = rsvg_bbox_add_clipping_rect;
     render->super.get_image_of_node = NULL;
+    render->super.get_background = NULL;
     _rsvg_affine_identity (affine);
     rsvg_bbox_init (&render->bbox, affine);
 
@@ -1306,9 +1429,13 @@ _rsvg_find_bbox (RsvgHandle * handle)
     RsvgBbox output;
     RsvgBboxRender *render = rsvg_bbox_render_new ();
     ctx->drawsub_stack = NULL;
+    ctx->marker_cache = NULL;
+    ctx->use_cache = NULL;
+    ctx->layout_cache = NULL;
     ctx->render = (RsvgRender *) render;
 
     ctx->state = NULL;
+    ctx->n_states = 0;
 
     ctx->defs = handle->priv->defs;
     ctx->base_uri = g_strdup (handle->priv->base_uri);
@@ -1324,11 +1451,223 @@ _rsvg_find_bbox (RsvgHandle * handle)
     rsvg_state_pop (ctx);
 
     output = render->bbox;
+    if (ctx->layout_cache)
+        g_hash_table_destroy (ctx->layout_cache);
     rsvg_render_free (ctx->render);
+    if (ctx->marker_cache)
+        g_hash_table_destroy (ctx->marker_cache);
+    if (ctx->use_cache)
+        g_hash_table_destroy (ctx->use_cache);
+    if (ctx->pango_context != NULL)
+        rsvg_text_pango_context_release (ctx->pango_context);
     g_free (ctx);
     return output;
 }
 
+/* A recording captures what a subtree draws as a list of render_path
+   calls, each with the state it was drawn with, so it can be drawn again
+   under another transform without walking the tree.  Recordings are only
+   replayable when everything drawn was a plain path: images, text,
+   clipping rectangles and layers that do more than save and restore
+   (opacity, filter, mask, clip-path, comp-op, enable-background) spoil
+   them.  A recording can also pass everything on to the render it
+   replaced, so the subtree is drawn while it is recorded. */
+
+typedef struct {
+    RsvgState state;
+    RsvgBpathDef *bpath;
+} RsvgRecordedPath;
+
+struct _RsvgRecording {
+    RsvgRender super;
+    RsvgRender *parent;
+    gboolean draw;              /* pass every call on to parent */
+    gboolean replayable;
+    GArray *paths;              /* RsvgRecordedPath, in drawing order */
+};
+
+/* Hand the rest of a call to the render the recording replaced */
+#define RSVG_RECORDING_DRAW(ctx, recording, call) G_STMT_START {   \
+    if ((recording)->draw) {                                        \
+        (ctx)->render = (recording)->parent;                        \
+        (ctx)->render->call;                                        \
+        (ctx)->render = &(recording)->super;                        \
+    }                                                               \
+} G_STMT_END
+
+static void
+rsvg_recording_render_path (RsvgDrawingCtx * ctx, const RsvgBpathDef * bpath_def)
+{
+    RsvgRecording *recording = (RsvgRecording *) ctx->render;
+    RsvgRecordedPath path;
+
+    if (recording->replayable) {
+        rsvg_state_init (&path.state);
+        rsvg_state_clone (&path.state, rsvg_state_current (ctx));
+
+        path.bpath = g_new (RsvgBpathDef, 1);
+        path.bpath->n_bpath = path.bpath->n_bpath_max = bpath_def->n_bpath;
+        path.bpath->moveto_idx = bpath_def->moveto_idx;
+        path.bpath->bpath = g_memdup (bpath_def->bpath, bpath_def->n_bpath * sizeof (RsvgBpath));
+
+        g_array_append_val (recording->paths, path);
+    }
+
+    RSVG_RECORDING_DRAW (ctx, recording, render_path (ctx, bpath_def));
+}
+
+static void
+rsvg_recording_render_image (RsvgDrawingCtx * ctx, const GdkPixbuf * pixbuf,
+                             double x, double y, double w, double h)
+{
+    RsvgRecording *recording = (RsvgRecording *) ctx->render;
+
+    recording->replayable = FALSE;
+    RSVG_RECORDING_DRAW (ctx, recording, render_image (ctx, pixbuf, x, y, w, h));
+}
+
+/* Only layers that the cairo backend turns into a bare save/restore can be
+   left out of the recording */
+static void
+rsvg_recording_push_discrete_layer (RsvgDrawingCtx * ctx)
+{
+    RsvgRecording *recording = (RsvgRecording *) ctx->render;
+    RsvgState *state = rsvg_state_current (ctx);
+
+    if (state->opacity != 0xff || state->filter || state->mask || state->clip_path_ref
+        || state->comp_op != RSVG_COMP_OP_SRC_OVER
+        || state->enable_background != RSVG_ENABLE_BACKGROUND_ACCUMULATE)
+        recording->replayable = FALSE;
+    RSVG_RECORDING_DRAW (ctx, recording, push_discrete_layer (ctx));
+}
+
+static void
+rsvg_recording_pop_discrete_layer (RsvgDrawingCtx * ctx)
+{
+    RsvgRecording *recording = (RsvgRecording *) ctx->render;
+
+    RSVG_RECORDING_DRAW (ctx, recording, pop_discrete_layer (ctx));
+}
+
+static void
+rsvg_recording_add_clipping_rect (RsvgDrawingCtx * ctx, double x, double y, double w, double h)
+{
+    RsvgRecording *recording = (RsvgRecording *) ctx->render;
+
+    recording->replayable = FALSE;
+    RSVG_RECORDING_DRAW (ctx, recording, add_clipping_rect (ctx, x, y, w, h));
+}
+
+static PangoContext *
+rsvg_recording_create_pango_context (RsvgDrawingCtx * ctx)
+{
+    RsvgRecording *recording = (RsvgRecording *) ctx->render;
+    PangoContext *context;
+
+    recording->replayable = FALSE;
+
+    ctx->render = recording->parent;
+    context = ctx->render->create_pango_context (ctx);
+    ctx->render = &recording->super;
+
+    return context;
+}
+
+static void
+rsvg_recording_render_pango_layout (RsvgDrawingCtx * ctx, PangoLayout * layout,
+                                    double x, double y)
+{
+    RsvgRecording *recording = (RsvgRecording *) ctx->render;
+
+    recording->replayable = FALSE;
+    RSVG_RECORDING_DRAW (ctx, recording, render_pango_layout (ctx, layout, x, y));
+}
+
+/**
+ * rsvg_recording_new: Starts recording what @ctx draws.
+ * @ctx: the drawing context; its render is swapped out until
+ * rsvg_recording_finish is called
+ * @draw: whether to draw on the replaced render as well, rather than
+ * only record
+ *
+ * Text goes through pango exactly when the render being replaced supports
+ * it, so callers should only replay a recording on a render that agrees.
+ **/
+RsvgRecording *
+rsvg_recording_new (RsvgDrawingCtx * ctx, gboolean draw)
+{
+    RsvgRecording *recording = g_new0 (RsvgRecording, 1);
+
+    recording->super.render_path = rsvg_recording_render_path;
+    recording->super.render_image = rsvg_recording_render_image;
+    recording->super.push_discrete_layer = rsvg_recording_push_discrete_layer;
+    recording->super.pop_discrete_layer = rsvg_recording_pop_discrete_layer;
+    recording->super.add_clipping_rect = rsvg_recording_add_clipping_rect;
+    if (ctx->render->create_pango_context)
+        recording->super.create_pango_context = rsvg_recording_create_pango_context;
+    if (ctx->render->render_pango_layout)
+        recording->super.render_pango_layout = rsvg_recording_render_pango_layout;
+
+    recording->parent = ctx->render;
+    recording->draw = draw;
+    recording->replayable = TRUE;
+    recording->paths = g_array_new (FALSE, FALSE, sizeof (RsvgRecordedPath));
+
+    ctx->render = &recording->super;
+    return recording;
+}
+
+void
+rsvg_recording_finish (RsvgDrawingCtx * ctx, RsvgRecording * recording)
+{
+    g_assert (ctx->render == &recording->super);
+    ctx->render = recording->parent;
+    recording->parent = NULL;
+}
+
+gboolean
+rsvg_recording_is_replayable (const RsvgRecording * recording)
+{
+    return recording->replayable;
+}
+
+/**
+ * rsvg_recording_replay: Draws a recording again.
+ * @affine: appended to the transform of every recorded path
+ **/
+void
+rsvg_recording_replay (RsvgDrawingCtx * ctx, const RsvgRecording * recording,
+                       const double affine[6])
+{
+    RsvgState *state;
+    guint i;
+
+    for (i = 0; i < recording->paths->len; i++) {
+        RsvgRecordedPath *path = &g_array_index (recording->paths, RsvgRecordedPath, i);
+
+        rsvg_state_push (ctx);
+        state = rsvg_state_current (ctx);
+        rsvg_state_clone (state, &path->state);
+        _rsvg_affine_multiply (state->affine, path->state.affine, affine);
+        ctx->render->render_path (ctx, path->bpath);
+        rsvg_state_pop (ctx);
+    }
+}
+
+void
+rsvg_recording_free (RsvgRecording * recording)
+{
+    guint i;
+
+    for (i = 0; i < recording->paths->len; i++) {
+        RsvgRecordedPath *path = &g_array_index (recording->paths, RsvgRecordedPath, i);
+        rsvg_state_finalize (&path->state);
+        rsvg_bpath_def_free (path->bpath);
+    }
+    g_array_free (recording->paths, TRUE);
+    g_free (recording);
+}
+
 /**
  * rsvg_handle_get_dimensions
  * @handle: A #RsvgHandle
@@ -1636,6 +1975,9 @@ rsvg_init (void)
 void
 rsvg_term (void)
 {
+    rsvg_extern_cache_clear ();
+    rsvg_text_font_maps_free ();
+
 #ifdef HAVE_SVGZ
     gsf_shutdown ();
 #endif
@@ -1670,12 +2012,18 @@ rsvg_render_path (RsvgDrawingCtx * ctx, const char *d)
     bpath_def = rsvg_parse_path (d);
     rsvg_bpath_def_art_finish (bpath_def);
 
-    ctx->render->render_path (ctx, bpath_def);
-    rsvg_render_markers (bpath_def, ctx);
+    rsvg_render_bpath (ctx, bpath_def);
 
     rsvg_bpath_def_free (bpath_def);
 }
 
+void
+rsvg_render_bpath (RsvgDrawingCtx * ctx, const RsvgBpathDef * bpath_def)
+{
+    ctx->render->render_path (ctx, bpath_def);
+    rsvg_render_markers (bpath_def, ctx);
+}
+
 void
 rsvg_render_image (RsvgDrawingCtx * ctx, GdkPixbuf * pb, double x, double y, double w, double h)
 {
@@ -1694,6 +2042,12 @@ rsvg_get_image_of_node (RsvgDrawingCtx * ctx, RsvgNode * drawable, double w, dou
     return ctx->render->get_image_of_node (ctx, drawable, w, h);
 }
 
+void
+rsvg_get_background (RsvgDrawingCtx * ctx, RsvgIRect region, GdkPixbuf * dest)
+{
+    ctx->render->get_background (ctx, region, dest);
+}
+
 void
 rsvg_render_free (RsvgRender * render)
 {
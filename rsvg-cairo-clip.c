@@ -30,6 +30,7 @@
 #include "rsvg-cairo-clip.h"
 #include "rsvg-cairo-render.h"
 #include "rsvg-styles.h"
+#include "rsvg-structure.h"
 #include "rsvg-bpath-util.h"
 #include "rsvg-path.h"
 
@@ -140,21 +141,238 @@ rsvg_cairo_clip_render_new (cairo_t * cr, RsvgCairoRender *parent)
     cairo_render->super.push_discrete_layer = rsvg_cairo_clip_push_discrete_layer;
     cairo_render->super.add_clipping_rect = rsvg_cairo_clip_add_clipping_rect;
     cairo_render->super.get_image_of_node = NULL;
+    cairo_render->super.get_background = NULL;
     cairo_render->cr = cr;
     cairo_render->parent = parent;
 
     return &cairo_render->super;
 }
 
+/* Geometry of a clip path as last applied, in device space.  The key holds
+ * everything drawing the clip path's children depends on; when it matches,
+ * the path is replayed instead of walking and re-parsing the children.
+ * Besides the transform, the children inherit the properties below from
+ * where the clip path is used; the font and text ones shape any text. */
+typedef struct {
+    double affine[6];
+    double bbox[4];
+    gint clip_rule;
+    gboolean visible;
+    RsvgLength font_size;
+    const char *font_family;    /* interned, compared by pointer */
+    const char *lang;           /* interned, compared by pointer */
+    PangoStyle font_style;
+    PangoVariant font_variant;
+    PangoWeight font_weight;
+    PangoStretch font_stretch;
+    PangoDirection text_dir;
+    UnicodeBidi unicode_bidi;
+    TextAnchor text_anchor;
+    RsvgLength letter_spacing;
+    gboolean space_preserve;
+    double vb_w, vb_h;
+} RsvgCairoClipKey;
+
+typedef struct {
+    RsvgCairoClipKey key;
+    cairo_matrix_t matrix;
+    cairo_fill_rule_t fill_rule;
+    gboolean is_rect;
+    double rect[4];
+    cairo_path_t *path;
+} RsvgCairoClipCache;
+
+static void
+rsvg_cairo_clip_cache_free (gpointer data)
+{
+    RsvgCairoClipCache *cache = data;
+
+    if (cache->path)
+        cairo_path_destroy (cache->path);
+    g_free (cache);
+}
+
+static gboolean
+rsvg_cairo_clip_key_equal (const RsvgCairoClipKey * a, const RsvgCairoClipKey * b)
+{
+    int i;
+
+    for (i = 0; i < 6; i++)
+        if (a->affine[i] != b->affine[i])
+            return FALSE;
+    for (i = 0; i < 4; i++)
+        if (a->bbox[i] != b->bbox[i])
+            return FALSE;
+    return a->clip_rule == b->clip_rule &&
+        a->visible == b->visible &&
+        a->font_size.length == b->font_size.length &&
+        a->font_size.factor == b->font_size.factor &&
+        a->font_family == b->font_family &&
+        a->lang == b->lang &&
+        a->font_style == b->font_style &&
+        a->font_variant == b->font_variant &&
+        a->font_weight == b->font_weight &&
+        a->font_stretch == b->font_stretch &&
+        a->text_dir == b->text_dir &&
+        a->unicode_bidi == b->unicode_bidi &&
+        a->text_anchor == b->text_anchor &&
+        a->letter_spacing.length == b->letter_spacing.length &&
+        a->letter_spacing.factor == b->letter_spacing.factor &&
+        a->space_preserve == b->space_preserve &&
+        a->vb_w == b->vb_w && a->vb_h == b->vb_h;
+}
+
+/* Recognise a path made of a single axis-aligned rectangle, which is then
+ * clipped with cairo_rectangle instead of a general path. */
+static gboolean
+rsvg_cairo_clip_path_is_rect (const cairo_path_t * path, double rect[4])
+{
+    double x[5], y[5];
+    int i, n = 0;
+
+    if (path->status != CAIRO_STATUS_SUCCESS)
+        return FALSE;
+
+    for (i = 0; i < path->num_data; i += path->data[i].header.length) {
+        const cairo_path_data_t *data = &path->data[i];
+
+        switch (data->header.type) {
+        case CAIRO_PATH_MOVE_TO:
+            if (n == 0) {
+                x[0] = data[1].point.x;
+                y[0] = data[1].point.y;
+                n = 1;
+            } else if (i + data->header.length < path->num_data)
+                return FALSE;   /* only the move_to cairo adds after a close may follow */
+            break;
+        case CAIRO_PATH_LINE_TO:
+            if (n == 0 || n == 5)
+                return FALSE;
+            x[n] = data[1].point.x;
+            y[n] = data[1].point.y;
+            n++;
+            break;
+        case CAIRO_PATH_CLOSE_PATH:
+            break;
+        default:
+            return FALSE;
+        }
+    }
+
+    if (n == 5 && (x[4] != x[0] || y[4] != y[0]))
+        return FALSE;
+    if (n < 4)
+        return FALSE;
+
+    if (!((y[0] == y[1] && x[1] == x[2] && y[2] == y[3] && x[3] == x[0]) ||
+          (x[0] == x[1] && y[1] == y[2] && x[2] == x[3] && y[3] == y[0])))
+        return FALSE;
+
+    rect[0] = MIN (x[0], x[2]);
+    rect[1] = MIN (y[0], y[2]);
+    rect[2] = fabs (x[2] - x[0]);
+    rect[3] = fabs (y[2] - y[0]);
+    return TRUE;
+}
+
+static void
+rsvg_cairo_clip_build_key (RsvgDrawingCtx * ctx, RsvgClipPath * clip, RsvgBbox * bbox,
+                           RsvgCairoClipKey * key)
+{
+    RsvgCairoRender *render = (RsvgCairoRender *) ctx->render;
+    RsvgState *state = rsvg_state_current (ctx);
+    gboolean nest = render->cr != render->initial_cr;
+    int i;
+
+    for (i = 0; i < 6; i++)
+        key->affine[i] = state->affine[i];
+    key->affine[4] += nest ? 0 : render->offset_x;
+    key->affine[5] += nest ? 0 : render->offset_y;
+
+    if (clip->units == objectBoundingBox) {
+        key->bbox[0] = bbox->x;
+        key->bbox[1] = bbox->y;
+        key->bbox[2] = bbox->w;
+        key->bbox[3] = bbox->h;
+    } else
+        key->bbox[0] = key->bbox[1] = key->bbox[2] = key->bbox[3] = 0;
+
+    key->clip_rule = state->clip_rule;
+    key->visible = state->visible;
+    key->font_size = state->font_size;
+    key->font_family = state->font_family;
+    key->lang = state->lang;
+    key->font_style = state->font_style;
+    key->font_variant = state->font_variant;
+    key->font_weight = state->font_weight;
+    key->font_stretch = state->font_stretch;
+    key->text_dir = state->text_dir;
+    key->unicode_bidi = state->unicode_bidi;
+    key->text_anchor = state->text_anchor;
+    key->letter_spacing = state->letter_spacing;
+    key->space_preserve = state->space_preserve;
+    key->vb_w = ctx->vb.w;
+    key->vb_h = ctx->vb.h;
+}
+
+static void
+rsvg_cairo_clip_replay (cairo_t * cr, const RsvgCairoClipCache * cache)
+{
+    cairo_identity_matrix (cr);
+    if (cache->is_rect)
+        cairo_rectangle (cr, cache->rect[0], cache->rect[1], cache->rect[2], cache->rect[3]);
+    else
+        cairo_append_path (cr, cache->path);
+    cairo_set_matrix (cr, &cache->matrix);
+    cairo_set_fill_rule (cr, cache->fill_rule);
+}
+
+static void
+rsvg_cairo_clip_record (cairo_t * cr, RsvgCairoClipCache * cache)
+{
+    cairo_get_matrix (cr, &cache->matrix);
+    cache->fill_rule = cairo_get_fill_rule (cr);
+
+    cairo_identity_matrix (cr);
+    cache->path = cairo_copy_path (cr);
+    cairo_set_matrix (cr, &cache->matrix);
+
+    cache->is_rect = rsvg_cairo_clip_path_is_rect (cache->path, cache->rect);
+    if (cache->is_rect || cache->path->status != CAIRO_STATUS_SUCCESS) {
+        cairo_path_destroy (cache->path);
+        cache->path = NULL;
+    }
+}
+
 void
 rsvg_cairo_clip (RsvgDrawingCtx * ctx, RsvgClipPath * clip, RsvgBbox * bbox)
 {
     RsvgCairoRender *save = (RsvgCairoRender *) ctx->render;
-    double affinesave[6];
-    int i;
+    RsvgCairoClipCache *cache = NULL;
+    RsvgCairoClipKey key;
+
+    /* Drawing a single subtree filters which children get drawn */
+    if (ctx->drawsub_stack == NULL) {
+        rsvg_cairo_clip_build_key (ctx, clip, bbox, &key);
+
+        if (save->clip_cache == NULL)
+            save->clip_cache = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                                      NULL, rsvg_cairo_clip_cache_free);
+        cache = g_hash_table_lookup (save->clip_cache, clip);
+        if (cache && (cache->is_rect || cache->path) &&
+            rsvg_cairo_clip_key_equal (&cache->key, &key)) {
+            cairo_new_path (save->cr);
+            rsvg_cairo_clip_replay (save->cr, cache);
+            cairo_clip (save->cr);
+            return;
+        }
+    }
+
     ctx->render = rsvg_cairo_clip_render_new (save->cr, save);
 
-    /* Horribly dirty hack to have the bbox premultiplied to everything */
+    cairo_new_path (save->cr);
+    rsvg_state_push (ctx);
+    /* objectBoundingBox units put the bbox under every child's transform */
     if (clip->units == objectBoundingBox) {
         double bbtransform[6];
         bbtransform[0] = bbox->w;
@@ -163,20 +381,25 @@ rsvg_cairo_clip (RsvgDrawingCtx * ctx, RsvgClipPath * clip, RsvgBbox * bbox)
         bbtransform[3] = bbox->h;
         bbtransform[4] = bbox->x;
         bbtransform[5] = bbox->y;
-        for (i = 0; i < 6; i++)
-            affinesave[i] = clip->super.state->affine[i];
-        _rsvg_affine_multiply (clip->super.state->affine, bbtransform, clip->super.state->affine);
-    }
-
-    rsvg_state_push (ctx);
-    _rsvg_node_draw_children ((RsvgNode *) clip, ctx, 0);
+        _rsvg_node_draw_children_under ((RsvgNode *) clip, ctx, bbtransform);
+    } else
+        _rsvg_node_draw_children ((RsvgNode *) clip, ctx, 0);
     rsvg_state_pop (ctx);
 
-    if (clip->units == objectBoundingBox)
-        for (i = 0; i < 6; i++)
-            clip->super.state->affine[i] = affinesave[i];
-
     g_free (ctx->render);
-    cairo_clip (save->cr);
     ctx->render = &save->super;
+
+    if (ctx->drawsub_stack == NULL) {
+        if (cache == NULL) {
+            cache = g_new0 (RsvgCairoClipCache, 1);
+            g_hash_table_insert (save->clip_cache, clip, cache);
+        } else if (cache->path) {
+            cairo_path_destroy (cache->path);
+            cache->path = NULL;
+        }
+        cache->key = key;
+        rsvg_cairo_clip_record (save->cr, cache);
+    }
+
+    cairo_clip (save->cr);
 }
@@ -35,6 +35,7 @@
 #include "rsvg-filter.h"
 #include "rsvg-structure.h"
 #include "rsvg-image.h"
+#include "rsvg-text.h"
 
 #include <math.h>
 #include <string.h>
@@ -144,7 +145,7 @@ _pattern_add_rsvg_color_stops (cairo_pattern_t * pattern,
 
     for (i = 0; i < stops->len; i++) {
         node = (RsvgNode *) g_ptr_array_index (stops, i);
-        if (strcmp (node->type->str, "stop"))
+        if (node->type != RSVG_NODE_TYPE_STOP)
             continue;
         stop = (RsvgGradientStop *) node;
         rgba = stop->rgba;
@@ -432,7 +433,7 @@ _set_source_rsvg_paint_server (RsvgDrawingCtx * ctx,
         _set_source_rsvg_radial_gradient (ctx, ps->core.radgrad, current_color_rgb, opacity, bbox);
         break;
     case RSVG_PAINT_SERVER_SOLID:
-        _set_source_rsvg_solid_colour (ctx, ps->core.colour, opacity, current_colour);
+        _set_source_rsvg_solid_colour (ctx, &ps->core.colour, opacity, current_colour);
         break;
     case RSVG_PAINT_SERVER_PATTERN:
         _set_source_rsvg_pattern (ctx, ps->core.pattern, opacity, bbox);
@@ -458,15 +459,19 @@ _set_rsvg_affine (RsvgCairoRender * render, const double affine[6])
 PangoContext *
 rsvg_cairo_create_pango_context (RsvgDrawingCtx * ctx)
 {
-    PangoFontMap *fontmap;
     PangoContext *context;
     RsvgCairoRender *render = (RsvgCairoRender *) ctx->render;
 
-    fontmap = pango_cairo_font_map_get_default ();
-    context = pango_cairo_font_map_create_context (PANGO_CAIRO_FONT_MAP (fontmap));
+    /* One context from the shared pool serves every text chunk of the
+     * render; only the target and its transformation need refreshing
+     * between chunks.  Like all pango calls, this runs with the text
+     * module's pango lock held. */
+    if (render->pango_context == NULL)
+        render->pango_context = rsvg_text_pango_context_acquire (ctx, TRUE);
+
+    context = render->pango_context;
     pango_cairo_update_context (render->cr, context);
-    pango_cairo_context_set_resolution (context, ctx->dpi_y);
-    return context;
+    return g_object_ref (context);
 }
 
 void
@@ -481,7 +486,9 @@ rsvg_cairo_render_pango_layout (RsvgDrawingCtx * ctx, PangoLayout * layout, doub
 
     _set_rsvg_affine (render, state->affine);
 
+    _rsvg_text_pango_lock ();
     pango_layout_get_extents (layout, &ink, NULL);
+    _rsvg_text_pango_unlock ();
 
     rsvg_bbox_init (&bbox, state->affine);
     bbox.x = x + ink.x / (double)PANGO_SCALE;
@@ -501,11 +508,15 @@ rsvg_cairo_render_pango_layout (RsvgDrawingCtx * ctx, PangoLayout * layout, doub
                                        state->fill_opacity,
                                        bbox, rsvg_state_current (ctx)->current_color);
 
+        _rsvg_text_pango_lock ();
         pango_cairo_show_layout (render->cr, layout);
+        _rsvg_text_pango_unlock ();
     }
 
     if (state->stroke) {
+        _rsvg_text_pango_lock ();
         pango_cairo_layout_path (render->cr, layout);
+        _rsvg_text_pango_unlock ();
 
         _set_source_rsvg_paint_server (ctx,
                                        state->current_color,
@@ -762,18 +773,34 @@ rsvg_cairo_render_image (RsvgDrawingCtx * ctx, const GdkPixbuf * pixbuf,
     rsvg_bbox_insert (&render->bbox, &bbox);
 }
 
+/**
+ * rsvg_cairo_generate_mask: Applies a mask to the current source.
+ * @cr: the context whose source is the masked content
+ * @self: the mask
+ * @ctx: the drawing context
+ * @bbox: the bounding box of the masked content
+ * @bounded: whether @bbox covers everything the content painted; filter
+ *           output can spill outside of it
+ *
+ * The mask is only rendered over the part of the canvas covered by both the
+ * mask region and the content, and its luminance is written straight into
+ * an A8 surface of that size.
+ **/
 static void
-rsvg_cairo_generate_mask (cairo_t * cr, RsvgMask * self, RsvgDrawingCtx * ctx, RsvgBbox * bbox)
+rsvg_cairo_generate_mask (cairo_t * cr, RsvgMask * self, RsvgDrawingCtx * ctx, RsvgBbox * bbox,
+                          gboolean bounded)
 {
-    cairo_surface_t *surface;
+    cairo_surface_t *surface, *alpha_surface;
     cairo_t *mask_cr, *save_cr;
     RsvgCairoRender *render = (RsvgCairoRender *) ctx->render;
     RsvgState *state = rsvg_state_current (ctx);
-    guint8 *pixels;
-    guint32 width = render->width, height = render->height;
-    guint32 rowstride = width * 4, row, i;
-    double affinesave[6];
+    guint8 *pixels, *alpha_pixels;
+    guint32 width, height;
+    guint32 rowstride, alpha_rowstride, row, i;
+    gint x0, y0, x1, y1;
+    double identity[6];
     double sx, sy, sw, sh;
+    RsvgBbox region, maskbox;
     gboolean nest = cr != render->initial_cr;
 
     if (self->maskunits == objectBoundingBox)
@@ -787,22 +814,59 @@ rsvg_cairo_generate_mask (cairo_t * cr, RsvgMask * self, RsvgDrawingCtx * ctx, R
     if (self->maskunits == objectBoundingBox)
         _rsvg_pop_view_box (ctx);
 
+    if (self->maskunits == objectBoundingBox) {
+        sx = sx * bbox->w + bbox->x;
+        sy = sy * bbox->h + bbox->y;
+        sw = sw * bbox->w;
+        sh = sh * bbox->h;
+    }
+
+    /* Work out the device space area that can end up visible */
+    _rsvg_affine_identity (identity);
+    rsvg_bbox_init (&region, identity);
+    region.x = 0;
+    region.y = 0;
+    region.w = render->width;
+    region.h = render->height;
+    region.virgin = 0;
+
+    rsvg_bbox_init (&maskbox, state->affine);
+    maskbox.x = sx;
+    maskbox.y = sy;
+    maskbox.w = sw;
+    maskbox.h = sh;
+    maskbox.virgin = 0;
+    rsvg_bbox_clip (&region, &maskbox);
+
+    if (bounded)
+        rsvg_bbox_clip (&region, bbox);
+
+    x0 = floor (region.x);
+    y0 = floor (region.y);
+    x1 = ceil (region.x + region.w);
+    y1 = ceil (region.y + region.h);
+
+    /* Nothing of the content survives the mask */
+    if (x1 <= x0 || y1 <= y0)
+        return;
+
+    width = x1 - x0;
+    height = y1 - y0;
+    rowstride = width * 4;
+
     pixels = g_new0 (guint8, height * rowstride);
     surface = cairo_image_surface_create_for_data (pixels,
                                                    CAIRO_FORMAT_ARGB32, width, height, rowstride);
+    cairo_surface_set_device_offset (surface, -x0, -y0);
 
     mask_cr = cairo_create (surface);
     save_cr = render->cr;
     render->cr = mask_cr;
 
-    if (self->maskunits == objectBoundingBox)
-        rsvg_cairo_add_clipping_rect (ctx,
-                                      sx * bbox->w + bbox->x,
-                                      sy * bbox->h + bbox->y, sw * bbox->w, sh * bbox->h);
-    else
-        rsvg_cairo_add_clipping_rect (ctx, sx, sy, sw, sh);
+    rsvg_cairo_add_clipping_rect (ctx, sx, sy, sw, sh);
 
-    /* Horribly dirty hack to have the bbox premultiplied to everything */
+    rsvg_state_push (ctx);
+    /* objectBoundingBox units put the bbox under every child's transform */
     if (self->contentunits == objectBoundingBox) {
         double bbtransform[6];
         bbtransform[0] = bbox->w;
@@ -811,42 +875,43 @@ rsvg_cairo_generate_mask (cairo_t * cr, RsvgMask * self, RsvgDrawingCtx * ctx, R
         bbtransform[3] = bbox->h;
         bbtransform[4] = bbox->x;
         bbtransform[5] = bbox->y;
-        for (i = 0; i < 6; i++)
-            affinesave[i] = self->super.state->affine[i];
-        _rsvg_affine_multiply (self->super.state->affine, bbtransform, self->super.state->affine);
         _rsvg_push_view_box (ctx, 1, 1);
-    }
-
-    rsvg_state_push (ctx);
-    _rsvg_node_draw_children (&self->super, ctx, 0);
-    rsvg_state_pop (ctx);
-
-    if (self->contentunits == objectBoundingBox) {
+        _rsvg_node_draw_children_under (&self->super, ctx, bbtransform);
         _rsvg_pop_view_box (ctx);
-        for (i = 0; i < 6; i++)
-            self->super.state->affine[i] = affinesave[i];
-    }
+    } else
+        _rsvg_node_draw_children (&self->super, ctx, 0);
+    rsvg_state_pop (ctx);
 
     render->cr = save_cr;
+    cairo_destroy (mask_cr);
+    cairo_surface_flush (surface);
+
+    alpha_surface = cairo_image_surface_create (CAIRO_FORMAT_A8, width, height);
+    alpha_pixels = cairo_image_surface_get_data (alpha_surface);
+    alpha_rowstride = cairo_image_surface_get_stride (alpha_surface);
 
+    /* Luminance times opacity, scaled so that the top byte is the alpha.
+       Kept free of branches so the compiler can vectorize it. */
     for (row = 0; row < height; row++) {
-        guint8 *row_data = (pixels + (row * rowstride));
+        const guint32 *src = (const guint32 *) (pixels + row * rowstride);
+        guint8 *dst = alpha_pixels + row * alpha_rowstride;
         for (i = 0; i < width; i++) {
-            guint32 *pixel = (guint32 *) row_data + i;
-            *pixel = ((((*pixel & 0x00ff0000) >> 16) * 13817 +
-                       ((*pixel & 0x0000ff00) >> 8) * 46518 +
-                       ((*pixel & 0x000000ff)) * 4688) * state->opacity);
+            guint32 pixel = src[i];
+            dst[i] = ((((pixel & 0x00ff0000) >> 16) * 13817 +
+                       ((pixel & 0x0000ff00) >> 8) * 46518 +
+                       ((pixel & 0x000000ff)) * 4688) * state->opacity) >> 24;
         }
     }
+    cairo_surface_mark_dirty (alpha_surface);
 
-    cairo_destroy (mask_cr);
-
-    cairo_identity_matrix (cr);
-    cairo_mask_surface (cr, surface,
-                        nest ? 0 : render->offset_x,
-                        nest ? 0 : render->offset_y);
     cairo_surface_destroy (surface);
     g_free (pixels);
+
+    cairo_identity_matrix (cr);
+    cairo_mask_surface (cr, alpha_surface,
+                        x0 + (nest ? 0 : render->offset_x),
+                        y0 + (nest ? 0 : render->offset_y));
+    cairo_surface_destroy (alpha_surface);
 }
 
 static void
@@ -909,9 +974,14 @@ rsvg_cairo_push_render_stack (RsvgDrawingCtx * ctx)
     render->cr_stack = g_list_prepend (render->cr_stack, render->cr);
     render->cr = child_cr;
 
+    if (state->enable_background == RSVG_ENABLE_BACKGROUND_NEW)
+        render->bg_new_stack = g_list_prepend (render->bg_new_stack, child_cr);
+
     bbox = g_new (RsvgBbox, 1);
     *bbox = render->bbox;
     render->bb_stack = g_list_prepend (render->bb_stack, bbox);
+    render->filter_count_stack = g_list_prepend (render->filter_count_stack,
+                                                 GINT_TO_POINTER (render->filter_count));
     rsvg_bbox_init (&render->bbox, state->affine);
 }
 
@@ -922,41 +992,63 @@ rsvg_cairo_push_discrete_layer (RsvgDrawingCtx * ctx)
     rsvg_cairo_push_render_stack (ctx);
 }
 
-static GdkPixbuf *
-rsvg_compile_bg (RsvgDrawingCtx * ctx)
+/**
+ * rsvg_cairo_get_background: Composites the layers under the current one.
+ * @ctx: the drawing context, in the middle of popping a filtered layer
+ * @region: the device space area that will actually be read
+ * @dest: a canvas sized pixbuf to composite into
+ *
+ * Only called by the filter code, and only when a primitive reads
+ * BackgroundImage or BackgroundAlpha.  Only the pixels of @dest inside
+ * @region are touched: they are cleared and the layers are composited
+ * over them, stopping at the closest ancestor which set
+ * enable-background:new.
+ **/
+void
+rsvg_cairo_get_background (RsvgDrawingCtx * ctx, RsvgIRect region, GdkPixbuf * dest)
 {
     RsvgCairoRender *render = (RsvgCairoRender *) ctx->render;
     cairo_t *cr;
     cairo_surface_t *surface;
-    GList *i;
-    unsigned char *pixels = g_new0 (guint8, render->width * render->height * 4);
-    int rowstride = render->width * 4;
-
-    GdkPixbuf *output = gdk_pixbuf_new_from_data (pixels,
-                                                  GDK_COLORSPACE_RGB, TRUE, 8,
-                                                  render->width, render->height,
-                                                  rowstride,
-                                                  (GdkPixbufDestroyNotify) rsvg_pixmap_destroy,
-                                                  NULL);
+    GList *i, *start;
+    int rowstride = gdk_pixbuf_get_rowstride (dest);
+
+    region.x0 = MAX (region.x0, 0);
+    region.y0 = MAX (region.y0, 0);
+    region.x1 = MIN (region.x1, gdk_pixbuf_get_width (dest));
+    region.y1 = MIN (region.y1, gdk_pixbuf_get_height (dest));
+    if (region.x1 <= region.x0 || region.y1 <= region.y0)
+        return;
 
-    surface = cairo_image_surface_create_for_data (pixels,
+    /* A surface over just the region's pixels, so cairo never walks the
+       rest of the canvas */
+    surface = cairo_image_surface_create_for_data (gdk_pixbuf_get_pixels (dest) +
+                                                   region.y0 * rowstride + region.x0 * 4,
                                                    CAIRO_FORMAT_ARGB32,
-                                                   render->width, render->height, rowstride);
+                                                   region.x1 - region.x0,
+                                                   region.y1 - region.y0, rowstride);
 
     cr = cairo_create (surface);
     cairo_surface_destroy (surface);
 
-    for (i = g_list_last (render->cr_stack); i != NULL; i = g_list_previous (i)) {
+    cairo_set_operator (cr, CAIRO_OPERATOR_CLEAR);
+    cairo_paint (cr);
+    cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
+
+    for (start = render->cr_stack; start->next != NULL; start = start->next)
+        if (g_list_find (render->bg_new_stack, start->data))
+            break;
+
+    for (i = start; i != NULL; i = g_list_previous (i)) {
         cairo_t *draw = i->data;
         gboolean nest = draw != render->initial_cr;
         cairo_set_source_surface (cr, cairo_get_target (draw),
-                                  nest ? 0 : -render->offset_x,
-                                  nest ? 0 : -render->offset_y);
+                                  (nest ? 0 : -render->offset_x) - region.x0,
+                                  (nest ? 0 : -render->offset_y) - region.y0);
         cairo_paint (cr);
     }
 
     cairo_destroy (cr);
-    return output;
 }
 
 static void
@@ -981,14 +1073,12 @@ rsvg_cairo_pop_render_stack (RsvgDrawingCtx * ctx)
 
     if (state->filter) {
         GdkPixbuf *pixbuf = render->pixbuf_stack->data;
-        GdkPixbuf *bg = rsvg_compile_bg (ctx);
 
         render->pixbuf_stack = g_list_remove (render->pixbuf_stack, pixbuf);
 
-
-        output = rsvg_filter_render (state->filter, pixbuf, bg, ctx, &render->bbox, "2103");
+        output = rsvg_filter_render (state->filter, pixbuf, ctx, &render->bbox, "2103");
         g_object_unref (G_OBJECT (pixbuf));
-        g_object_unref (G_OBJECT (bg));
+        render->filter_count++;
 
         surface = cairo_image_surface_create_for_data (gdk_pixbuf_get_pixels (output),
                                                        CAIRO_FORMAT_ARGB32,
@@ -998,6 +1088,8 @@ rsvg_cairo_pop_render_stack (RsvgDrawingCtx * ctx)
     } else
         surface = cairo_get_target (child_cr);
 
+    render->bg_new_stack = g_list_remove (render->bg_new_stack, child_cr);
+
     render->cr = (cairo_t *) render->cr_stack->data;
     render->cr_stack = g_list_delete_link (render->cr_stack, render->cr_stack);
 
@@ -1013,7 +1105,10 @@ rsvg_cairo_pop_render_stack (RsvgDrawingCtx * ctx)
     _rsvg_cairo_set_operator (render->cr, state->comp_op);
 
     if (state->mask) {
-        rsvg_cairo_generate_mask (render->cr, state->mask, ctx, &render->bbox);
+        /* Filter results drawn into this layer can reach outside its bbox */
+        gboolean bounded =
+            GPOINTER_TO_INT (render->filter_count_stack->data) == render->filter_count;
+        rsvg_cairo_generate_mask (render->cr, state->mask, ctx, &render->bbox, bounded);
     } else if (state->opacity != 0xFF)
         cairo_paint_with_alpha (render->cr, (double) state->opacity / 255.0);
     else
@@ -1027,6 +1122,8 @@ rsvg_cairo_pop_render_stack (RsvgDrawingCtx * ctx)
 
     g_free (render->bb_stack->data);
     render->bb_stack = g_list_delete_link (render->bb_stack, render->bb_stack);
+    render->filter_count_stack = g_list_delete_link (render->filter_count_stack,
+                                                     render->filter_count_stack);
 
     if (state->filter) {
         g_object_unref (G_OBJECT (output));
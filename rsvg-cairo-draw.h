@@ -45,6 +45,8 @@ void		 rsvg_cairo_add_clipping_rect	    (RsvgDrawingCtx *ctx,
 
 GdkPixbuf	*rsvg_cairo_get_image_of_node	    (RsvgDrawingCtx *ctx, RsvgNode *drawable, 
 						     double width, double height);
+void		 rsvg_cairo_get_background	    (RsvgDrawingCtx *ctx, RsvgIRect region,
+						     GdkPixbuf *dest);
 
 void		 rsvg_cairo_to_pixbuf		    (guint8 * pixels, int rowstride, int height);
 void		 rsvg_pixbuf_to_cairo		    (guint8 * pixels, int rowstride, int height);
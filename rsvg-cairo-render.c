@@ -36,6 +36,7 @@
 #include "rsvg-cairo-render.h"
 #include "rsvg-styles.h"
 #include "rsvg-structure.h"
+#include "rsvg-text.h"
 
 static void
 rsvg_cairo_render_free (RsvgRender * self)
@@ -44,6 +45,10 @@ rsvg_cairo_render_free (RsvgRender * self)
 
     /* TODO */
 
+    if (me->clip_cache)
+        g_hash_table_destroy (me->clip_cache);
+    if (me->pango_context)
+        rsvg_text_pango_context_release (me->pango_context);
     g_free (me);
 }
 
@@ -61,6 +66,7 @@ rsvg_cairo_render_new (cairo_t * cr, double width, double height)
     cairo_render->super.push_discrete_layer = rsvg_cairo_push_discrete_layer;
     cairo_render->super.add_clipping_rect = rsvg_cairo_add_clipping_rect;
     cairo_render->super.get_image_of_node = rsvg_cairo_get_image_of_node;
+    cairo_render->super.get_background = rsvg_cairo_get_background;
     cairo_render->width = width;
     cairo_render->height = height;
     cairo_render->offset_x = 0;
@@ -70,6 +76,11 @@ rsvg_cairo_render_new (cairo_t * cr, double width, double height)
     cairo_render->cr_stack = NULL;
     cairo_render->bb_stack = NULL;
     cairo_render->pixbuf_stack = NULL;
+    cairo_render->bg_new_stack = NULL;
+    cairo_render->filter_count = 0;
+    cairo_render->filter_count_stack = NULL;
+    cairo_render->clip_cache = NULL;
+    cairo_render->pango_context = NULL;
 
     return cairo_render;
 }
@@ -142,6 +153,7 @@ rsvg_cairo_new_drawing_ctx (cairo_t * cr, RsvgHandle * handle)
     render->offset_y = bby0;
 
     draw->state = NULL;
+    draw->n_states = 0;
 
     draw->defs = handle->priv->defs;
     draw->base_uri = g_strdup (handle->priv->base_uri);
@@ -151,6 +163,9 @@ rsvg_cairo_new_drawing_ctx (cairo_t * cr, RsvgHandle * handle)
     draw->vb.h = data.ex;
     draw->pango_context = NULL;
     draw->drawsub_stack = NULL;
+    draw->marker_cache = NULL;
+    draw->use_cache = NULL;
+    draw->layout_cache = NULL;
 
     rsvg_state_push (draw);
     state = rsvg_state_current (draw);
@@ -47,6 +47,15 @@ struct _RsvgCairoRender {
     RsvgBbox bbox;
     GList *bb_stack;
     GList *pixbuf_stack;
+    /* layers pushed for elements with enable-background:new */
+    GList *bg_new_stack;
+    /* number of filters applied so far, and its value when each layer was pushed */
+    gint filter_count;
+    GList *filter_count_stack;
+    /* RsvgClipPath -> device-space geometry it was last applied with */
+    GHashTable *clip_cache;
+    /* shared by the text chunks drawn through this render */
+    PangoContext *pango_context;
 };
 
 RsvgCairoRender *rsvg_cairo_render_new		(cairo_t * cr, double width, double height);
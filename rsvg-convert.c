@@ -111,6 +111,149 @@ rsvg_cairo_write_func (void *closure, const unsigned char *data, unsigned int le
 	return CAIRO_STATUS_WRITE_ERROR;
 }
 
+/* Batch mode renders each input to its own PNG, named by substituting the
+ * input's base name for the %s of the output pattern; this applies to a
+ * single input too, and two inputs may not map to the same output, as they
+ * would overwrite each other.  Every file gets its
+ * own handle and surface, so files can be spread over worker threads.  The
+ * font maps are shared, and pango before 1.32 is not thread-safe, so the
+ * library does all pango work under one lock (see rsvg-text.c): text from
+ * the workers is laid out and drawn one chunk at a time while the rest of
+ * each file renders in parallel. */
+typedef struct {
+    struct RsvgSizeCallbackData size_data;
+    const char *base_uri;
+    const char *output_pattern;
+    gint n_failed;
+} RsvgConvertBatch;
+
+/* whether @output has a %s to substitute, as opposed to a literal %% */
+static gboolean
+rsvg_convert_output_is_pattern (const char *output)
+{
+    const char *p;
+
+    for (p = output; *p; p++) {
+        if (p[0] == '%' && p[1] == 's')
+            return TRUE;
+        else if (p[0] == '%' && p[1] == '%')
+            p++;
+    }
+
+    return FALSE;
+}
+
+static char *
+rsvg_convert_output_name (const char *pattern, const char *filename)
+{
+    GString *name;
+    char *base, *dot;
+    const char *p;
+
+    base = g_path_get_basename (filename);
+    dot = strrchr (base, '.');
+    if (dot && (!g_ascii_strcasecmp (dot, ".svg") || !g_ascii_strcasecmp (dot, ".svgz")))
+        *dot = '\0';
+
+    name = g_string_new (NULL);
+    for (p = pattern; *p; p++) {
+        if (p[0] == '%' && p[1] == 's') {
+            g_string_append (name, base);
+            p++;
+        } else if (p[0] == '%' && p[1] == '%') {
+            g_string_append_c (name, '%');
+            p++;
+        } else
+            g_string_append_c (name, *p);
+    }
+
+    g_free (base);
+    return g_string_free (name, FALSE);
+}
+
+/* Fails if two inputs would be written to the same file, say a/x.svg and
+   b/x.svg, before anything is rendered */
+static gboolean
+rsvg_convert_check_output_names (const char *pattern, char **filenames, gint n_filenames)
+{
+    GHashTable *outputs;
+    gboolean ok = TRUE;
+    gint i;
+
+    outputs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+    for (i = 0; i < n_filenames && ok; i++) {
+        char *output = rsvg_convert_output_name (pattern, filenames[i]);
+        const char *other = g_hash_table_lookup (outputs, output);
+
+        if (other != NULL) {
+            fprintf (stderr, _("%s and %s would both be saved to %s\n"), other,
+                     filenames[i], output);
+            g_free (output);
+            ok = FALSE;
+        } else
+            g_hash_table_insert (outputs, output, filenames[i]);
+    }
+
+    g_hash_table_destroy (outputs);
+    return ok;
+}
+
+static void
+rsvg_convert_batch_file (gpointer data, gpointer user_data)
+{
+    const char *filename = data;
+    RsvgConvertBatch *batch = user_data;
+    RsvgHandle *rsvg;
+    RsvgDimensionData dimensions;
+    cairo_surface_t *surface;
+    cairo_t *cr;
+    cairo_status_t status;
+    GError *error = NULL;
+    char *output;
+    FILE *output_file;
+
+    rsvg = rsvg_handle_new_from_file (filename, &error);
+    if (!rsvg) {
+        fprintf (stderr, _("Error reading SVG %s: %s\n"), filename,
+                 error ? error->message : "");
+        if (error)
+            g_error_free (error);
+        g_atomic_int_inc (&batch->n_failed);
+        return;
+    }
+
+    if (batch->base_uri)
+        rsvg_handle_set_base_uri (rsvg, batch->base_uri);
+
+    rsvg_handle_get_dimensions (rsvg, &dimensions);
+    _rsvg_size_callback (&dimensions.width, &dimensions.height, &batch->size_data);
+    rsvg_handle_set_size_callback (rsvg, rsvg_cairo_size_callback, &dimensions, NULL);
+
+    surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, dimensions.width, dimensions.height);
+    cr = cairo_create (surface);
+    rsvg_handle_render_cairo (rsvg, cr);
+    cairo_destroy (cr);
+    g_object_unref (G_OBJECT (rsvg));
+
+    output = rsvg_convert_output_name (batch->output_pattern, filename);
+    output_file = fopen (output, "wb");
+    if (output_file) {
+        status = cairo_surface_write_to_png_stream (surface, rsvg_cairo_write_func, output_file);
+        if (fclose (output_file) != 0)
+            status = CAIRO_STATUS_WRITE_ERROR;
+    } else
+        status = CAIRO_STATUS_WRITE_ERROR;
+
+    if (status != CAIRO_STATUS_SUCCESS) {
+        fprintf (stderr, _("Error saving to file: %s\n"), output);
+        g_atomic_int_inc (&batch->n_failed);
+    }
+
+    g_free (output);
+    cairo_surface_destroy (surface);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -127,7 +270,10 @@ main (int argc, char **argv)
     char *output = NULL;
     int keep_aspect_ratio = FALSE;
     char *base_uri = NULL;
+    int n_jobs = 1;
     gboolean using_stdin = FALSE;
+    gboolean batch_mode = FALSE;
+    gboolean output_is_pattern;
     GError *error = NULL;
 
     int i;
@@ -137,6 +283,7 @@ main (int argc, char **argv)
     cairo_surface_t *surface = NULL;
     cairo_t *cr = NULL;
     RsvgDimensionData dimensions;
+    struct RsvgSizeCallbackData size_data;
     FILE *output_file = stdout;
 
     GOptionEntry options_table[] = {
@@ -157,7 +304,9 @@ main (int argc, char **argv)
         {"format", 'f', 0, G_OPTION_ARG_STRING, &format,
          N_("save format [optional; defaults to 'png']"), N_("[png, pdf, ps, svg]")},
         {"output", 'o', 0, G_OPTION_ARG_STRING, &output,
-         N_("output filename [optional; defaults to stdout]"), NULL},
+         N_("output filename, or a pattern with %s for each input's name [optional; defaults to stdout]"), NULL},
+        {"jobs", 'j', 0, G_OPTION_ARG_INT, &n_jobs,
+         N_("number of files to convert at once with an output pattern [optional; defaults to 1]"), N_("<int>")},
         {"keep-aspect-ratio", 'a', 0, G_OPTION_ARG_NONE, &keep_aspect_ratio,
          N_("whether to preserve the aspect ratio [optional; defaults to FALSE]"), NULL},
         {"version", 'v', 0, G_OPTION_ARG_NONE, &bVersion, N_("show version information"), NULL},
@@ -183,32 +332,125 @@ main (int argc, char **argv)
         return 0;
     }
 
-    if (output != NULL) {
-        output_file = fopen (output, "wb");
-        if (!output_file) {
-            fprintf (stderr, _("Error saving to file: %s\n"), output);
-            exit (1);
-        }
-    }
-
     if (args)
         while (args[n_args] != NULL)
             n_args++;
 
+    output_is_pattern = output != NULL && rsvg_convert_output_is_pattern (output);
+
     if (n_args == 0) {
         n_args = 1;
         using_stdin = TRUE;
+    }
+
+    if (output_is_pattern) {
+        if (using_stdin) {
+            fprintf (stderr, _("An output pattern containing %%s needs input files.\n"));
+            exit (1);
+        } else if (!format || !strcmp (format, "png")) {
+            batch_mode = TRUE;
+            if (!rsvg_convert_check_output_names (output, args, n_args))
+                exit (1);
+        } else if (n_args == 1) {
+            char *name = rsvg_convert_output_name (output, args[0]);
+
+            g_free (output);
+            output = name;
+        } else {
+            fprintf (stderr, _("An output pattern containing %%s with several SVG files "
+                               "is only allowed for PNG output.\n"));
+            exit (1);
+        }
     } else if (n_args > 1 && (!format || !(!strcmp (format, "ps") || !strcmp (format, "pdf")))) {
-        fprintf (stderr, _("Multiple SVG files are only allowed for PDF and PS output.\n"));
+        fprintf (stderr, _("Multiple SVG files are only allowed for PDF and PS output, "
+                           "or for PNG output with an output pattern containing %%s.\n"));
         exit (1);
     }
 
+    if (output != NULL && !batch_mode) {
+        output_file = fopen (output, "wb");
+        if (!output_file) {
+            fprintf (stderr, _("Error saving to file: %s\n"), output);
+            exit (1);
+        }
+    }
+
     if (zoom != 1.0)
         x_zoom = y_zoom = zoom;
 
+    /* if both are unspecified, assume user wants to zoom the image in at least 1 dimension */
+    if (width == -1 && height == -1) {
+        size_data.type = RSVG_SIZE_ZOOM;
+        size_data.x_zoom = x_zoom;
+        size_data.y_zoom = y_zoom;
+        size_data.keep_aspect_ratio = keep_aspect_ratio;
+    }
+    /* if both are unspecified, assume user wants to resize image in at least 1 dimension */
+    else if (x_zoom == 1.0 && y_zoom == 1.0) {
+        /* if one parameter is unspecified, assume user wants to keep the aspect ratio */
+        if (width == -1 || height == -1) {
+            size_data.type = RSVG_SIZE_WH_MAX;
+            size_data.width = width;
+            size_data.height = height;
+            size_data.keep_aspect_ratio = keep_aspect_ratio;
+        } else {
+            size_data.type = RSVG_SIZE_WH;
+            size_data.width = width;
+            size_data.height = height;
+            size_data.keep_aspect_ratio = keep_aspect_ratio;
+        }
+    } else {
+        /* assume the user wants to zoom the image, but cap the maximum size */
+        size_data.type = RSVG_SIZE_ZOOM_MAX;
+        size_data.x_zoom = x_zoom;
+        size_data.y_zoom = y_zoom;
+        size_data.width = width;
+        size_data.height = height;
+        size_data.keep_aspect_ratio = keep_aspect_ratio;
+    }
+
     rsvg_init ();
     rsvg_set_default_dpi_x_y (dpi_x, dpi_y);
 
+    if (batch_mode) {
+        RsvgConvertBatch batch;
+        GThreadPool *pool = NULL;
+
+        batch.size_data = size_data;
+        batch.base_uri = base_uri;
+        batch.output_pattern = output;
+        batch.n_failed = 0;
+
+        if (n_jobs > 1) {
+            /* register the handle type before the workers race to do it */
+            g_type_class_unref (g_type_class_ref (RSVG_TYPE_HANDLE));
+
+            /* older GLib returns the pool with whatever threads it did
+               start, newer GLib returns NULL */
+            pool = g_thread_pool_new (rsvg_convert_batch_file, &batch,
+                                      MIN (n_jobs, n_args), TRUE, &error);
+            if (error != NULL) {
+                fprintf (stderr, _("Error starting worker threads: %s\n"), error->message);
+                g_error_free (error);
+                error = NULL;
+            }
+        }
+
+        if (pool != NULL) {
+            for (i = 0; i < n_args; i++)
+                g_thread_pool_push (pool, args[i], NULL);
+            /* waits for every queued file to be written */
+            g_thread_pool_free (pool, FALSE, TRUE);
+        } else {
+            for (i = 0; i < n_args; i++)
+                rsvg_convert_batch_file (args[i], &batch);
+        }
+
+        rsvg_term ();
+
+        return batch.n_failed ? 1 : 0;
+    }
+
     for (i = 0; i < n_args; i++) {
         if (using_stdin)
             rsvg = rsvg_handle_new_from_stdio_file (stdin, &error);
@@ -229,40 +471,7 @@ main (int argc, char **argv)
         rsvg_handle_set_size_callback (rsvg, rsvg_cairo_size_callback, &dimensions, NULL);
 
         if (i == 0) {
-            struct RsvgSizeCallbackData size_data;
-
             rsvg_handle_get_dimensions (rsvg, &dimensions);
-            /* if both are unspecified, assume user wants to zoom the image in at least 1 dimension */
-            if (width == -1 && height == -1) {
-                size_data.type = RSVG_SIZE_ZOOM;
-                size_data.x_zoom = x_zoom;
-                size_data.y_zoom = y_zoom;
-                size_data.keep_aspect_ratio = keep_aspect_ratio;
-            }
-            /* if both are unspecified, assume user wants to resize image in at least 1 dimension */
-            else if (x_zoom == 1.0 && y_zoom == 1.0) {
-                /* if one parameter is unspecified, assume user wants to keep the aspect ratio */
-                if (width == -1 || height == -1) {
-                    size_data.type = RSVG_SIZE_WH_MAX;
-                    size_data.width = width;
-                    size_data.height = height;
-                    size_data.keep_aspect_ratio = keep_aspect_ratio;
-                } else {
-                    size_data.type = RSVG_SIZE_WH;
-                    size_data.width = width;
-                    size_data.height = height;
-                    size_data.keep_aspect_ratio = keep_aspect_ratio;
-                }
-            } else {
-                /* assume the user wants to zoom the image, but cap the maximum size */
-                size_data.type = RSVG_SIZE_ZOOM_MAX;
-                size_data.x_zoom = x_zoom;
-                size_data.y_zoom = y_zoom;
-                size_data.width = width;
-                size_data.height = height;
-                size_data.keep_aspect_ratio = keep_aspect_ratio;
-            }
-
             _rsvg_size_callback (&dimensions.width, &dimensions.height, &size_data);
 
             if (!format || !strcmp (format, "png"))
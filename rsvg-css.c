@@ -43,9 +43,105 @@
 #define MM_PER_INCH     (25.4)
 #define PICA_PER_INCH   (6.0)
 
+/* a two letter unit suffix as one switchable value */
+#define RSVG_CSS_UNIT(a, b) (((a) << 8) | (b))
+
 #define SETINHERIT() G_STMT_START {if (inherit != NULL) *inherit = TRUE;} G_STMT_END
 #define UNSETINHERIT() G_STMT_START {if (inherit != NULL) *inherit = FALSE;} G_STMT_END
 
+/* Powers of ten that a double holds exactly */
+static const double rsvg_css_exact_powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/**
+ * _rsvg_css_strtod:
+ * @str: the string to convert
+ * @endptr: return location for the end of the number, or %NULL
+ *
+ * A drop-in replacement for g_ascii_strtod that handles the numbers SVG
+ * documents are made of in one pass and without allocating.  When the
+ * digits fit in 53 bits and the decimal exponent is at most 22, both are
+ * exact doubles and a single multiplication or division rounds the
+ * result correctly.  Anything else (longer mantissas, large exponents,
+ * hexadecimal, infinities and NaNs) is handed to g_ascii_strtod.
+ **/
+gdouble
+_rsvg_css_strtod (const char *str, char **endptr)
+{
+    const char *p = str;
+    guint64 mantissa = 0;
+    gint digits = 0, exponent = 0;
+    gboolean negative = FALSE, seen_digit = FALSE;
+    double value;
+
+    while (g_ascii_isspace (*p))
+        p++;
+    if (*p == '-' || *p == '+')
+        negative = *p++ == '-';
+
+    if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+        return g_ascii_strtod (str, endptr);
+
+    for (; g_ascii_isdigit (*p); p++) {
+        seen_digit = TRUE;
+        if (mantissa == 0 && *p == '0')
+            continue;
+        if (digits == 19)
+            return g_ascii_strtod (str, endptr);
+        mantissa = mantissa * 10 + (*p - '0');
+        digits++;
+    }
+
+    if (*p == '.') {
+        for (p++; g_ascii_isdigit (*p); p++) {
+            seen_digit = TRUE;
+            exponent--;
+            if (mantissa == 0 && *p == '0')
+                continue;
+            if (digits == 19)
+                return g_ascii_strtod (str, endptr);
+            mantissa = mantissa * 10 + (*p - '0');
+            digits++;
+        }
+    }
+
+    if (!seen_digit)
+        return g_ascii_strtod (str, endptr);
+
+    if (*p == 'e' || *p == 'E') {
+        const char *q = p + 1;
+        gboolean exp_negative = FALSE;
+        gint exp_value = 0;
+
+        if (*q == '-' || *q == '+')
+            exp_negative = *q++ == '-';
+        if (g_ascii_isdigit (*q)) {
+            for (; g_ascii_isdigit (*q); q++) {
+                if (exp_value > 1000)
+                    return g_ascii_strtod (str, endptr);
+                exp_value = exp_value * 10 + (*q - '0');
+            }
+            exponent += exp_negative ? -exp_value : exp_value;
+            p = q;
+        }
+    }
+
+    if (mantissa == 0)
+        value = 0.;
+    else if (mantissa > (G_GUINT64_CONSTANT (1) << 53) || exponent < -22 || exponent > 22)
+        return g_ascii_strtod (str, endptr);
+    else if (exponent < 0)
+        value = (double) mantissa / rsvg_css_exact_powers_of_ten[-exponent];
+    else
+        value = (double) mantissa * rsvg_css_exact_powers_of_ten[exponent];
+
+    if (endptr)
+        *endptr = (char *) p;
+    return negative ? -value : value;
+}
+
 /**
  * rsvg_css_parse_vbox
  * @vbox: The CSS viewBox
@@ -108,66 +204,81 @@ rsvg_css_parse_raw_length (const char *str, gint * in,
     *ex = FALSE;
     *relative_size = RELATIVE_SIZE_NORMAL;
 
-    length = g_ascii_strtod (str, &p);
+    length = _rsvg_css_strtod (str, &p);
 
     if ((length == -HUGE_VAL || length == HUGE_VAL) && (ERANGE == errno)) {
         /* todo: error condition - figure out how to best represent it */
         return 0.0;
     }
 
-    /* test for either pixels or no unit, which is assumed to be pixels */
-    if (p && *p && (strcmp (p, "px") != 0)) {
-        if (!strcmp (p, "pt")) {
-            length /= POINTS_PER_INCH;
+    /* no unit is assumed to be pixels */
+    if (p == NULL || *p == '\0')
+        return length;
+
+    if (p[0] == '%' && p[1] == '\0') {
+        *percent = TRUE;
+        return length * 0.01;
+    }
+
+    if (p[1] != '\0' && p[2] == '\0') {
+        switch (RSVG_CSS_UNIT (p[0], p[1])) {
+        case RSVG_CSS_UNIT ('p', 'x'):
+            return length;
+        case RSVG_CSS_UNIT ('p', 't'):
             *in = TRUE;
-        } else if (!strcmp (p, "in"))
+            return length / POINTS_PER_INCH;
+        case RSVG_CSS_UNIT ('i', 'n'):
             *in = TRUE;
-        else if (!strcmp (p, "cm")) {
-            length /= CM_PER_INCH;
+            return length;
+        case RSVG_CSS_UNIT ('c', 'm'):
             *in = TRUE;
-        } else if (!strcmp (p, "mm")) {
-            length /= MM_PER_INCH;
+            return length / CM_PER_INCH;
+        case RSVG_CSS_UNIT ('m', 'm'):
             *in = TRUE;
-        } else if (!strcmp (p, "pc")) {
-            length /= PICA_PER_INCH;
+            return length / MM_PER_INCH;
+        case RSVG_CSS_UNIT ('p', 'c'):
             *in = TRUE;
-        } else if (!strcmp (p, "em"))
+            return length / PICA_PER_INCH;
+        case RSVG_CSS_UNIT ('e', 'm'):
             *em = TRUE;
-        else if (!strcmp (p, "ex"))
+            return length;
+        case RSVG_CSS_UNIT ('e', 'x'):
             *ex = TRUE;
-        else if (!strcmp (p, "%")) {
-            *percent = TRUE;
-            length *= 0.01;
-        } else {
-            double pow_factor = 0.0;
-
-            if (!g_ascii_strcasecmp (p, "larger")) {
-                *relative_size = RELATIVE_SIZE_LARGER;
-                return 0.0;
-            } else if (!g_ascii_strcasecmp (p, "smaller")) {
-                *relative_size = RELATIVE_SIZE_SMALLER;
-                return 0.0;
-            } else if (!g_ascii_strcasecmp (p, "xx-small")) {
-                pow_factor = -3.0;
-            } else if (!g_ascii_strcasecmp (p, "x-small")) {
-                pow_factor = -2.0;
-            } else if (!g_ascii_strcasecmp (p, "small")) {
-                pow_factor = -1.0;
-            } else if (!g_ascii_strcasecmp (p, "medium")) {
-                pow_factor = 0.0;
-            } else if (!g_ascii_strcasecmp (p, "large")) {
-                pow_factor = 1.0;
-            } else if (!g_ascii_strcasecmp (p, "x-large")) {
-                pow_factor = 2.0;
-            } else if (!g_ascii_strcasecmp (p, "xx-large")) {
-                pow_factor = 3.0;
-            } else {
-                return 0.0;
-            }
+            return length;
+        default:
+            break;
+        }
+    }
 
-            length = 12.0 * pow (1.2, pow_factor) / POINTS_PER_INCH;
-            *in = TRUE;
+    {
+        double pow_factor = 0.0;
+
+        if (!g_ascii_strcasecmp (p, "larger")) {
+            *relative_size = RELATIVE_SIZE_LARGER;
+            return 0.0;
+        } else if (!g_ascii_strcasecmp (p, "smaller")) {
+            *relative_size = RELATIVE_SIZE_SMALLER;
+            return 0.0;
+        } else if (!g_ascii_strcasecmp (p, "xx-small")) {
+            pow_factor = -3.0;
+        } else if (!g_ascii_strcasecmp (p, "x-small")) {
+            pow_factor = -2.0;
+        } else if (!g_ascii_strcasecmp (p, "small")) {
+            pow_factor = -1.0;
+        } else if (!g_ascii_strcasecmp (p, "medium")) {
+            pow_factor = 0.0;
+        } else if (!g_ascii_strcasecmp (p, "large")) {
+            pow_factor = 1.0;
+        } else if (!g_ascii_strcasecmp (p, "x-large")) {
+            pow_factor = 2.0;
+        } else if (!g_ascii_strcasecmp (p, "xx-large")) {
+            pow_factor = 3.0;
+        } else {
+            return 0.0;
         }
+
+        length = 12.0 * pow (1.2, pow_factor) / POINTS_PER_INCH;
+        *in = TRUE;
     }
 
     return length;
@@ -294,34 +405,256 @@ rsvg_css_clip_rgb_percent (gdouble in_percent)
     return (gint) floor (255. * in_percent / 100. + 0.5);
 }
 
-static gint
-rsvg_css_clip_rgb (gint rgb)
-{
-    /* spec says to clip these values */
-    if (rgb > 255)
-        return 255;
-    else if (rgb < 0)
-        return 0;
-    return rgb;
-}
-
 typedef struct {
     const char *const name;
     guint rgb;
 } ColorPair;
 
-/* compare function callback for bsearch */
-static int
-rsvg_css_color_compare (const void *a, const void *b)
+/* pack 3 [0,255] ints into one 32 bit one */
+#define PACK_RGB(r,g,b) (((r) << 16) | ((g) << 8) | (b))
+
+static const ColorPair color_list[] = {
+        {"aliceblue", PACK_RGB (240, 248, 255)},
+        {"antiquewhite", PACK_RGB (250, 235, 215)},
+        {"aqua", PACK_RGB (0, 255, 255)},
+        {"aquamarine", PACK_RGB (127, 255, 212)},
+        {"azure", PACK_RGB (240, 255, 255)},
+        {"beige", PACK_RGB (245, 245, 220)},
+        {"bisque", PACK_RGB (255, 228, 196)},
+        {"black", PACK_RGB (0, 0, 0)},
+        {"blanchedalmond", PACK_RGB (255, 235, 205)},
+        {"blue", PACK_RGB (0, 0, 255)},
+        {"blueviolet", PACK_RGB (138, 43, 226)},
+        {"brown", PACK_RGB (165, 42, 42)},
+        {"burlywood", PACK_RGB (222, 184, 135)},
+        {"cadetblue", PACK_RGB (95, 158, 160)},
+        {"chartreuse", PACK_RGB (127, 255, 0)},
+        {"chocolate", PACK_RGB (210, 105, 30)},
+        {"coral", PACK_RGB (255, 127, 80)},
+        {"cornflowerblue", PACK_RGB (100, 149, 237)},
+        {"cornsilk", PACK_RGB (255, 248, 220)},
+        {"crimson", PACK_RGB (220, 20, 60)},
+        {"cyan", PACK_RGB (0, 255, 255)},
+        {"darkblue", PACK_RGB (0, 0, 139)},
+        {"darkcyan", PACK_RGB (0, 139, 139)},
+        {"darkgoldenrod", PACK_RGB (184, 134, 11)},
+        {"darkgray", PACK_RGB (169, 169, 169)},
+        {"darkgreen", PACK_RGB (0, 100, 0)},
+        {"darkgrey", PACK_RGB (169, 169, 169)},
+        {"darkkhaki", PACK_RGB (189, 183, 107)},
+        {"darkmagenta", PACK_RGB (139, 0, 139)},
+        {"darkolivegreen", PACK_RGB (85, 107, 47)},
+        {"darkorange", PACK_RGB (255, 140, 0)},
+        {"darkorchid", PACK_RGB (153, 50, 204)},
+        {"darkred", PACK_RGB (139, 0, 0)},
+        {"darksalmon", PACK_RGB (233, 150, 122)},
+        {"darkseagreen", PACK_RGB (143, 188, 143)},
+        {"darkslateblue", PACK_RGB (72, 61, 139)},
+        {"darkslategray", PACK_RGB (47, 79, 79)},
+        {"darkslategrey", PACK_RGB (47, 79, 79)},
+        {"darkturquoise", PACK_RGB (0, 206, 209)},
+        {"darkviolet", PACK_RGB (148, 0, 211)},
+        {"deeppink", PACK_RGB (255, 20, 147)},
+        {"deepskyblue", PACK_RGB (0, 191, 255)},
+        {"dimgray", PACK_RGB (105, 105, 105)},
+        {"dimgrey", PACK_RGB (105, 105, 105)},
+        {"dodgerblue", PACK_RGB (30, 144, 255)},
+        {"firebrick", PACK_RGB (178, 34, 34)},
+        {"floralwhite", PACK_RGB (255, 250, 240)},
+        {"forestgreen", PACK_RGB (34, 139, 34)},
+        {"fuchsia", PACK_RGB (255, 0, 255)},
+        {"gainsboro", PACK_RGB (220, 220, 220)},
+        {"ghostwhite", PACK_RGB (248, 248, 255)},
+        {"gold", PACK_RGB (255, 215, 0)},
+        {"goldenrod", PACK_RGB (218, 165, 32)},
+        {"gray", PACK_RGB (128, 128, 128)},
+        {"green", PACK_RGB (0, 128, 0)},
+        {"greenyellow", PACK_RGB (173, 255, 47)},
+        {"grey", PACK_RGB (128, 128, 128)},
+        {"honeydew", PACK_RGB (240, 255, 240)},
+        {"hotpink", PACK_RGB (255, 105, 180)},
+        {"indianred", PACK_RGB (205, 92, 92)},
+        {"indigo", PACK_RGB (75, 0, 130)},
+        {"ivory", PACK_RGB (255, 255, 240)},
+        {"khaki", PACK_RGB (240, 230, 140)},
+        {"lavender", PACK_RGB (230, 230, 250)},
+        {"lavenderblush", PACK_RGB (255, 240, 245)},
+        {"lawngreen", PACK_RGB (124, 252, 0)},
+        {"lemonchiffon", PACK_RGB (255, 250, 205)},
+        {"lightblue", PACK_RGB (173, 216, 230)},
+        {"lightcoral", PACK_RGB (240, 128, 128)},
+        {"lightcyan", PACK_RGB (224, 255, 255)},
+        {"lightgoldenrodyellow", PACK_RGB (250, 250, 210)},
+        {"lightgray", PACK_RGB (211, 211, 211)},
+        {"lightgreen", PACK_RGB (144, 238, 144)},
+        {"lightgrey", PACK_RGB (211, 211, 211)},
+        {"lightpink", PACK_RGB (255, 182, 193)},
+        {"lightsalmon", PACK_RGB (255, 160, 122)},
+        {"lightseagreen", PACK_RGB (32, 178, 170)},
+        {"lightskyblue", PACK_RGB (135, 206, 250)},
+        {"lightslategray", PACK_RGB (119, 136, 153)},
+        {"lightslategrey", PACK_RGB (119, 136, 153)},
+        {"lightsteelblue", PACK_RGB (176, 196, 222)},
+        {"lightyellow", PACK_RGB (255, 255, 224)},
+        {"lime", PACK_RGB (0, 255, 0)},
+        {"limegreen", PACK_RGB (50, 205, 50)},
+        {"linen", PACK_RGB (250, 240, 230)},
+        {"magenta", PACK_RGB (255, 0, 255)},
+        {"maroon", PACK_RGB (128, 0, 0)},
+        {"mediumaquamarine", PACK_RGB (102, 205, 170)},
+        {"mediumblue", PACK_RGB (0, 0, 205)},
+        {"mediumorchid", PACK_RGB (186, 85, 211)},
+        {"mediumpurple", PACK_RGB (147, 112, 219)},
+        {"mediumseagreen", PACK_RGB (60, 179, 113)},
+        {"mediumslateblue", PACK_RGB (123, 104, 238)},
+        {"mediumspringgreen", PACK_RGB (0, 250, 154)},
+        {"mediumturquoise", PACK_RGB (72, 209, 204)},
+        {"mediumvioletred", PACK_RGB (199, 21, 133)},
+        {"midnightblue", PACK_RGB (25, 25, 112)},
+        {"mintcream", PACK_RGB (245, 255, 250)},
+        {"mistyrose", PACK_RGB (255, 228, 225)},
+        {"moccasin", PACK_RGB (255, 228, 181)},
+        {"navajowhite", PACK_RGB (255, 222, 173)},
+        {"navy", PACK_RGB (0, 0, 128)},
+        {"oldlace", PACK_RGB (253, 245, 230)},
+        {"olive", PACK_RGB (128, 128, 0)},
+        {"olivedrab", PACK_RGB (107, 142, 35)},
+        {"orange", PACK_RGB (255, 165, 0)},
+        {"orangered", PACK_RGB (255, 69, 0)},
+        {"orchid", PACK_RGB (218, 112, 214)},
+        {"palegoldenrod", PACK_RGB (238, 232, 170)},
+        {"palegreen", PACK_RGB (152, 251, 152)},
+        {"paleturquoise", PACK_RGB (175, 238, 238)},
+        {"palevioletred", PACK_RGB (219, 112, 147)},
+        {"papayawhip", PACK_RGB (255, 239, 213)},
+        {"peachpuff", PACK_RGB (255, 218, 185)},
+        {"peru", PACK_RGB (205, 133, 63)},
+        {"pink", PACK_RGB (255, 192, 203)},
+        {"plum", PACK_RGB (221, 160, 221)},
+        {"powderblue", PACK_RGB (176, 224, 230)},
+        {"purple", PACK_RGB (128, 0, 128)},
+        {"red", PACK_RGB (255, 0, 0)},
+        {"rosybrown", PACK_RGB (188, 143, 143)},
+        {"royalblue", PACK_RGB (65, 105, 225)},
+        {"saddlebrown", PACK_RGB (139, 69, 19)},
+        {"salmon", PACK_RGB (250, 128, 114)},
+        {"sandybrown", PACK_RGB (244, 164, 96)},
+        {"seagreen", PACK_RGB (46, 139, 87)},
+        {"seashell", PACK_RGB (255, 245, 238)},
+        {"sienna", PACK_RGB (160, 82, 45)},
+        {"silver", PACK_RGB (192, 192, 192)},
+        {"skyblue", PACK_RGB (135, 206, 235)},
+        {"slateblue", PACK_RGB (106, 90, 205)},
+        {"slategray", PACK_RGB (112, 128, 144)},
+        {"slategrey", PACK_RGB (112, 128, 144)},
+        {"snow", PACK_RGB (255, 250, 250)},
+        {"springgreen", PACK_RGB (0, 255, 127)},
+        {"steelblue", PACK_RGB (70, 130, 180)},
+        {"tan", PACK_RGB (210, 180, 140)},
+        {"teal", PACK_RGB (0, 128, 128)},
+        {"thistle", PACK_RGB (216, 191, 216)},
+        {"tomato", PACK_RGB (255, 99, 71)},
+        {"turquoise", PACK_RGB (64, 224, 208)},
+        {"violet", PACK_RGB (238, 130, 238)},
+        {"wheat", PACK_RGB (245, 222, 179)},
+        {"white", PACK_RGB (255, 255, 255)},
+        {"whitesmoke", PACK_RGB (245, 245, 245)},
+        {"yellow", PACK_RGB (255, 255, 0)},
+        {"yellowgreen", PACK_RGB (154, 205, 50)}
+};
+
+/* A perfect hash of the lowercased names in color_list, generated from
+   the list above; rerun the generator whenever the list changes.  The
+   FNV-1a hash of a name picks a displacement, which with the hash picks
+   a slot in color_slots holding the name's index, or 255 for none. */
+
+#define COLOR_BUCKETS 64
+#define COLOR_SLOTS 256
+#define COLOR_NAME_MAX 20       /* "lightgoldenrodyellow" */
+
+static const guint8 color_displacements[COLOR_BUCKETS] = {
+    0, 0, 0, 1, 1, 1, 1, 0, 0, 0, 0, 0, 8, 1, 2, 0,
+    1, 5, 1, 1, 5, 0, 1, 0, 6, 1, 0, 0, 1, 7, 1, 6,
+    0, 0, 0, 0, 3, 0, 0, 1, 2, 1, 0, 0, 0, 0, 8, 0,
+    3, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 8, 1
+};
+
+static const guint8 color_slots[COLOR_SLOTS] = {
+    130, 255, 255, 115, 88, 5, 61, 143, 93, 54, 255, 255, 255, 255, 255, 98,
+    21, 255, 255, 255, 84, 255, 29, 71, 255, 56, 77, 100, 94, 26, 42, 255,
+    70, 255, 34, 255, 127, 255, 255, 255, 255, 31, 35, 64, 58, 80, 82, 255,
+    255, 114, 16, 255, 48, 95, 255, 11, 255, 62, 19, 52, 255, 255, 51, 46,
+    79, 255, 255, 255, 89, 255, 255, 124, 17, 123, 255, 15, 255, 255, 112, 2,
+    255, 60, 73, 20, 255, 255, 22, 255, 72, 255, 10, 255, 39, 138, 65, 255,
+    255, 117, 75, 14, 145, 255, 23, 255, 255, 59, 255, 255, 137, 255, 68, 255,
+    255, 118, 47, 105, 134, 119, 255, 8, 32, 146, 255, 50, 255, 255, 74, 255,
+    140, 255, 255, 12, 122, 45, 126, 0, 139, 102, 135, 255, 255, 91, 255, 255,
+    255, 37, 49, 255, 255, 3, 132, 78, 106, 255, 133, 6, 255, 255, 69, 255,
+    255, 57, 255, 83, 18, 255, 25, 255, 33, 255, 38, 111, 55, 255, 125, 255,
+    116, 255, 255, 53, 144, 255, 255, 24, 43, 92, 107, 103, 27, 104, 67, 255,
+    255, 255, 4, 255, 141, 40, 13, 131, 255, 255, 28, 44, 86, 255, 255, 255,
+    255, 113, 96, 255, 90, 255, 255, 108, 87, 255, 66, 255, 255, 1, 255, 255,
+    97, 255, 255, 30, 41, 109, 76, 255, 255, 255, 99, 255, 101, 255, 255, 110,
+    9, 142, 36, 81, 121, 120, 255, 85, 7, 128, 255, 63, 129, 255, 136, 255
+};
+
+static const ColorPair *
+rsvg_css_lookup_color_name (const char *str)
 {
-    const char *needle = (const char *) a;
-    const ColorPair *haystack = (const ColorPair *) b;
+    guint32 hash = 2166136261U;
+    const ColorPair *pair;
+    guint slot, index, i;
+
+    for (i = 0; str[i]; i++) {
+        if (i == COLOR_NAME_MAX)
+            return NULL;
+        hash ^= (guint8) g_ascii_tolower (str[i]);
+        hash *= 16777619U;
+    }
+
+    slot = ((hash >> 8) + color_displacements[hash % COLOR_BUCKETS] * ((hash >> 16) | 1))
+        % COLOR_SLOTS;
+    index = color_slots[slot];
+    if (index == 255)
+        return NULL;
 
-    return g_ascii_strcasecmp (needle, haystack->name);
+    pair = &color_list[index];
+    return g_ascii_strcasecmp (str, pair->name) == 0 ? pair : NULL;
 }
 
-/* pack 3 [0,255] ints into one 32 bit one */
-#define PACK_RGB(r,g,b) (((r) << 16) | ((g) << 8) | (b))
+/* Parses the "r, g, b)" following "rgb(", where each component is either
+   a number or a percentage */
+static gboolean
+rsvg_css_parse_rgb_components (const char *str, gint rgb[3])
+{
+    double value;
+    char *end;
+    guint i;
+
+    for (i = 0; i < 3; i++) {
+        while (g_ascii_isspace (*str))
+            str++;
+        if (i > 0 && *str == ',')
+            str++;
+
+        value = _rsvg_css_strtod (str, &end);
+        if (end == str)
+            return FALSE;
+        str = end;
+
+        if (*str == '%') {
+            rgb[i] = rsvg_css_clip_rgb_percent (value);
+            str++;
+        } else if (value >= 255.)
+            rgb[i] = 255;
+        else if (value <= 0.)
+            rgb[i] = 0;
+        else
+            rgb[i] = (gint) value;
+    }
+
+    return TRUE;
+}
 
 /**
  * Parse a CSS2 color specifier, return RGB value
@@ -329,6 +662,7 @@ rsvg_css_color_compare (const void *a, const void *b)
 guint32
 rsvg_css_parse_color (const char *str, gboolean * inherit)
 {
+    const char *rgb_str;
     gint val = 0;
 
     SETINHERIT ();
@@ -354,198 +688,18 @@ rsvg_css_parse_color (const char *str, gboolean * inherit)
         }
     }
     /* i want to use g_str_has_prefix but it isn't in my gstrfuncs.h?? */
-    else if (strstr (str, "rgb") != NULL) {
-        gint r, g, b;
-        r = g = b = 0;
-
-        if (strstr (str, "%") != 0) {
-            guint i, nb_toks;
-            char **toks;
-
-            /* assume rgb (9%, 100%, 23%) */
-            for (i = 0; str[i] != '('; i++);
-
-            i++;
-
-            toks = rsvg_css_parse_list (str + i, &nb_toks);
-
-            if (toks) {
-                if (nb_toks == 3) {
-                    r = rsvg_css_clip_rgb_percent (g_ascii_strtod (toks[0], NULL));
-                    g = rsvg_css_clip_rgb_percent (g_ascii_strtod (toks[1], NULL));
-                    b = rsvg_css_clip_rgb_percent (g_ascii_strtod (toks[2], NULL));
-                }
-
-                g_strfreev (toks);
-            }
-        } else {
-            /* assume "rgb (r, g, b)" */
-            if (3 == sscanf (str, " rgb ( %d , %d , %d ) ", &r, &g, &b)) {
-                r = rsvg_css_clip_rgb (r);
-                g = rsvg_css_clip_rgb (g);
-                b = rsvg_css_clip_rgb (b);
-            } else
-                r = g = b = 0;
-        }
-
-        val = PACK_RGB (r, g, b);
+    else if ((rgb_str = strstr (str, "rgb")) != NULL) {
+        gint rgb[3];
+
+        rgb_str += 3;
+        while (g_ascii_isspace (*rgb_str))
+            rgb_str++;
+        if (*rgb_str == '(' && rsvg_css_parse_rgb_components (rgb_str + 1, rgb))
+            val = PACK_RGB (rgb[0], rgb[1], rgb[2]);
     } else if (!strcmp (str, "inherit"))
         UNSETINHERIT ();
     else {
-        static const ColorPair color_list[] = {
-            {"aliceblue", PACK_RGB (240, 248, 255)},
-            {"antiquewhite", PACK_RGB (250, 235, 215)},
-            {"aqua", PACK_RGB (0, 255, 255)},
-            {"aquamarine", PACK_RGB (127, 255, 212)},
-            {"azure", PACK_RGB (240, 255, 255)},
-            {"beige", PACK_RGB (245, 245, 220)},
-            {"bisque", PACK_RGB (255, 228, 196)},
-            {"black", PACK_RGB (0, 0, 0)},
-            {"blanchedalmond", PACK_RGB (255, 235, 205)},
-            {"blue", PACK_RGB (0, 0, 255)},
-            {"blueviolet", PACK_RGB (138, 43, 226)},
-            {"brown", PACK_RGB (165, 42, 42)},
-            {"burlywood", PACK_RGB (222, 184, 135)},
-            {"cadetblue", PACK_RGB (95, 158, 160)},
-            {"chartreuse", PACK_RGB (127, 255, 0)},
-            {"chocolate", PACK_RGB (210, 105, 30)},
-            {"coral", PACK_RGB (255, 127, 80)},
-            {"cornflowerblue", PACK_RGB (100, 149, 237)},
-            {"cornsilk", PACK_RGB (255, 248, 220)},
-            {"crimson", PACK_RGB (220, 20, 60)},
-            {"cyan", PACK_RGB (0, 255, 255)},
-            {"darkblue", PACK_RGB (0, 0, 139)},
-            {"darkcyan", PACK_RGB (0, 139, 139)},
-            {"darkgoldenrod", PACK_RGB (184, 132, 11)},
-            {"darkgray", PACK_RGB (169, 169, 169)},
-            {"darkgreen", PACK_RGB (0, 100, 0)},
-            {"darkgrey", PACK_RGB (169, 169, 169)},
-            {"darkkhaki", PACK_RGB (189, 183, 107)},
-            {"darkmagenta", PACK_RGB (139, 0, 139)},
-            {"darkolivegreen", PACK_RGB (85, 107, 47)},
-            {"darkorange", PACK_RGB (255, 140, 0)},
-            {"darkorchid", PACK_RGB (153, 50, 204)},
-            {"darkred", PACK_RGB (139, 0, 0)},
-            {"darksalmon", PACK_RGB (233, 150, 122)},
-            {"darkseagreen", PACK_RGB (143, 188, 143)},
-            {"darkslateblue", PACK_RGB (72, 61, 139)},
-            {"darkslategray", PACK_RGB (47, 79, 79)},
-            {"darkslategrey", PACK_RGB (47, 79, 79)},
-            {"darkturquoise", PACK_RGB (0, 206, 209)},
-            {"darkviolet", PACK_RGB (148, 0, 211)},
-            {"deeppink", PACK_RGB (255, 20, 147)},
-            {"deepskyblue", PACK_RGB (0, 191, 255)},
-            {"dimgray", PACK_RGB (105, 105, 105)},
-            {"dimgrey", PACK_RGB (105, 105, 105)},
-            {"dodgerblue", PACK_RGB (30, 144, 255)},
-            {"firebrick", PACK_RGB (178, 34, 34)},
-            {"floralwhite", PACK_RGB (255, 255, 240)},
-            {"forestgreen", PACK_RGB (34, 139, 34)},
-            {"fuchsia", PACK_RGB (255, 0, 255)},
-            {"gainsboro", PACK_RGB (220, 220, 220)},
-            {"ghostwhite", PACK_RGB (248, 248, 255)},
-            {"gold", PACK_RGB (255, 215, 0)},
-            {"goldenrod", PACK_RGB (218, 165, 32)},
-            {"gray", PACK_RGB (128, 128, 128)},
-            {"green", PACK_RGB (0, 128, 0)},
-            {"greenyellow", PACK_RGB (173, 255, 47)},
-            {"grey", PACK_RGB (128, 128, 128)},
-            {"honeydew", PACK_RGB (240, 255, 240)},
-            {"hotpink", PACK_RGB (255, 105, 180)},
-            {"indianred", PACK_RGB (205, 92, 92)},
-            {"indigo", PACK_RGB (75, 0, 130)},
-            {"ivory", PACK_RGB (255, 255, 240)},
-            {"khaki", PACK_RGB (240, 230, 140)},
-            {"lavender", PACK_RGB (230, 230, 250)},
-            {"lavenderblush", PACK_RGB (255, 240, 245)},
-            {"lawngreen", PACK_RGB (124, 252, 0)},
-            {"lemonchiffon", PACK_RGB (255, 250, 205)},
-            {"lightblue", PACK_RGB (173, 216, 230)},
-            {"lightcoral", PACK_RGB (240, 128, 128)},
-            {"lightcyan", PACK_RGB (224, 255, 255)},
-            {"lightgoldenrodyellow", PACK_RGB (250, 250, 210)},
-            {"lightgray", PACK_RGB (211, 211, 211)},
-            {"lightgreen", PACK_RGB (144, 238, 144)},
-            {"lightgrey", PACK_RGB (211, 211, 211)},
-            {"lightpink", PACK_RGB (255, 182, 193)},
-            {"lightsalmon", PACK_RGB (255, 160, 122)},
-            {"lightseagreen", PACK_RGB (32, 178, 170)},
-            {"lightskyblue", PACK_RGB (135, 206, 250)},
-            {"lightslategray", PACK_RGB (119, 136, 153)},
-            {"lightslategrey", PACK_RGB (119, 136, 153)},
-            {"lightsteelblue", PACK_RGB (176, 196, 222)},
-            {"lightyellow", PACK_RGB (255, 255, 224)},
-            {"lime", PACK_RGB (0, 255, 0)},
-            {"limegreen", PACK_RGB (50, 205, 50)},
-            {"linen", PACK_RGB (250, 240, 230)},
-            {"magenta", PACK_RGB (255, 0, 255)},
-            {"maroon", PACK_RGB (128, 0, 0)},
-            {"mediumaquamarine", PACK_RGB (102, 205, 170)},
-            {"mediumblue", PACK_RGB (0, 0, 205)},
-            {"mediumorchid", PACK_RGB (186, 85, 211)},
-            {"mediumpurple", PACK_RGB (147, 112, 219)},
-            {"mediumseagreen", PACK_RGB (60, 179, 113)},
-            {"mediumslateblue", PACK_RGB (123, 104, 238)},
-            {"mediumspringgreen", PACK_RGB (0, 250, 154)},
-            {"mediumturquoise", PACK_RGB (72, 209, 204)},
-            {"mediumvioletred", PACK_RGB (199, 21, 133)},
-            {"midnightblue", PACK_RGB (25, 25, 112)},
-            {"mintcream", PACK_RGB (245, 255, 250)},
-            {"mistyrose", PACK_RGB (255, 228, 225)},
-            {"moccasin", PACK_RGB (255, 228, 181)},
-            {"navajowhite", PACK_RGB (255, 222, 173)},
-            {"navy", PACK_RGB (0, 0, 128)},
-            {"oldlace", PACK_RGB (253, 245, 230)},
-            {"olive", PACK_RGB (128, 128, 0)},
-            {"olivedrab", PACK_RGB (107, 142, 35)},
-            {"orange", PACK_RGB (255, 165, 0)},
-            {"orangered", PACK_RGB (255, 69, 0)},
-            {"orchid", PACK_RGB (218, 112, 214)},
-            {"palegoldenrod", PACK_RGB (238, 232, 170)},
-            {"palegreen", PACK_RGB (152, 251, 152)},
-            {"paleturquoise", PACK_RGB (175, 238, 238)},
-            {"palevioletred", PACK_RGB (219, 112, 147)},
-            {"papayawhip", PACK_RGB (255, 239, 213)},
-            {"peachpuff", PACK_RGB (255, 218, 185)},
-            {"peru", PACK_RGB (205, 133, 63)},
-            {"pink", PACK_RGB (255, 192, 203)},
-            {"plum", PACK_RGB (221, 160, 203)},
-            {"powderblue", PACK_RGB (176, 224, 230)},
-            {"purple", PACK_RGB (128, 0, 128)},
-            {"red", PACK_RGB (255, 0, 0)},
-            {"rosybrown", PACK_RGB (188, 143, 143)},
-            {"royalblue", PACK_RGB (65, 105, 225)},
-            {"saddlebrown", PACK_RGB (139, 69, 19)},
-            {"salmon", PACK_RGB (250, 128, 114)},
-            {"sandybrown", PACK_RGB (244, 164, 96)},
-            {"seagreen", PACK_RGB (46, 139, 87)},
-            {"seashell", PACK_RGB (255, 245, 238)},
-            {"sienna", PACK_RGB (160, 82, 45)},
-            {"silver", PACK_RGB (192, 192, 192)},
-            {"skyblue", PACK_RGB (135, 206, 235)},
-            {"slateblue", PACK_RGB (106, 90, 205)},
-            {"slategray", PACK_RGB (119, 128, 144)},
-            {"slategrey", PACK_RGB (119, 128, 144)},
-            {"snow", PACK_RGB (255, 255, 250)},
-            {"springgreen", PACK_RGB (0, 255, 127)},
-            {"steelblue", PACK_RGB (70, 130, 180)},
-            {"tan", PACK_RGB (210, 180, 140)},
-            {"teal", PACK_RGB (0, 128, 128)},
-            {"thistle", PACK_RGB (216, 191, 216)},
-            {"tomato", PACK_RGB (255, 99, 71)},
-            {"turquoise", PACK_RGB (64, 224, 208)},
-            {"violet", PACK_RGB (238, 130, 238)},
-            {"wheat", PACK_RGB (245, 222, 179)},
-            {"white", PACK_RGB (255, 255, 255)},
-            {"whitesmoke", PACK_RGB (245, 245, 245)},
-            {"yellow", PACK_RGB (255, 255, 0)},
-            {"yellowgreen", PACK_RGB (154, 205, 50)}
-        };
-
-        ColorPair *result = bsearch (str, color_list,
-                                     sizeof (color_list) / sizeof (color_list[0]),
-                                     sizeof (ColorPair),
-                                     rsvg_css_color_compare);
+        const ColorPair *result = rsvg_css_lookup_color_name (str);
 
         /* default to black on failed lookup */
         if (result == NULL) {
@@ -566,7 +720,7 @@ rsvg_css_parse_opacity (const char *str)
     char *end_ptr;
     double opacity;
 
-    opacity = g_ascii_strtod (str, &end_ptr);
+    opacity = _rsvg_css_strtod (str, &end_ptr);
 
     if (end_ptr && end_ptr[0] == '%')
         opacity *= 0.01;
@@ -592,7 +746,7 @@ rsvg_css_parse_angle (const char *str)
     double degrees;
     char *end_ptr;
 
-    degrees = g_ascii_strtod (str, &end_ptr);
+    degrees = _rsvg_css_strtod (str, &end_ptr);
 
     /* todo: error condition - figure out how to best represent it */
     if ((degrees == -HUGE_VAL || degrees == HUGE_VAL) && (ERANGE == errno))
@@ -625,7 +779,7 @@ rsvg_css_parse_frequency (const char *str)
     double f_hz;
     char *end_ptr;
 
-    f_hz = g_ascii_strtod (str, &end_ptr);
+    f_hz = _rsvg_css_strtod (str, &end_ptr);
 
     /* todo: error condition - figure out how to best represent it */
     if ((f_hz == -HUGE_VAL || f_hz == HUGE_VAL) && (ERANGE == errno))
@@ -652,7 +806,7 @@ rsvg_css_parse_time (const char *str)
     double ms;
     char *end_ptr;
 
-    ms = g_ascii_strtod (str, &end_ptr);
+    ms = _rsvg_css_strtod (str, &end_ptr);
 
     /* todo: error condition - figure out how to best represent it */
     if ((ms == -HUGE_VAL || ms == HUGE_VAL) && (ERANGE == errno))
@@ -867,28 +1021,43 @@ rsvg_css_parse_list (const char *in_str, guint * out_list_len)
     return string_array;
 }
 
+#define RSVG_CSS_IS_LIST_SEPARATOR(c) ((c) == ',' || (c) == ' ' || (c) == '\t')
+
+/* Items are separated by runs of commas and blanks, as in rsvg_css_parse_list;
+   counting them first lets the result be allocated once */
 gdouble *
 rsvg_css_parse_number_list (const char *in_str, guint * out_list_len)
 {
-    gchar **string_array;
+    const char *p;
     gdouble *output;
-    guint len, i;
+    guint len = 0, i;
 
     if (out_list_len)
         *out_list_len = 0;
 
-    string_array = rsvg_css_parse_list (in_str, &len);
+    for (p = in_str; *p;) {
+        while (RSVG_CSS_IS_LIST_SEPARATOR (*p))
+            p++;
+        if (*p == '\0')
+            break;
+        len++;
+        while (*p && !RSVG_CSS_IS_LIST_SEPARATOR (*p))
+            p++;
+    }
 
-    if (!(string_array && len))
+    if (len == 0)
         return NULL;
 
     output = g_new (gdouble, len);
 
     /* TODO: some error checking */
-    for (i = 0; i < len; i++)
-        output[i] = g_ascii_strtod (string_array[i], NULL);
-
-    g_strfreev (string_array);
+    for (p = in_str, i = 0; i < len; i++) {
+        while (RSVG_CSS_IS_LIST_SEPARATOR (*p))
+            p++;
+        output[i] = _rsvg_css_strtod (p, NULL);
+        while (*p && !RSVG_CSS_IS_LIST_SEPARATOR (*p))
+            p++;
+    }
 
     if (out_list_len != NULL)
         *out_list_len = len;
@@ -903,14 +1072,14 @@ rsvg_css_parse_number_optional_number (const char *str, double *x, double *y)
 
     /* TODO: some error checking */
 
-    *x = g_ascii_strtod (str, &endptr);
+    *x = _rsvg_css_strtod (str, &endptr);
 
     if (endptr && *endptr != '\0')
         while (g_ascii_isspace (*endptr) && *endptr)
             endptr++;
 
     if (endptr && *endptr)
-        *y = g_ascii_strtod (endptr, NULL);
+        *y = _rsvg_css_strtod (endptr, NULL);
     else
         *y = *x;
 }
@@ -48,6 +48,7 @@ int	    rsvg_css_parse_aspect_ratio	    (const char *str);
 gboolean    rsvg_css_param_match	    (const char *str, const char *param_name);
 int	    rsvg_css_param_arg_offset	    (const char *str);
 
+gdouble	    _rsvg_css_strtod		    (const char *str, char **endptr);
 guint32	    rsvg_css_parse_color	    (const char *str, gboolean * inherit);
 guint	    rsvg_css_parse_opacity	    (const char *str);
 double	    rsvg_css_parse_angle	    (const char *str);
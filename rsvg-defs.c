@@ -27,17 +27,28 @@
 #include "rsvg-defs.h"
 #include "rsvg-styles.h"
 #include "rsvg-image.h"
+#include "rsvg-paint-server.h"
+#include "rsvg-shapes.h"
+#include "rsvg-structure.h"
 
 #include <glib/ghash.h>
 #include <glib/gmem.h>
 #include <glib/gslist.h>
 #include <glib/gstrfuncs.h>
 #include <glib/gmessages.h>
+#include <glib/gstdio.h>
+#include <glib/gthread.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
 
 struct _RsvgDefs {
     GHashTable *hash;
     GPtrArray *unnamed;
     GHashTable *externs;
+    GHashTable *paint_servers;  /* RsvgPaintServer, interned */
+    GHashTable *strings;        /* gchar, interned */
     gchar *base_uri;
     GSList *toresolve;
 };
@@ -57,6 +68,9 @@ rsvg_defs_new (void)
     result->hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
     result->externs =
         g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_object_unref);
+    result->paint_servers =
+        g_hash_table_new_full (rsvg_paint_server_hash, rsvg_paint_server_equal, g_free, NULL);
+    result->strings = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
     result->unnamed = g_ptr_array_new ();
     result->base_uri = NULL;
     result->toresolve = NULL;
@@ -70,15 +84,273 @@ rsvg_defs_set_base_uri (RsvgDefs * self, gchar * base_uri)
     self->base_uri = base_uri;
 }
 
+/* Process-wide cache of parsed external documents, off unless
+   rsvg_set_extern_cache_size is called.  Documents are keyed by canonical
+   path and are only reused while the file keeps the modification time it
+   had when it was parsed. */
+
+typedef struct {
+    gchar *path;
+    time_t mtime;
+    gsize size;                 /* of the parsed document, see rsvg_extern_cache_tree_size */
+    RsvgHandle *handle;
+    guint64 last_used;
+} RsvgExternCacheEntry;
+
+G_LOCK_DEFINE_STATIC (extern_cache);
+static GHashTable *extern_cache = NULL;
+static gsize extern_cache_max_size = 0;
+static gsize extern_cache_size = 0;
+static guint64 extern_cache_clock = 0;
+static guint extern_cache_hits = 0;
+static guint extern_cache_misses = 0;
+
+static void
+rsvg_extern_cache_entry_free (RsvgExternCacheEntry * entry)
+{
+    g_object_unref (entry->handle);
+    g_free (entry->path);
+    g_free (entry);
+}
+
+static void
+rsvg_extern_cache_find_oldest (gpointer key, gpointer value, gpointer user_data)
+{
+    RsvgExternCacheEntry *entry = value;
+    RsvgExternCacheEntry **oldest = user_data;
+
+    if (*oldest == NULL || entry->last_used < (*oldest)->last_used)
+        *oldest = entry;
+}
+
+/* Called with the lock held */
+static void
+rsvg_extern_cache_trim (gsize max_size)
+{
+    RsvgExternCacheEntry *oldest;
+
+    while (extern_cache != NULL && extern_cache_size > max_size) {
+        oldest = NULL;
+        g_hash_table_foreach (extern_cache, rsvg_extern_cache_find_oldest, &oldest);
+        extern_cache_size -= oldest->size;
+        g_hash_table_remove (extern_cache, oldest->path);
+    }
+}
+
+static gchar *
+rsvg_extern_cache_canonical_path (const gchar * filename)
+{
+#ifdef HAVE_REALPATH
+    char *resolved;
+    gchar *path;
+
+    resolved = realpath (filename, NULL);
+    if (resolved == NULL)
+        return NULL;
+    path = g_strdup (resolved);
+    free (resolved);
+    return path;
+#else
+    return g_strdup (filename);
+#endif
+}
+
+/* Memory a parsed document holds: its arena of nodes and states, plus the
+   larger allocations nodes make outside it, which for most documents are
+   the path data, the text and any decoded images.  Small per-node
+   allocations are counted at a flat rate. */
+static gsize
+rsvg_extern_cache_tree_size (RsvgHandle * handle)
+{
+    RsvgDefs *defs = handle->priv->defs;
+    gsize size;
+    guint i;
+
+    size = _rsvg_arena_size (handle->priv->arena);
+
+    for (i = 0; i < defs->unnamed->len; i++) {
+        RsvgNode *node = g_ptr_array_index (defs->unnamed, i);
+
+        size += sizeof (GPtrArray) + node->children->len * sizeof (gpointer);
+
+        switch (node->type) {
+        case RSVG_NODE_TYPE_PATH:
+            if (((RsvgNodePath *) node)->d)
+                size += strlen (((RsvgNodePath *) node)->d) + 1;
+            break;
+        case RSVG_NODE_TYPE_CHARS:
+            size += ((RsvgNodeChars *) node)->contents->allocated_len;
+            break;
+        case RSVG_NODE_TYPE_IMAGE:
+            if (((RsvgNodeImage *) node)->img) {
+                GdkPixbuf *img = ((RsvgNodeImage *) node)->img;
+
+                size += (gsize) gdk_pixbuf_get_rowstride (img) * gdk_pixbuf_get_height (img);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    return size;
+}
+
+static RsvgHandle *
+rsvg_extern_cache_lookup (const gchar * path, time_t mtime)
+{
+    RsvgExternCacheEntry *entry;
+    RsvgHandle *handle = NULL;
+
+    G_LOCK (extern_cache);
+
+    if (extern_cache_max_size > 0) {
+        entry = extern_cache ? g_hash_table_lookup (extern_cache, path) : NULL;
+        if (entry != NULL && entry->mtime == mtime) {
+            entry->last_used = ++extern_cache_clock;
+            handle = g_object_ref (entry->handle);
+            extern_cache_hits++;
+        } else {
+            if (entry != NULL) {
+                extern_cache_size -= entry->size;
+                g_hash_table_remove (extern_cache, path);
+            }
+            extern_cache_misses++;
+        }
+    }
+
+    G_UNLOCK (extern_cache);
+
+    return handle;
+}
+
+static void
+rsvg_extern_cache_insert (const gchar * path, time_t mtime, gsize size, RsvgHandle * handle)
+{
+    RsvgExternCacheEntry *entry;
+
+    G_LOCK (extern_cache);
+
+    if (size <= extern_cache_max_size) {
+        if (extern_cache == NULL)
+            extern_cache = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                                  (GDestroyNotify) rsvg_extern_cache_entry_free);
+
+        /* another thread may have parsed the same file meanwhile */
+        entry = g_hash_table_lookup (extern_cache, path);
+        if (entry != NULL) {
+            extern_cache_size -= entry->size;
+            g_hash_table_remove (extern_cache, path);
+        }
+
+        entry = g_new (RsvgExternCacheEntry, 1);
+        entry->path = g_strdup (path);
+        entry->mtime = mtime;
+        entry->size = size;
+        entry->handle = g_object_ref (handle);
+        entry->last_used = ++extern_cache_clock;
+        g_hash_table_insert (extern_cache, entry->path, entry);
+        extern_cache_size += size;
+
+        rsvg_extern_cache_trim (extern_cache_max_size);
+    }
+
+    G_UNLOCK (extern_cache);
+}
+
+/**
+ * rsvg_set_extern_cache_size:
+ * @max_size: the most bytes of memory the parsed documents may hold, or 0
+ * to disable the cache
+ *
+ * Lets handles share the documents they reference through xlink:href,
+ * such as a symbol library used by many files, instead of each handle
+ * reading and parsing its own copy.  A file is parsed again once its
+ * modification time changes.  The least recently used documents are
+ * dropped to stay within @max_size; the cache is off by default.
+ *
+ * The memory a document holds is estimated from its nodes, path data, text
+ * and decoded images.
+ *
+ * The cache is thread-safe.  A shared document is not modified once it is
+ * parsed, since everything kept while drawing belongs to the drawing, so
+ * handles that reference the same files may be rendered from several
+ * threads at once.
+ *
+ * Since: 2.24
+ **/
+void
+rsvg_set_extern_cache_size (gsize max_size)
+{
+    G_LOCK (extern_cache);
+    extern_cache_max_size = max_size;
+    rsvg_extern_cache_trim (max_size);
+    G_UNLOCK (extern_cache);
+}
+
+/**
+ * rsvg_get_extern_cache_stats:
+ * @hits: return location for the number of documents reused, or %NULL
+ * @misses: return location for the number of documents that had to be
+ * parsed while the cache was on, or %NULL
+ * @n_documents: return location for the number of documents held, or %NULL
+ * @size: return location for the estimated bytes of memory they hold, or
+ * %NULL
+ *
+ * Reports on the cache enabled by rsvg_set_extern_cache_size().
+ *
+ * Since: 2.24
+ **/
+void
+rsvg_get_extern_cache_stats (guint * hits, guint * misses, guint * n_documents, gsize * size)
+{
+    G_LOCK (extern_cache);
+    if (hits)
+        *hits = extern_cache_hits;
+    if (misses)
+        *misses = extern_cache_misses;
+    if (n_documents)
+        *n_documents = extern_cache ? g_hash_table_size (extern_cache) : 0;
+    if (size)
+        *size = extern_cache_size;
+    G_UNLOCK (extern_cache);
+}
+
+void
+rsvg_extern_cache_clear (void)
+{
+    G_LOCK (extern_cache);
+    if (extern_cache != NULL) {
+        g_hash_table_destroy (extern_cache);
+        extern_cache = NULL;
+    }
+    extern_cache_size = 0;
+    G_UNLOCK (extern_cache);
+}
+
 static int
 rsvg_defs_load_extern (const RsvgDefs * defs, const char *name)
 {
     RsvgHandle *handle;
-    gchar *filename, *base_uri;
+    gchar *filename, *base_uri, *path = NULL;
     GByteArray *chars;
+    struct stat st;
 
     filename = rsvg_get_file_path (name, defs->base_uri);
 
+    if (filename != NULL && g_stat (filename, &st) == 0)
+        path = rsvg_extern_cache_canonical_path (filename);
+
+    if (path != NULL) {
+        handle = rsvg_extern_cache_lookup (path, st.st_mtime);
+        if (handle != NULL) {
+            g_hash_table_insert (defs->externs, g_strdup (name), handle);
+            g_free (path);
+            g_free (filename);
+            return 0;
+        }
+    }
+
     chars = _rsvg_acquire_xlink_href_resource (name, defs->base_uri, NULL);
 
     if (chars) {
@@ -91,11 +363,16 @@ rsvg_defs_load_extern (const RsvgDefs * defs, const char *name)
         if (rsvg_handle_write (handle, chars->data, chars->len, NULL) &&
             rsvg_handle_close (handle, NULL)) {
             g_hash_table_insert (defs->externs, g_strdup (name), handle);
-        }
+            if (path != NULL)
+                rsvg_extern_cache_insert (path, st.st_mtime,
+                                          rsvg_extern_cache_tree_size (handle), handle);
+        } else
+            g_object_unref (handle);
 
         g_byte_array_free (chars, TRUE);
     }
 
+    g_free (path);
     g_free (filename);
     return 0;
 }
@@ -120,21 +397,20 @@ rsvg_defs_extern_lookup (const RsvgDefs * defs, const char *filename, const char
 RsvgNode *
 rsvg_defs_lookup (const RsvgDefs * defs, const char *name)
 {
-    char *hashpos;
-    hashpos = g_strrstr (name, "#");
-    if (!hashpos) {
+    const char *hashpos;
+    gchar *filename;
+    RsvgNode *toreturn;
+
+    hashpos = strchr (name, '#');
+    if (!hashpos)
         return NULL;
-    }
-    if (hashpos == name) {
+    if (hashpos == name)
         return (RsvgNode *) g_hash_table_lookup (defs->hash, name + 1);
-    } else {
-        gchar **splitbits;
-        RsvgNode *toreturn;
-        splitbits = g_strsplit (name, "#", 2);
-        toreturn = rsvg_defs_extern_lookup (defs, splitbits[0], splitbits[1]);
-        g_strfreev (splitbits);
-        return toreturn;
-    }
+
+    filename = g_strndup (name, hashpos - name);
+    toreturn = rsvg_defs_extern_lookup (defs, filename, hashpos + 1);
+    g_free (filename);
+    return toreturn;
 }
 
 void
@@ -159,6 +435,39 @@ rsvg_defs_register_memory (RsvgDefs * defs, RsvgNode * val)
     g_ptr_array_add (defs->unnamed, val);
 }
 
+/* Returns the paint server equal to @ps owned by @defs, adding a copy of
+   @ps if there is none yet */
+RsvgPaintServer *
+rsvg_defs_intern_paint_server (const RsvgDefs * defs, const RsvgPaintServer * ps)
+{
+    RsvgPaintServer *interned;
+
+    interned = g_hash_table_lookup (defs->paint_servers, ps);
+    if (interned == NULL) {
+        interned = g_memdup (ps, sizeof (RsvgPaintServer));
+        g_hash_table_insert (defs->paint_servers, interned, interned);
+    }
+    return interned;
+}
+
+/* Returns the copy of @str owned by @defs, so that equal strings parsed
+   into the same document share one pointer and go away with it */
+const char *
+rsvg_defs_intern_string (const RsvgDefs * defs, const char *str)
+{
+    gchar *interned;
+
+    if (str == NULL)
+        return NULL;
+
+    interned = g_hash_table_lookup (defs->strings, str);
+    if (interned == NULL) {
+        interned = g_strdup (str);
+        g_hash_table_insert (defs->strings, interned, interned);
+    }
+    return interned;
+}
+
 void
 rsvg_defs_free (RsvgDefs * defs)
 {
@@ -172,6 +481,8 @@ rsvg_defs_free (RsvgDefs * defs)
     g_ptr_array_free (defs->unnamed, TRUE);
 
     g_hash_table_destroy (defs->externs);
+    g_hash_table_destroy (defs->paint_servers);
+    g_hash_table_destroy (defs->strings);
 
     g_free (defs);
 }
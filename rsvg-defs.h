@@ -41,6 +41,11 @@ void	     rsvg_defs_add_resolver	(RsvgDefs * defs, RsvgNode ** tochange, const g
 void	     rsvg_defs_resolve_all	(RsvgDefs * defs);
 void	     rsvg_defs_register_name	(RsvgDefs * defs, const char *name, RsvgNode * val);
 void	     rsvg_defs_register_memory	(RsvgDefs * defs, RsvgNode * val);
+RsvgPaintServer *rsvg_defs_intern_paint_server (const RsvgDefs * defs,
+						const RsvgPaintServer * ps);
+const char  *rsvg_defs_intern_string	(const RsvgDefs * defs, const char *str);
+
+void	     rsvg_extern_cache_clear	(void);
 
 G_END_DECLS
 #endif
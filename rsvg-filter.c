@@ -56,6 +56,10 @@ struct _RsvgFilterContext {
     GHashTable *results;
     GdkPixbuf *source;
     GdkPixbuf *bg;
+    GdkPixbuf *sourcealpha;
+    GdkPixbuf *bgalpha;
+    RsvgIRect bgbounds;
+    RsvgIRect primitivebounds;
     RsvgFilterPrimitiveOutput lastresult;
     double affine[6];
     double paffine[6];
@@ -443,15 +447,15 @@ rsvg_filter_free_pair (gpointer value)
  * rsvg_filter_render: Copy the source to the bg using a filter.
  * @self: a pointer to the filter to use
  * @source: a pointer to the source pixbuf
- * @bg: the background pixbuf
  * @context: the context
  *
  * This function will create a context for itself, set up the coordinate systems
- * execute all its little primatives and then clean up its own mess
+ * execute all its little primatives and then clean up its own mess.  The
+ * background is only asked for from the renderer if a primitive reads it.
  **/
 GdkPixbuf *
 rsvg_filter_render (RsvgFilter * self, GdkPixbuf * source,
-                    GdkPixbuf * bg, RsvgDrawingCtx * context, RsvgBbox * bounds, char *channelmap)
+                    RsvgDrawingCtx * context, RsvgBbox * bounds, char *channelmap)
 {
     RsvgFilterContext *ctx;
     RsvgFilterPrimitive *current;
@@ -462,7 +466,9 @@ rsvg_filter_render (RsvgFilter * self, GdkPixbuf * source,
     ctx = g_new (RsvgFilterContext, 1);
     ctx->filter = self;
     ctx->source = source;
-    ctx->bg = bg;
+    ctx->bg = NULL;
+    ctx->sourcealpha = NULL;
+    ctx->bgalpha = NULL;
     ctx->results = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, rsvg_filter_free_pair);
     ctx->ctx = context;
 
@@ -482,13 +488,22 @@ rsvg_filter_render (RsvgFilter * self, GdkPixbuf * source,
 
     for (i = 0; i < self->super.children->len; i++) {
         current = g_ptr_array_index (self->super.children, i);
-        if (!strncmp (current->super.type->str, "fe", 2))
+        if (current->super.type >= RSVG_NODE_TYPE_FILTER_PRIMITIVE_FIRST &&
+            current->super.type <= RSVG_NODE_TYPE_FILTER_PRIMITIVE_LAST) {
+            ctx->primitivebounds = rsvg_filter_primitive_get_bounds (current, ctx);
             rsvg_filter_primitive_render (current, ctx);
+        }
     }
 
     out = ctx->lastresult.result;
 
     g_hash_table_destroy (ctx->results);
+    if (ctx->sourcealpha)
+        g_object_unref (G_OBJECT (ctx->sourcealpha));
+    if (ctx->bg)
+        g_object_unref (G_OBJECT (ctx->bg));
+    if (ctx->bgalpha)
+        g_object_unref (G_OBJECT (ctx->bgalpha));
 
     g_free (ctx);
 
@@ -563,6 +578,39 @@ pixbuf_get_alpha (GdkPixbuf * pb, RsvgFilterContext * ctx)
     return output;
 }
 
+/* Asks the renderer for the background covering the subregion of the
+   primitive being rendered.  Like every filter input it is canvas sized,
+   but the pixbuf is only made on first use and the renderer only
+   composites the area asked for; a later primitive that reads outside it
+   has the union composited into the same pixbuf. */
+static GdkPixbuf *
+rsvg_filter_get_bg (RsvgFilterContext * ctx)
+{
+    RsvgIRect region = ctx->primitivebounds;
+
+    if (ctx->bg != NULL) {
+        if (region.x0 >= ctx->bgbounds.x0 && region.y0 >= ctx->bgbounds.y0 &&
+            region.x1 <= ctx->bgbounds.x1 && region.y1 <= ctx->bgbounds.y1)
+            return ctx->bg;
+
+        region.x0 = MIN (region.x0, ctx->bgbounds.x0);
+        region.y0 = MIN (region.y0, ctx->bgbounds.y0);
+        region.x1 = MAX (region.x1, ctx->bgbounds.x1);
+        region.y1 = MAX (region.y1, ctx->bgbounds.y1);
+
+        if (ctx->bgalpha) {
+            g_object_unref (G_OBJECT (ctx->bgalpha));
+            ctx->bgalpha = NULL;
+        }
+    } else
+        ctx->bg = _rsvg_pixbuf_new_cleared (GDK_COLORSPACE_RGB, 1, 8, ctx->width, ctx->height);
+
+    rsvg_get_background (ctx->ctx, region, ctx->bg);
+    ctx->bgbounds = region;
+
+    return ctx->bg;
+}
+
 /**
  * rsvg_filter_get_in: Gets a pixbuf for a primative.
  * @name: The name of the pixbuf
@@ -584,8 +632,8 @@ rsvg_filter_get_result (GString * name, RsvgFilterContext * ctx)
         output.Rused = output.Gused = output.Bused = output.Aused = 1;
         return output;
     } else if (!strcmp (name->str, "BackgroundImage")) {
-        g_object_ref (G_OBJECT (ctx->bg));
-        output.result = ctx->bg;
+        output.result = rsvg_filter_get_bg (ctx);
+        g_object_ref (G_OBJECT (output.result));
         output.Rused = output.Gused = output.Bused = output.Aused = 1;
         return output;
     } else if (!strcmp (name->str, "") || !strcmp (name->str, "none") || !name) {
@@ -593,14 +641,23 @@ rsvg_filter_get_result (GString * name, RsvgFilterContext * ctx)
         output = ctx->lastresult;
         return output;
     } else if (!strcmp (name->str, "SourceAlpha")) {
+        /* The alpha inputs never change during a filter invocation, so
+           they are extracted once and shared by every primitive using them */
+        if (ctx->sourcealpha == NULL)
+            ctx->sourcealpha = pixbuf_get_alpha (ctx->source, ctx);
+        g_object_ref (G_OBJECT (ctx->sourcealpha));
         output.Rused = output.Gused = output.Bused = 0;
         output.Aused = 1;
-        output.result = pixbuf_get_alpha (ctx->source, ctx);
+        output.result = ctx->sourcealpha;
         return output;
     } else if (!strcmp (name->str, "BackgroundAlpha")) {
+        GdkPixbuf *bg = rsvg_filter_get_bg (ctx);
+        if (ctx->bgalpha == NULL)
+            ctx->bgalpha = pixbuf_get_alpha (bg, ctx);
+        g_object_ref (G_OBJECT (ctx->bgalpha));
         output.Rused = output.Gused = output.Bused = 0;
         output.Aused = 1;
-        output.result = pixbuf_get_alpha (ctx->bg, ctx);
+        output.result = ctx->bgalpha;
         return output;
     }
 
@@ -645,7 +702,7 @@ rsvg_filter_parse (const RsvgDefs * defs, const char *str)
         val = rsvg_defs_lookup (defs, name);
         g_free (name);
 
-        if (val && (!strcmp (val->type->str, "filter")))
+        if (val && (val->type == RSVG_NODE_TYPE_FILTER))
             return (RsvgFilter *) val;
     }
     return NULL;
@@ -691,12 +748,12 @@ rsvg_filter_set_args (RsvgNode * self, RsvgHandle * ctx, RsvgPropertyBag * atts)
  * Creates a blank filter and assigns default values to everything
  **/
 RsvgNode *
-rsvg_new_filter (void)
+rsvg_new_filter (RsvgArena * arena)
 {
     RsvgFilter *filter;
 
-    filter = g_new (RsvgFilter, 1);
-    _rsvg_node_init (&filter->super);
+    filter = _rsvg_node_new (RsvgFilter, arena);
+    _rsvg_node_init (&filter->super, arena);
     filter->filterunits = objectBoundingBox;
     filter->primitiveunits = userSpaceOnUse;
     filter->x = _rsvg_css_parse_length ("-10%");
@@ -734,7 +791,6 @@ struct _KingLuluColor {
 
 KingLuluColor kinglulu_set_lum(KingLuluColor c, double l);
 KingLuluColor kinglulu_set_sat(KingLuluColor c, double s);
-int kinglulu_color_cmp(const void *a, const void *b);
 
 #define KINGLULU_DARKEN(cb, cs) MIN(cb, cs)
 #define KINGLULU_MULTIPLY(cb, cs) (cb * cs)
@@ -789,34 +845,108 @@ kinglulu_set_lum(KingLuluColor c, double l)
     return c;
 }
 
-int
-kinglulu_color_cmp(const void *a, const void *b)
-{
-  return (**(const double **)a > **(const double **)b) - (**(const double **)a < **(const double **)b);
-}
-
 KingLuluColor
 kinglulu_set_sat(KingLuluColor c, double s)
 {
-    double *components[3] = {&c.r, &c.g, &c.b};
-    qsort(components, 3, sizeof(components[0]), kinglulu_color_cmp);
-    if (*components[2] > *components[0]) {
-        *components[1] = (((*components[1] - *components[0]) * s) / (*components[2] - *components[0]));
-        *components[2] = s;
+    double *min = &c.r, *mid = &c.g, *max = &c.b, *t;
+
+    // Three compare-and-swaps instead of a qsort call per pixel
+    if (*min > *mid) { t = min; min = mid; mid = t; }
+    if (*mid > *max) { t = mid; mid = max; max = t; }
+    if (*min > *mid) { t = min; min = mid; mid = t; }
+
+    if (*max > *min) {
+        *mid = (((*mid - *min) * s) / (*max - *min));
+        *max = s;
     }
     else
-        *components[1] = *components[2] = 0.0;
-    *components[0] = 0.0;
+        *mid = *max = 0.0;
+    *min = 0.0;
 
     return c;
 }
 // ## KINGLULU FINISHES HERE ##
 
+/* The D(Cb) term of soft light, scaled by 255 * 255 and rounded:
+   ((16 Cb - 12) Cb + 4) Cb for Cb <= 0.25, sqrt (Cb) above */
+static const gint kinglulu_softlight_d[256] = {
+    0, 1008, 1993, 2954, 3892, 4808, 5702, 6574, 7424, 8254,
+    9063, 9852, 10620, 11370, 12100, 12812, 13505, 14180, 14838, 15478,
+    16102, 16709, 17300, 17875, 18435, 18980, 19511, 20027, 20529, 21018,
+    21494, 21957, 22408, 22847, 23274, 23690, 24095, 24490, 24875, 25250,
+    25616, 25972, 26321, 26661, 26993, 27318, 27635, 27946, 28251, 28550,
+    28843, 29131, 29414, 29693, 29968, 30239, 30507, 30772, 31034, 31295,
+    31553, 31810, 32066, 32321, 32576, 32830, 33081, 33331, 33579, 33825,
+    34069, 34311, 34552, 34791, 35029, 35265, 35499, 35732, 35963, 36193,
+    36421, 36648, 36874, 37098, 37321, 37542, 37762, 37981, 38199, 38415,
+    38631, 38845, 39057, 39269, 39480, 39689, 39898, 40105, 40311, 40516,
+    40720, 40923, 41125, 41327, 41527, 41726, 41924, 42121, 42318, 42513,
+    42708, 42901, 43094, 43286, 43477, 43668, 43857, 44046, 44233, 44421,
+    44607, 44792, 44977, 45161, 45344, 45527, 45708, 45889, 46070, 46249,
+    46428, 46606, 46784, 46961, 47137, 47313, 47488, 47662, 47835, 48008,
+    48181, 48353, 48524, 48694, 48864, 49034, 49202, 49371, 49538, 49705,
+    49872, 50038, 50203, 50368, 50532, 50696, 50860, 51022, 51185, 51346,
+    51507, 51668, 51828, 51988, 52147, 52306, 52464, 52622, 52779, 52936,
+    53093, 53249, 53404, 53559, 53714, 53868, 54021, 54175, 54328, 54480,
+    54632, 54783, 54935, 55085, 55236, 55386, 55535, 55684, 55833, 55981,
+    56129, 56276, 56424, 56570, 56717, 56863, 57008, 57154, 57298, 57443,
+    57587, 57731, 57874, 58017, 58160, 58303, 58445, 58586, 58728, 58869,
+    59009, 59150, 59290, 59429, 59569, 59708, 59846, 59985, 60123, 60260,
+    60398, 60535, 60672, 60808, 60944, 61080, 61216, 61351, 61486, 61621,
+    61755, 61889, 62023, 62157, 62290, 62423, 62556, 62688, 62820, 62952,
+    63084, 63215, 63346, 63477, 63607, 63737, 63867, 63997, 64126, 64255,
+    64384, 64513, 64641, 64769, 64897, 65025
+};
+
+/* The separable blend functions B(cb, cs) on 8 bit channels, returning
+   the result scaled by 255 * 255 so that all but the dodge, burn and
+   soft light modes are exact in integers.  Same formulas as the
+   KINGLULU_ macros above. */
+static inline gint
+rsvg_filter_blend_separable (RsvgFilterPrimitiveBlendMode mode, gint b, gint s)
+{
+    switch (mode) {
+    case multiply:
+        return b * s;
+    case screen:
+        return 255 * (b + s) - b * s;
+    case darken:
+        return 255 * MIN (b, s);
+    case lighten:
+        return 255 * MAX (b, s);
+    case softlight:
+        if (2 * s <= 255)
+            return 255 * b - (255 - 2 * s) * b * (255 - b) / 255;
+        return 255 * b + (2 * s - 255) * (kinglulu_softlight_d[b] - 255 * b) / 255;
+    case hardlight:
+        if (2 * s <= 255)
+            return 2 * b * s;
+        return 255 * b + 255 * (2 * s - 255) - b * (2 * s - 255);
+    case colordodge:
+        if (s == 255)
+            return b == 0 ? 0 : 65025;
+        return MIN (65025, 65025 * b / (255 - s));
+    case colorburn:
+        if (s == 0)
+            return b == 255 ? 65025 : 0;
+        return 65025 - MIN (65025, 65025 * (255 - b) / s);
+    case overlay:
+        if (2 * b <= 255)
+            return 2 * s * b;
+        return 255 * s + 255 * (2 * b - 255) - s * (2 * b - 255);
+    case exclusion:
+        return 255 * (s + b) - 2 * s * b;
+    case difference:
+        return 255 * ABS (b - s);
+    default:
+        return 255 * s;
+    }
+}
+
 static void
 rsvg_filter_blend (RsvgFilterPrimitiveBlendMode mode, GdkPixbuf * in, GdkPixbuf * in2,
                    GdkPixbuf * output, RsvgIRect boundarys, int *channelmap)
 {
-    guchar i;
     gint x, y;
     gint rowstride, rowstride2, rowstrideo, height, width;
     guchar *in_pixels;
@@ -835,84 +965,56 @@ rsvg_filter_blend (RsvgFilterPrimitiveBlendMode mode, GdkPixbuf * in, GdkPixbuf
     if (boundarys.x0 < 0)
         boundarys.x0 = 0;
     if (boundarys.y0 < 0)
-        boundarys.y1 = 0;
+        boundarys.y0 = 0;
     if (boundarys.x1 > width)
         boundarys.x1 = width;
     if (boundarys.y1 > height)
         boundarys.y1 = height;
-    
+
     for (y = boundarys.y0; y < boundarys.y1; y++)
         for (x = boundarys.x0; x < boundarys.x1; x++) {
-            double qs, qb, qr;
+            guchar *spix = in_pixels + 4 * x + y * rowstride;
+            guchar *bpix = in2_pixels + 4 * x + y * rowstride2;
+            guchar *opix = output_pixels + 4 * x + y * rowstrideo;
+            gint as, ab;
 
-            qs = (double) in_pixels[4 * x + y * rowstride + channelmap[3]] / 255.0;
-            qb = (double) in2_pixels[4 * x + y * rowstride2 + channelmap[3]] / 255.0;
-            qr = qs + qb - qs * qb;
-            
-            // Separable blend modes
+            as = spix[channelmap[3]];
+            ab = bpix[channelmap[3]];
+
+            // Separable blend modes, in fixed point
             if (mode < hue) {
-                double cs, cb, cr;
                 int ch;
-                
+
                 for (ch = 0; ch < 3; ch++) {
-                    i = channelmap[ch];
-                    cs = (double) in_pixels[4 * x + y * rowstride + i] / 255.0;
-                    cb = (double) in2_pixels[4 * x + y * rowstride2 + i] / 255.0;
-                    switch (mode) {
-                    case multiply:
-                        cr = KINGLULU_MULTIPLY(cb, cs);
-                        break;
-                    case screen:
-                        cr = KINGLULU_SCREEN(cb, cs);
-                        break;
-                    case darken:
-                        cr = KINGLULU_DARKEN(cb, cs);
-                        break;
-                    case lighten:
-                        cr = KINGLULU_LIGHTEN(cb, cs);
-                        break;
-                    case softlight:
-                        cr = KINGLULU_SOFTLIGHT(cb, cs);
-                        break;
-                    case hardlight:
-                        cr = KINGLULU_HARDLIGHT(cb, cs);
-                        break;
-                    case colordodge:
-                        cr = KINGLULU_COLOR_DODGE(cb, cs);
-                        break;
-                    case colorburn:
-                        cr = KINGLULU_COLOR_BURN(cb, cs);
-                        break;
-                    case overlay:
-                        cr = KINGLULU_OVERLAY(cb, cs);
-                        break;
-                    case exclusion:
-                        cr = KINGLULU_EXCLUSION(cb, cs);
-                        break;
-                    case difference:
-                        cr = KINGLULU_DIFFERENCE(cb, cs);
-                        break;
-                    default:
-                        cr = cs;
-                        break;
-                    }
-                    cr = cr * qs * qb + cs * (1 - qb) + cb * (1 - qs);
-                    output_pixels[4 * x + y * rowstrideo + i] = (guchar) CLAMP(cr * 255, 0, 255);
+                    gint i = channelmap[ch];
+                    gint s = spix[i];
+                    gint b = bpix[i];
+                    guint64 cr;
+
+                    /* B * qs * qb + cs * (1 - qb) + cb * (1 - qs), times 255 ^ 3 */
+                    cr = (guint64) rsvg_filter_blend_separable (mode, b, s) * as * ab +
+                        65025 * (guint64) (s * (255 - ab) + b * (255 - as));
+                    cr /= 16581375;
+                    opix[i] = MIN (cr, 255);
                 }
             }
-            
+
             // Non-separable blend modes
             else {
                 KingLuluColor cr, cs, cb;
-                
-                cs.r = (double) in_pixels[4 * x + y * rowstride + channelmap[0]] / 255.0;
-                cs.g = (double) in_pixels[4 * x + y * rowstride + channelmap[1]] / 255.0;
-                cs.b = (double) in_pixels[4 * x + y * rowstride + channelmap[2]] / 255.0;
-                
-                cb.r = (double) in2_pixels[4 * x + y * rowstride + channelmap[0]] / 255.0;
-                cb.g = (double) in2_pixels[4 * x + y * rowstride + channelmap[1]] / 255.0;
-                cb.b = (double) in2_pixels[4 * x + y * rowstride + channelmap[2]] / 255.0;
-                
+                double qs, qb;
+
+                qs = as / 255.0;
+                qb = ab / 255.0;
+
+                cs.r = (double) spix[channelmap[0]] / 255.0;
+                cs.g = (double) spix[channelmap[1]] / 255.0;
+                cs.b = (double) spix[channelmap[2]] / 255.0;
+
+                cb.r = (double) bpix[channelmap[0]] / 255.0;
+                cb.g = (double) bpix[channelmap[1]] / 255.0;
+                cb.b = (double) bpix[channelmap[2]] / 255.0;
+
                 switch (mode) {
                 case hue:
                     cr = KINGLULU_HUE(cb, cs);
@@ -930,17 +1032,18 @@ rsvg_filter_blend (RsvgFilterPrimitiveBlendMode mode, GdkPixbuf * in, GdkPixbuf
                     cr = cs;
                     break;
                 }
-                
+
                 cr.r = cr.r * qs * qb + cs.r * (1 - qb) + cb.r * (1 - qs);
                 cr.g = cr.g * qs * qb + cs.g * (1 - qb) + cb.g * (1 - qs);
                 cr.b = cr.b * qs * qb + cs.b * (1 - qb) + cb.b * (1 - qs);
-                
-                output_pixels[4 * x + y * rowstride + channelmap[0]] = (guchar) CLAMP(cr.r * 255, 0, 255);
-                output_pixels[4 * x + y * rowstride + channelmap[1]] = (guchar) CLAMP(cr.g * 255, 0, 255);
-                output_pixels[4 * x + y * rowstride + channelmap[2]] = (guchar) CLAMP(cr.b * 255, 0, 255);
+
+                opix[channelmap[0]] = (guchar) CLAMP(cr.r * 255, 0, 255);
+                opix[channelmap[1]] = (guchar) CLAMP(cr.g * 255, 0, 255);
+                opix[channelmap[2]] = (guchar) CLAMP(cr.b * 255, 0, 255);
             }
-                        
-            output_pixels[4 * x + y * rowstrideo + channelmap[3]] = (guchar) CLAMP(qr * 255, 0, 255);
+
+            /* qs + qb - qs * qb */
+            opix[channelmap[3]] = (255 * (as + ab) - as * ab) / 255;
         }
 }
 
@@ -1110,11 +1213,11 @@ rsvg_filter_primitive_blend_set_atts (RsvgNode * node, RsvgHandle * ctx, RsvgPro
 }
 
 RsvgNode *
-rsvg_new_filter_primitive_blend (void)
+rsvg_new_filter_primitive_blend (RsvgArena * arena)
 {
     RsvgFilterPrimitiveBlend *filter;
-    filter = g_new (RsvgFilterPrimitiveBlend, 1);
-    _rsvg_node_init (&filter->super.super);
+    filter = _rsvg_node_new (RsvgFilterPrimitiveBlend, arena);
+    _rsvg_node_init (&filter->super.super, arena);
     filter->mode = normal;
     filter->super.in = g_string_new ("none");
     filter->in2 = g_string_new ("none");
@@ -1362,11 +1465,11 @@ rsvg_filter_primitive_convolve_matrix_set_atts (RsvgNode * self,
 }
 
 RsvgNode *
-rsvg_new_filter_primitive_convolve_matrix (void)
+rsvg_new_filter_primitive_convolve_matrix (RsvgArena * arena)
 {
     RsvgFilterPrimitiveConvolveMatrix *filter;
-    filter = g_new (RsvgFilterPrimitiveConvolveMatrix, 1);
-    _rsvg_node_init (&filter->super.super);
+    filter = _rsvg_node_new (RsvgFilterPrimitiveConvolveMatrix, arena);
+    _rsvg_node_init (&filter->super.super, arena);
     filter->super.in = g_string_new ("none");
     filter->super.result = g_string_new ("none");
     filter->super.x.factor = filter->super.y.factor = filter->super.width.factor =
@@ -1394,6 +1497,24 @@ struct _RsvgFilterPrimitiveGaussianBlur {
     double sdx, sdy;
 };
 
+/* Alpha-only inputs such as SourceAlpha leave their colour channels
+   zeroed, so consumers that honour these flags only need to process
+   the one channel that carries data. */
+static gboolean
+rsvg_filter_output_channel_used (const RsvgFilterPrimitiveOutput * op, gint ch)
+{
+    switch (ch) {
+    case 0:
+        return op->Rused;
+    case 1:
+        return op->Gused;
+    case 2:
+        return op->Bused;
+    default:
+        return op->Aused;
+    }
+}
+
 static void
 box_blur (GdkPixbuf * in, GdkPixbuf * output, guchar * intermediate, gint kw,
           gint kh, RsvgIRect boundarys, RsvgFilterPrimitiveOutput op)
@@ -1425,20 +1546,8 @@ box_blur (GdkPixbuf * in, GdkPixbuf * output, guchar * intermediate, gint kw,
 
     if (kw >= 1) {
         for (ch = 0; ch < 4; ch++) {
-            switch (ch) {
-            case 0:
-                if (!op.Rused)
-                    continue;
-            case 1:
-                if (!op.Gused)
-                    continue;
-            case 2:
-                if (!op.Bused)
-                    continue;
-            case 3:
-                if (!op.Aused)
-                    continue;
-            }
+            if (!rsvg_filter_output_channel_used (&op, ch))
+                continue;
             for (y = boundarys.y0; y < boundarys.y1; y++) {
                 sum = 0;
                 for (x = boundarys.x0; x < boundarys.x0 + kw; x++) {
@@ -1465,20 +1574,8 @@ box_blur (GdkPixbuf * in, GdkPixbuf * output, guchar * intermediate, gint kw,
 
     if (kh >= 1) {
         for (ch = 0; ch < 4; ch++) {
-            switch (ch) {
-            case 0:
-                if (!op.Rused)
-                    continue;
-            case 1:
-                if (!op.Gused)
-                    continue;
-            case 2:
-                if (!op.Bused)
-                    continue;
-            case 3:
-                if (!op.Aused)
-                    continue;
-            }
+            if (!rsvg_filter_output_channel_used (&op, ch))
+                continue;
 
 
             for (x = boundarys.x0; x < boundarys.x1; x++) {
@@ -1603,11 +1700,11 @@ rsvg_filter_primitive_gaussian_blur_set_atts (RsvgNode * self,
 }
 
 RsvgNode *
-rsvg_new_filter_primitive_gaussian_blur (void)
+rsvg_new_filter_primitive_gaussian_blur (RsvgArena * arena)
 {
     RsvgFilterPrimitiveGaussianBlur *filter;
-    filter = g_new (RsvgFilterPrimitiveGaussianBlur, 1);
-    _rsvg_node_init (&filter->super.super);
+    filter = _rsvg_node_new (RsvgFilterPrimitiveGaussianBlur, arena);
+    _rsvg_node_init (&filter->super.super, arena);
     filter->super.in = g_string_new ("none");
     filter->super.result = g_string_new ("none");
     filter->super.x.factor = filter->super.y.factor = filter->super.width.factor =
@@ -1633,8 +1730,8 @@ struct _RsvgFilterPrimitiveOffset {
 static void
 rsvg_filter_primitive_offset_render (RsvgFilterPrimitive * self, RsvgFilterContext * ctx)
 {
-    guchar ch;
-    gint x, y;
+    gint y;
+    gint x0, y0, x1, y1;
     gint rowstride, height, width;
     RsvgIRect boundarys;
 
@@ -1653,7 +1750,8 @@ rsvg_filter_primitive_offset_render (RsvgFilterPrimitive * self, RsvgFilterConte
     upself = (RsvgFilterPrimitiveOffset *) self;
     boundarys = rsvg_filter_primitive_get_bounds (self, ctx);
 
-    in = rsvg_filter_get_in (self->in, ctx);
+    out = rsvg_filter_get_result (self->in, ctx);
+    in = out.result;
     in_pixels = gdk_pixbuf_get_pixels (in);
 
     height = gdk_pixbuf_get_height (in);
@@ -1671,24 +1769,20 @@ rsvg_filter_primitive_offset_render (RsvgFilterPrimitive * self, RsvgFilterConte
     ox = ctx->paffine[0] * dx + ctx->paffine[2] * dy;
     oy = ctx->paffine[1] * dx + ctx->paffine[3] * dy;
 
-    for (y = boundarys.y0; y < boundarys.y1; y++)
-        for (x = boundarys.x0; x < boundarys.x1; x++) {
-            if (x - ox < boundarys.x0 || x - ox >= boundarys.x1)
-                continue;
-            if (y - oy < boundarys.y0 || y - oy >= boundarys.y1)
-                continue;
+    /* Only the part of the subregion whose source is also inside it gets
+       written, and that part is a plain rectangular copy */
+    x0 = MAX (boundarys.x0, boundarys.x0 + ox);
+    x1 = MIN (boundarys.x1, boundarys.x1 + ox);
+    y0 = MAX (boundarys.y0, boundarys.y0 + oy);
+    y1 = MIN (boundarys.y1, boundarys.y1 + oy);
 
-            for (ch = 0; ch < 4; ch++) {
-                output_pixels[y * rowstride + x * 4 + ch] =
-                    in_pixels[(y - oy) * rowstride + (x - ox) * 4 + ch];
-            }
-        }
+    if (x1 > x0)
+        for (y = y0; y < y1; y++)
+            memcpy (output_pixels + y * rowstride + x0 * 4,
+                    in_pixels + (y - oy) * rowstride + (x0 - ox) * 4, (x1 - x0) * 4);
 
+    /* Moving pixels around doesn't change which channels carry data */
     out.result = output;
-    out.Rused = 1;
-    out.Gused = 1;
-    out.Bused = 1;
-    out.Aused = 1;
     out.bounds = boundarys;
 
     rsvg_filter_store_output (self->result, out, ctx);
@@ -1739,11 +1833,11 @@ rsvg_filter_primitive_offset_set_atts (RsvgNode * self, RsvgHandle * ctx, RsvgPr
 }
 
 RsvgNode *
-rsvg_new_filter_primitive_offset (void)
+rsvg_new_filter_primitive_offset (RsvgArena * arena)
 {
     RsvgFilterPrimitiveOffset *filter;
-    filter = g_new (RsvgFilterPrimitiveOffset, 1);
-    _rsvg_node_init (&filter->super.super);
+    filter = _rsvg_node_new (RsvgFilterPrimitiveOffset, arena);
+    _rsvg_node_init (&filter->super.super, arena);
     filter->super.in = g_string_new ("none");
     filter->super.result = g_string_new ("none");
     filter->super.x.factor = filter->super.y.factor = filter->super.width.factor =
@@ -1768,30 +1862,75 @@ struct _RsvgFilterPrimitiveMerge {
 static void
 rsvg_filter_primitive_merge_render (RsvgFilterPrimitive * self, RsvgFilterContext * ctx)
 {
-    guint i;
+    guint i, n;
+    gint x, y, rowstride;
     RsvgIRect boundarys;
 
     RsvgFilterPrimitiveMerge *upself;
 
     GdkPixbuf *output;
-    GdkPixbuf *in;
+    GPtrArray *inputs;
+    guchar *output_pixels;
+    guchar **in_pixels;
 
     upself = (RsvgFilterPrimitiveMerge *) self;
     boundarys = rsvg_filter_primitive_get_bounds (self, ctx);
 
     output = _rsvg_pixbuf_new_cleared (GDK_COLORSPACE_RGB, 1, 8, ctx->width, ctx->height);
+    output_pixels = gdk_pixbuf_get_pixels (output);
+    rowstride = gdk_pixbuf_get_rowstride (output);
 
+    inputs = g_ptr_array_new ();
     for (i = 0; i < upself->super.super.children->len; i++) {
         RsvgFilterPrimitive *mn;
         mn = g_ptr_array_index (upself->super.super.children, i);
-        if (strcmp (mn->super.type->str, "feMergeNode"))
+        if (mn->super.type != RSVG_NODE_TYPE_FILTER_PRIMITIVE_MERGE_NODE)
             continue;
-        in = rsvg_filter_get_in (mn->in, ctx);
-        rsvg_alpha_blt (in, boundarys.x0, boundarys.y0, boundarys.x1 - boundarys.x0,
-                        boundarys.y1 - boundarys.y0, output, boundarys.x0, boundarys.y0);
-        g_object_unref (G_OBJECT (in));
+        g_ptr_array_add (inputs, rsvg_filter_get_in (mn->in, ctx));
     }
 
+    n = inputs->len;
+    in_pixels = g_new (guchar *, MAX (n, 1));
+    for (i = 0; i < n; i++)
+        in_pixels[i] = gdk_pixbuf_get_pixels (g_ptr_array_index (inputs, i));
+
+    /* Composite all the nodes in a single pass over the subregion, doing
+       the same "over" arithmetic as a chain of rsvg_alpha_blt calls */
+    for (y = boundarys.y0; y < boundarys.y1; y++)
+        for (x = boundarys.x0; x < boundarys.x1; x++) {
+            guint offset = y * rowstride + x * 4;
+            guint r = 0, g = 0, b = 0, ar = 0;
+
+            for (i = 0; i < n; i++) {
+                guchar *pix = in_pixels[i] + offset;
+                guint a = pix[3];
+
+                if (!a)
+                    continue;
+                if (a == 255) {
+                    r = pix[0];
+                    g = pix[1];
+                    b = pix[2];
+                    ar = 255;
+                } else {
+                    r = pix[0] + r * (255 - a) / 255;
+                    g = pix[1] + g * (255 - a) / 255;
+                    b = pix[2] + b * (255 - a) / 255;
+                    ar = a + ar * (255 - a) / 255;
+                }
+            }
+
+            output_pixels[offset] = r;
+            output_pixels[offset + 1] = g;
+            output_pixels[offset + 2] = b;
+            output_pixels[offset + 3] = ar;
+        }
+
+    for (i = 0; i < n; i++)
+        g_object_unref (G_OBJECT (g_ptr_array_index (inputs, i)));
+    g_ptr_array_free (inputs, TRUE);
+    g_free (in_pixels);
+
     rsvg_filter_store_result (self->result, output, ctx);
 
     g_object_unref (G_OBJECT (output));
@@ -1833,11 +1972,11 @@ rsvg_filter_primitive_merge_set_atts (RsvgNode * self, RsvgHandle * ctx, RsvgPro
 }
 
 RsvgNode *
-rsvg_new_filter_primitive_merge (void)
+rsvg_new_filter_primitive_merge (RsvgArena * arena)
 {
     RsvgFilterPrimitiveMerge *filter;
-    filter = g_new (RsvgFilterPrimitiveMerge, 1);
-    _rsvg_node_init (&filter->super.super);
+    filter = _rsvg_node_new (RsvgFilterPrimitiveMerge, arena);
+    _rsvg_node_init (&filter->super.super, arena);
     filter->super.result = g_string_new ("none");
     filter->super.x.factor = filter->super.y.factor = filter->super.width.factor =
         filter->super.height.factor = 'n';
@@ -1877,11 +2016,11 @@ rsvg_filter_primitive_merge_node_render (RsvgFilterPrimitive * self, RsvgFilterC
 }
 
 RsvgNode *
-rsvg_new_filter_primitive_merge_node (void)
+rsvg_new_filter_primitive_merge_node (RsvgArena * arena)
 {
     RsvgFilterPrimitive *filter;
-    filter = g_new (RsvgFilterPrimitive, 1);
-    _rsvg_node_init (&filter->super);
+    filter = _rsvg_node_new (RsvgFilterPrimitive, arena);
+    _rsvg_node_init (&filter->super, arena);
     filter->in = g_string_new ("none");
     filter->super.free = rsvg_filter_primitive_merge_node_free;
     filter->render = &rsvg_filter_primitive_merge_node_render;
@@ -1900,12 +2039,135 @@ struct _RsvgFilterPrimitiveColourMatrix {
     gint *KernelMatrix;
 };
 
+/* Products of a matrix coefficient and an 8 bit channel stay below 2^24
+   as long as the coefficients do, and in that range multiplying by
+   2^40 / d + 1 and shifting gives exactly the truncated quotient for any
+   divisor d up to 255.  This lets a pixel pay for one division instead of
+   one per matrix term. */
+#define COLOUR_MATRIX_MAX_COEFF 65535
+#define COLOUR_MATRIX_RECIP_SHIFT 40
+
+static inline gint
+colour_matrix_div (gint n, guint64 recip)
+{
+    if (n >= 0)
+        return (gint) (((guint64) n * recip) >> COLOUR_MATRIX_RECIP_SHIFT);
+    else
+        return -(gint) (((guint64) - n * recip) >> COLOUR_MATRIX_RECIP_SHIFT);
+}
+
+static inline guchar
+colour_matrix_clamp (gint sum)
+{
+    if (sum > 255)
+        return 255;
+    if (sum < 0)
+        return 0;
+    return sum;
+}
+
+/* Reorders a kernel into pixbuf byte order, so the inner loop doesn't go
+   through the channel map for every term, and works out which shortcuts
+   the render loop may take */
+static void
+colour_matrix_prepare (const gint * kernel, const gint * channelmap, gint matrix[4][5],
+                       gboolean * identity, gboolean * alpha_only, gboolean * exact_recip)
+{
+    gint i, j;
+
+    *identity = TRUE;
+    *alpha_only = TRUE;
+    *exact_recip = TRUE;
+    for (j = 0; j < 4; j++) {
+        gint row = channelmap[j];
+        for (i = 0; i < 4; i++) {
+            gint k = kernel[j * 5 + i];
+            matrix[row][channelmap[i]] = k;
+            if (k != (i == j ? 255 : 0))
+                *identity = FALSE;
+            if (j != 3 && k != 0)
+                *alpha_only = FALSE;
+            if (k > COLOUR_MATRIX_MAX_COEFF || k < -COLOUR_MATRIX_MAX_COEFF)
+                *exact_recip = FALSE;
+        }
+        matrix[row][4] = kernel[j * 5 + 4];
+        if (matrix[row][4] != 0)
+            *identity = FALSE;
+    }
+}
+
+/* What a fully transparent input pixel turns into */
+static void
+colour_matrix_transparent (gint matrix[4][5], gint achan, guchar * outpix)
+{
+    gint j;
+
+    for (j = 0; j < 4; j++)
+        outpix[j] = colour_matrix_clamp (matrix[j][4]);
+    for (j = 0; j < 4; j++)
+        if (j != achan)
+            outpix[j] = outpix[j] * outpix[achan] / 255;
+}
+
+/* @recip must be 2^COLOUR_MATRIX_RECIP_SHIFT / alpha + 1 for the pixel's
+   non-zero alpha; it is only used when @exact_recip is set */
+static inline void
+colour_matrix_pixel (gint matrix[4][5], gint achan, gboolean alpha_only,
+                     gboolean exact_recip, guint64 recip, const guchar * inpix, guchar * outpix)
+{
+    gint i, j;
+    gint alpha = inpix[achan];
+    gint newalpha;
+
+    for (j = 0; j < 4; j++) {
+        gint sum;
+
+        if (alpha_only && j != achan) {
+            outpix[j] = colour_matrix_clamp (matrix[j][4]);
+            continue;
+        }
+
+        sum = matrix[j][4] + matrix[j][achan] * alpha / 255;
+        for (i = 0; i < 4; i++) {
+            if (i == achan)
+                continue;
+            if (exact_recip)
+                sum += colour_matrix_div (matrix[j][i] * inpix[i], recip);
+            else
+                sum += matrix[j][i] * inpix[i] / alpha;
+        }
+        outpix[j] = colour_matrix_clamp (sum);
+    }
+
+    newalpha = outpix[achan];
+    for (j = 0; j < 4; j++)
+        if (j != achan)
+            outpix[j] = outpix[j] * newalpha / 255;
+}
+
+/* Entry point for the unit tests: runs one RGBA pixel through @kernel
+   the way the render loop does, identity kernels included */
+void
+_rsvg_filter_colour_matrix_pixel (const gint * kernel, const guchar * inpix, guchar * outpix)
+{
+    static const gint channelmap[4] = { 0, 1, 2, 3 };
+    gint matrix[4][5];
+    gboolean identity, alpha_only, exact_recip;
+
+    colour_matrix_prepare (kernel, channelmap, matrix, &identity, &alpha_only, &exact_recip);
+    if (!inpix[3])
+        colour_matrix_transparent (matrix, 3, outpix);
+    else
+        colour_matrix_pixel (matrix, 3, alpha_only, exact_recip,
+                             (G_GUINT64_CONSTANT (1) << COLOUR_MATRIX_RECIP_SHIFT) / inpix[3] + 1,
+                             inpix, outpix);
+}
+
 static void
 rsvg_filter_primitive_colour_matrix_render (RsvgFilterPrimitive * self, RsvgFilterContext * ctx)
 {
-    guchar ch;
     gint x, y;
-    gint i;
+    gint j;
     gint rowstride, height, width;
     RsvgIRect boundarys;
 
@@ -1917,11 +2179,18 @@ rsvg_filter_primitive_colour_matrix_render (RsvgFilterPrimitive * self, RsvgFilt
     GdkPixbuf *output;
     GdkPixbuf *in;
 
-    int sum;
+    gint matrix[4][5];
+    gint achan = ctx->channelmap[3];
+    gboolean identity, alpha_only, exact_recip;
+    guchar transparent[4];
 
     upself = (RsvgFilterPrimitiveColourMatrix *) self;
     boundarys = rsvg_filter_primitive_get_bounds (self, ctx);
 
+    colour_matrix_prepare (upself->KernelMatrix, ctx->channelmap, matrix,
+                           &identity, &alpha_only, &exact_recip);
+    colour_matrix_transparent (matrix, achan, transparent);
+
     in = rsvg_filter_get_in (self->in, ctx);
     in_pixels = gdk_pixbuf_get_pixels (in);
 
@@ -1933,51 +2202,40 @@ rsvg_filter_primitive_colour_matrix_render (RsvgFilterPrimitive * self, RsvgFilt
     output = _rsvg_pixbuf_new_cleared (GDK_COLORSPACE_RGB, 1, 8, width, height);
     output_pixels = gdk_pixbuf_get_pixels (output);
 
-    for (y = boundarys.y0; y < boundarys.y1; y++)
-        for (x = boundarys.x0; x < boundarys.x1; x++) {
-            int umch;
-            int alpha = in_pixels[4 * x + y * rowstride + ctx->channelmap[3]];
-            if (!alpha)
-                for (umch = 0; umch < 4; umch++) {
-                    sum = upself->KernelMatrix[umch * 5 + 4];
-                    if (sum > 255)
-                        sum = 255;
-                    if (sum < 0)
-                        sum = 0;
-                    output_pixels[4 * x + y * rowstride + ctx->channelmap[umch]] = sum;
-            } else
-                for (umch = 0; umch < 4; umch++) {
-                    int umi;
-                    ch = ctx->channelmap[umch];
-                    sum = 0;
-                    for (umi = 0; umi < 4; umi++) {
-                        i = ctx->channelmap[umi];
-                        if (umi != 3)
-                            sum += upself->KernelMatrix[umch * 5 + umi] *
-                                in_pixels[4 * x + y * rowstride + i] / alpha;
-                        else
-                            sum += upself->KernelMatrix[umch * 5 + umi] *
-                                in_pixels[4 * x + y * rowstride + i] / 255;
-                    }
-                    sum += upself->KernelMatrix[umch * 5 + 4];
+    if (identity) {
+        if (boundarys.x1 > boundarys.x0)
+            for (y = boundarys.y0; y < boundarys.y1; y++)
+                memcpy (output_pixels + y * rowstride + boundarys.x0 * 4,
+                        in_pixels + y * rowstride + boundarys.x0 * 4,
+                        (boundarys.x1 - boundarys.x0) * 4);
+        goto out;
+    }
 
+    for (y = boundarys.y0; y < boundarys.y1; y++) {
+        gint last_alpha = -1;
+        guint64 recip = 0;
 
+        for (x = boundarys.x0; x < boundarys.x1; x++) {
+            guchar *inpix = in_pixels + y * rowstride + x * 4;
+            guchar *outpix = output_pixels + y * rowstride + x * 4;
+            gint alpha = inpix[achan];
 
-                    if (sum > 255)
-                        sum = 255;
-                    if (sum < 0)
-                        sum = 0;
+            if (!alpha) {
+                for (j = 0; j < 4; j++)
+                    outpix[j] = transparent[j];
+                continue;
+            }
 
-                    output_pixels[4 * x + y * rowstride + ch] = sum;
-                }
-            for (umch = 0; umch < 3; umch++) {
-                ch = ctx->channelmap[umch];
-                output_pixels[4 * x + y * rowstride + ch] =
-                    output_pixels[4 * x + y * rowstride + ch] *
-                    output_pixels[4 * x + y * rowstride + ctx->channelmap[3]] / 255;
+            if (alpha != last_alpha) {
+                last_alpha = alpha;
+                recip = (G_GUINT64_CONSTANT (1) << COLOUR_MATRIX_RECIP_SHIFT) / alpha + 1;
             }
+
+            colour_matrix_pixel (matrix, achan, alpha_only, exact_recip, recip, inpix, outpix);
         }
+    }
 
+  out:
     rsvg_filter_store_result (self->result, output, ctx);
 
     g_object_unref (G_OBJECT (in));
@@ -2111,11 +2369,11 @@ rsvg_filter_primitive_colour_matrix_set_atts (RsvgNode * self, RsvgHandle * ctx,
 }
 
 RsvgNode *
-rsvg_new_filter_primitive_colour_matrix (void)
+rsvg_new_filter_primitive_colour_matrix (RsvgArena * arena)
 {
     RsvgFilterPrimitiveColourMatrix *filter;
-    filter = g_new (RsvgFilterPrimitiveColourMatrix, 1);
-    _rsvg_node_init (&filter->super.super);
+    filter = _rsvg_node_new (RsvgFilterPrimitiveColourMatrix, arena);
+    _rsvg_node_init (&filter->super.super, arena);
     filter->super.in = g_string_new ("none");
     filter->super.result = g_string_new ("none");
     filter->super.x.factor = filter->super.y.factor = filter->super.width.factor =
@@ -2173,6 +2431,8 @@ table_component_transfer_func (gint C, RsvgNodeComponentTransferFunc * user_data
     k = (C * (user_data->nbTableValues - 1)) / 255;
 
     vk = user_data->tableValues[k];
+    if (k + 1 >= user_data->nbTableValues)
+        return vk;
     vk1 = user_data->tableValues[k + 1];
 
     distancefromlast = (C * (user_data->nbTableValues - 1)) - k * 255;
@@ -2189,6 +2449,8 @@ discrete_component_transfer_func (gint C, RsvgNodeComponentTransferFunc * user_d
         return C;
 
     k = (C * user_data->nbTableValues) / 255;
+    if (k >= user_data->nbTableValues)
+        k = user_data->nbTableValues - 1;
 
     return user_data->tableValues[k];
 }
@@ -2218,18 +2480,52 @@ gamma_component_transfer_func (gint C, RsvgNodeComponentTransferFunc * user_data
                                                     user_data->exponent) + user_data->offset;
 }
 
+/* Evaluates a transfer function for every possible 8 bit input, so that
+   the render loop only has to do a table lookup per channel. */
+static gboolean
+component_transfer_build_lut (ComponentTransferFunc function,
+                              RsvgNodeComponentTransferFunc * data, guchar * lut)
+{
+    gint i, temp;
+    gboolean identity = TRUE;
+
+    for (i = 0; i < 256; i++) {
+        temp = function (i, data);
+        if (temp > 255)
+            temp = 255;
+        else if (temp < 0)
+            temp = 0;
+        lut[i] = temp;
+        if (temp != i)
+            identity = FALSE;
+    }
+
+    return identity;
+}
+
+/* Entry point for the unit tests, which check the table built for a
+   parsed feFuncX node against the transfer functions themselves */
+gboolean
+_rsvg_filter_component_transfer_lut (RsvgNode * func, guchar lut[256])
+{
+    RsvgNodeComponentTransferFunc *data = (RsvgNodeComponentTransferFunc *) func;
+
+    return component_transfer_build_lut (data->function, data, lut);
+}
+
 static void
 rsvg_filter_primitive_component_transfer_render (RsvgFilterPrimitive *
                                                  self, RsvgFilterContext * ctx)
 {
     gint x, y, c;
     guint i;
-    gint temp;
     gint rowstride, height, width;
     RsvgIRect boundarys;
     RsvgNodeComponentTransferFunc *channels[4];
     ComponentTransferFunc functions[4];
-    guchar *inpix, outpix[4];
+    guchar luts[4][256];
+    gboolean identity;
+    guchar *inpix, *outpix;
     gint achan = ctx->channelmap[3];
     guchar *in_pixels;
     guchar *output_pixels;
@@ -2242,23 +2538,28 @@ rsvg_filter_primitive_component_transfer_render (RsvgFilterPrimitive *
     boundarys = rsvg_filter_primitive_get_bounds (self, ctx);
 
     for (c = 0; c < 4; c++) {
-        char channel = "RGBA"[c];
+        functions[c] = identity_component_transfer_func;
+        channels[c] = NULL;
+    }
+
+    for (c = 0; c < 4; c++) {
         for (i = 0; i < self->super.children->len; i++) {
             RsvgNodeComponentTransferFunc *temp;
             temp = (RsvgNodeComponentTransferFunc *)
                 g_ptr_array_index (self->super.children, i);
-            if (!strncmp (temp->super.type->str, "feFunc", 6))
-                if (temp->super.type->str[6] == channel) {
-                    functions[ctx->channelmap[c]] = temp->function;
-                    channels[ctx->channelmap[c]] = temp;
-                    break;
-                }
+            if (temp->super.type == RSVG_NODE_TYPE_COMPONENT_TRANSFER_FUNCTION_R + c) {
+                functions[ctx->channelmap[c]] = temp->function;
+                channels[ctx->channelmap[c]] = temp;
+                break;
+            }
         }
-        if (i == self->super.children->len)
-            functions[c] = identity_component_transfer_func;
-
     }
 
+    identity = TRUE;
+    for (c = 0; c < 4; c++)
+        if (!component_transfer_build_lut (functions[c], channels[c], luts[c]))
+            identity = FALSE;
+
     in = rsvg_filter_get_in (self->in, ctx);
     in_pixels = gdk_pixbuf_get_pixels (in);
 
@@ -2271,31 +2572,43 @@ rsvg_filter_primitive_component_transfer_render (RsvgFilterPrimitive *
 
     output_pixels = gdk_pixbuf_get_pixels (output);
 
-    for (y = boundarys.y0; y < boundarys.y1; y++)
-        for (x = boundarys.x0; x < boundarys.x1; x++) {
-            inpix = in_pixels + (y * rowstride + x * 4);
-            for (c = 0; c < 4; c++) {
-                int inval;
-                if (c != achan) {
-                    if (inpix[achan] == 0)
+    if (identity) {
+        /* Nothing to transfer, skip the unpremultiply round trip */
+        if (boundarys.x1 > boundarys.x0)
+            for (y = boundarys.y0; y < boundarys.y1; y++)
+                memcpy (output_pixels + y * rowstride + boundarys.x0 * 4,
+                        in_pixels + y * rowstride + boundarys.x0 * 4,
+                        (boundarys.x1 - boundarys.x0) * 4);
+    } else {
+        for (y = boundarys.y0; y < boundarys.y1; y++)
+            for (x = boundarys.x0; x < boundarys.x1; x++) {
+                gint alpha, newalpha;
+
+                inpix = in_pixels + y * rowstride + x * 4;
+                outpix = output_pixels + y * rowstride + x * 4;
+                alpha = inpix[achan];
+                newalpha = luts[achan][alpha];
+
+                for (c = 0; c < 3; c++) {
+                    gint chan = ctx->channelmap[c];
+                    gint inval;
+
+                    if (alpha == 255)
+                        inval = inpix[chan];
+                    else if (alpha == 0)
                         inval = 0;
-                    else
-                        inval = inpix[c] * 255 / inpix[achan];
-                } else
-                    inval = inpix[c];
-
-                temp = functions[c] (inval, channels[c]);
-                if (temp > 255)
-                    temp = 255;
-                else if (temp < 0)
-                    temp = 0;
-                outpix[c] = temp;
+                    else {
+                        inval = inpix[chan] * 255 / alpha;
+                        if (inval > 255)
+                            inval = 255;
+                    }
+
+                    outpix[chan] = luts[chan][inval] * newalpha / 255;
+                }
+                outpix[achan] = newalpha;
             }
-            for (c = 0; c < 3; c++)
-                output_pixels[y * rowstride + x * 4 + ctx->channelmap[c]] =
-                    outpix[ctx->channelmap[c]] * outpix[achan] / 255;
-            output_pixels[y * rowstride + x * 4 + achan] = outpix[achan];
-        }
+    }
+
     rsvg_filter_store_result (self->result, output, ctx);
 
     g_object_unref (G_OBJECT (in));
@@ -2330,12 +2643,12 @@ rsvg_filter_primitive_component_transfer_set_atts (RsvgNode * self, RsvgHandle *
 }
 
 RsvgNode *
-rsvg_new_filter_primitive_component_transfer (void)
+rsvg_new_filter_primitive_component_transfer (RsvgArena * arena)
 {
     RsvgFilterPrimitiveComponentTransfer *filter;
 
-    filter = g_new (RsvgFilterPrimitiveComponentTransfer, 1);
-    _rsvg_node_init (&filter->super.super);
+    filter = _rsvg_node_new (RsvgFilterPrimitiveComponentTransfer, arena);
+    _rsvg_node_init (&filter->super.super, arena);
     filter->super.result = g_string_new ("none");
     filter->super.in = g_string_new ("none");
     filter->super.x.factor = filter->super.y.factor = filter->super.width.factor =
@@ -2405,12 +2718,12 @@ rsvg_component_transfer_function_free (RsvgNode * self)
 }
 
 RsvgNode *
-rsvg_new_node_component_transfer_function (char channel)
+rsvg_new_node_component_transfer_function (RsvgArena * arena, char channel)
 {
     RsvgNodeComponentTransferFunc *filter;
 
-    filter = g_new (RsvgNodeComponentTransferFunc, 1);
-    _rsvg_node_init (&filter->super);
+    filter = _rsvg_node_new (RsvgNodeComponentTransferFunc, arena);
+    _rsvg_node_init (&filter->super, arena);
     filter->super.free = rsvg_component_transfer_function_free;
     filter->super.set_atts = rsvg_node_component_transfer_function_set_atts;
     filter->function = identity_component_transfer_func;
@@ -2548,11 +2861,11 @@ rsvg_filter_primitive_erode_set_atts (RsvgNode * self, RsvgHandle * ctx, RsvgPro
 }
 
 RsvgNode *
-rsvg_new_filter_primitive_erode (void)
+rsvg_new_filter_primitive_erode (RsvgArena * arena)
 {
     RsvgFilterPrimitiveErode *filter;
-    filter = g_new (RsvgFilterPrimitiveErode, 1);
-    _rsvg_node_init (&filter->super.super);
+    filter = _rsvg_node_new (RsvgFilterPrimitiveErode, arena);
+    _rsvg_node_init (&filter->super.super, arena);
     filter->super.in = g_string_new ("none");
     filter->super.result = g_string_new ("none");
     filter->super.x.factor = filter->super.y.factor = filter->super.width.factor =
@@ -2773,11 +3086,11 @@ rsvg_filter_primitive_composite_set_atts (RsvgNode * self, RsvgHandle * ctx, Rsv
 }
 
 RsvgNode *
-rsvg_new_filter_primitive_composite (void)
+rsvg_new_filter_primitive_composite (RsvgArena * arena)
 {
     RsvgFilterPrimitiveComposite *filter;
-    filter = g_new (RsvgFilterPrimitiveComposite, 1);
-    _rsvg_node_init (&filter->super.super);
+    filter = _rsvg_node_new (RsvgFilterPrimitiveComposite, arena);
+    _rsvg_node_init (&filter->super.super, arena);
     filter->mode = COMPOSITE_MODE_OVER;
     filter->super.in = g_string_new ("none");
     filter->in2 = g_string_new ("none");
@@ -2878,11 +3191,11 @@ rsvg_filter_primitive_flood_set_atts (RsvgNode * self, RsvgHandle * ctx, RsvgPro
 }
 
 RsvgNode *
-rsvg_new_filter_primitive_flood (void)
+rsvg_new_filter_primitive_flood (RsvgArena * arena)
 {
     RsvgFilterPrimitive *filter;
-    filter = g_new (RsvgFilterPrimitive, 1);
-    _rsvg_node_init (&filter->super);
+    filter = _rsvg_node_new (RsvgFilterPrimitive, arena);
+    _rsvg_node_init (&filter->super, arena);
     filter->in = g_string_new ("none");
     filter->result = g_string_new ("none");
     filter->x.factor = filter->y.factor = filter->width.factor = filter->height.factor = 'n';
@@ -3054,11 +3367,11 @@ rsvg_filter_primitive_displacement_map_set_atts (RsvgNode * self, RsvgHandle * c
 }
 
 RsvgNode *
-rsvg_new_filter_primitive_displacement_map ()
+rsvg_new_filter_primitive_displacement_map (RsvgArena * arena)
 {
     RsvgFilterPrimitiveDisplacementMap *filter;
-    filter = g_new (RsvgFilterPrimitiveDisplacementMap, 1);
-    _rsvg_node_init (&filter->super.super);
+    filter = _rsvg_node_new (RsvgFilterPrimitiveDisplacementMap, arena);
+    _rsvg_node_init (&filter->super.super, arena);
     filter->super.in = g_string_new ("none");
     filter->in2 = g_string_new ("none");
     filter->super.result = g_string_new ("none");
@@ -3425,11 +3738,11 @@ rsvg_filter_primitive_turbulence_set_atts (RsvgNode * self, RsvgHandle * ctx,
 }
 
 RsvgNode *
-rsvg_new_filter_primitive_turbulence (void)
+rsvg_new_filter_primitive_turbulence (RsvgArena * arena)
 {
     RsvgFilterPrimitiveTurbulence *filter;
-    filter = g_new (RsvgFilterPrimitiveTurbulence, 1);
-    _rsvg_node_init (&filter->super.super);
+    filter = _rsvg_node_new (RsvgFilterPrimitiveTurbulence, arena);
+    _rsvg_node_init (&filter->super.super, arena);
     filter->super.in = g_string_new ("none");
     filter->super.result = g_string_new ("none");
     filter->super.x.factor = filter->super.y.factor = filter->super.width.factor =
@@ -3457,6 +3770,7 @@ struct _RsvgFilterPrimitiveImage {
     RsvgFilterPrimitive super;
     RsvgHandle *ctx;
     GString *href;
+    RsvgNode *link;             /* what href names in a document, once loaded */
 };
 
 static GdkPixbuf *
@@ -3471,10 +3785,7 @@ rsvg_filter_primitive_image_render_in (RsvgFilterPrimitive * self, RsvgFilterCon
 
     upself = (RsvgFilterPrimitiveImage *) self;
 
-    if (!upself->href)
-        return NULL;
-
-    drawable = rsvg_defs_lookup (ctx->defs, upself->href->str);
+    drawable = upself->link;
     if (!drawable)
         return NULL;
 
@@ -3629,6 +3940,7 @@ rsvg_filter_primitive_image_set_atts (RsvgNode * self, RsvgHandle * ctx, RsvgPro
         if ((value = rsvg_property_bag_lookup (atts, "xlink:href"))) {
             filter->href = g_string_new (NULL);
             g_string_assign (filter->href, value);
+            rsvg_defs_add_resolver (ctx->priv->defs, &filter->link, value);
         }
         if ((value = rsvg_property_bag_lookup (atts, "x")))
             filter->super.x = _rsvg_css_parse_length (value);
@@ -3644,15 +3956,16 @@ rsvg_filter_primitive_image_set_atts (RsvgNode * self, RsvgHandle * ctx, RsvgPro
 }
 
 RsvgNode *
-rsvg_new_filter_primitive_image (void)
+rsvg_new_filter_primitive_image (RsvgArena * arena)
 {
     RsvgFilterPrimitiveImage *filter;
-    filter = g_new (RsvgFilterPrimitiveImage, 1);
-    _rsvg_node_init (&filter->super.super);
+    filter = _rsvg_node_new (RsvgFilterPrimitiveImage, arena);
+    _rsvg_node_init (&filter->super.super, arena);
     filter->super.in = g_string_new ("none");
     filter->super.result = g_string_new ("none");
     filter->super.x.factor = filter->super.y.factor = filter->super.width.factor =
         filter->super.height.factor = 'n';
+    filter->link = NULL;
     filter->super.render = &rsvg_filter_primitive_image_render;
     filter->super.super.free = &rsvg_filter_primitive_image_free;
     filter->super.super.set_atts = rsvg_filter_primitive_image_set_atts;
@@ -4042,11 +4355,11 @@ rsvg_filter_primitive_light_source_set_atts (RsvgNode * self,
 }
 
 RsvgNode *
-rsvg_new_filter_primitive_light_source (char type)
+rsvg_new_filter_primitive_light_source (RsvgArena * arena, char type)
 {
     RsvgNodeLightSource *data;
-    data = g_new (RsvgNodeLightSource, 1);
-    _rsvg_node_init (&data->super);
+    data = _rsvg_node_new (RsvgNodeLightSource, arena);
+    _rsvg_node_init (&data->super, arena);
     data->super.free = _rsvg_node_free;
     data->super.set_atts = rsvg_filter_primitive_light_source_set_atts;
     data->specularExponent = 1;
@@ -4099,8 +4412,7 @@ rsvg_filter_primitive_diffuse_lighting_render (RsvgFilterPrimitive * self, RsvgF
     for (i = 0; i < self->super.children->len; i++) {
         RsvgNode *temp;
         temp = g_ptr_array_index (self->super.children, i);
-        if (!strcmp (temp->type->str, "feDistantLight") ||
-            !strcmp (temp->type->str, "fePointLight") || !strcmp (temp->type->str, "feSpotLight"))
+        if (temp->type == RSVG_NODE_TYPE_LIGHT_SOURCE)
             source = (RsvgNodeLightSource *) temp;
     }
     if (source == NULL)
@@ -4214,11 +4526,11 @@ rsvg_filter_primitive_diffuse_lighting_set_atts (RsvgNode * self, RsvgHandle * c
 }
 
 RsvgNode *
-rsvg_new_filter_primitive_diffuse_lighting (void)
+rsvg_new_filter_primitive_diffuse_lighting (RsvgArena * arena)
 {
     RsvgFilterPrimitiveDiffuseLighting *filter;
-    filter = g_new (RsvgFilterPrimitiveDiffuseLighting, 1);
-    _rsvg_node_init (&filter->super.super);
+    filter = _rsvg_node_new (RsvgFilterPrimitiveDiffuseLighting, arena);
+    _rsvg_node_init (&filter->super.super, arena);
     filter->super.in = g_string_new ("none");
     filter->super.result = g_string_new ("none");
     filter->super.x.factor = filter->super.y.factor = filter->super.width.factor =
@@ -4274,8 +4586,7 @@ rsvg_filter_primitive_specular_lighting_render (RsvgFilterPrimitive * self, Rsvg
     for (i = 0; i < self->super.children->len; i++) {
         RsvgNode *temp;
         temp = g_ptr_array_index (self->super.children, i);
-        if (!strcmp (temp->type->str, "feDistantLight") ||
-            !strcmp (temp->type->str, "fePointLight") || !strcmp (temp->type->str, "feSpotLight"))
+        if (temp->type == RSVG_NODE_TYPE_LIGHT_SOURCE)
             source = (RsvgNodeLightSource *) temp;
     }
     if (source == NULL)
@@ -4394,11 +4705,11 @@ rsvg_filter_primitive_specular_lighting_set_atts (RsvgNode * self, RsvgHandle *
 
 
 RsvgNode *
-rsvg_new_filter_primitive_specular_lighting (void)
+rsvg_new_filter_primitive_specular_lighting (RsvgArena * arena)
 {
     RsvgFilterPrimitiveSpecularLighting *filter;
-    filter = g_new (RsvgFilterPrimitiveSpecularLighting, 1);
-    _rsvg_node_init (&filter->super.super);
+    filter = _rsvg_node_new (RsvgFilterPrimitiveSpecularLighting, arena);
+    _rsvg_node_init (&filter->super.super, arena);
     filter->super.in = g_string_new ("none");
     filter->super.result = g_string_new ("none");
     filter->super.x.factor = filter->super.y.factor = filter->super.width.factor =
@@ -4427,16 +4738,15 @@ struct _RsvgFilterPrimitiveTile {
 static int
 mod (int a, int b)
 {
-    while (a < 0)
-        a += b;
-    return a % b;
+    int r = a % b;
+    return r < 0 ? r + b : r;
 }
 
 static void
 rsvg_filter_primitive_tile_render (RsvgFilterPrimitive * self, RsvgFilterContext * ctx)
 {
-    guchar i;
-    gint x, y, rowstride;
+    gint x, y, sx, sy, n;
+    gint in_rowstride, rowstride, tilewidth, tileheight;
     RsvgIRect boundarys, oboundarys;
 
     RsvgFilterPrimitiveOutput input;
@@ -4456,26 +4766,37 @@ rsvg_filter_primitive_tile_render (RsvgFilterPrimitive * self, RsvgFilterContext
     in = input.result;
     boundarys = input.bounds;
 
-
     in_pixels = gdk_pixbuf_get_pixels (in);
+    in_rowstride = gdk_pixbuf_get_rowstride (in);
 
     output = _rsvg_pixbuf_new_cleared (GDK_COLORSPACE_RGB, 1, 8, ctx->width, ctx->height);
     rowstride = gdk_pixbuf_get_rowstride (output);
 
     output_pixels = gdk_pixbuf_get_pixels (output);
 
-    for (y = oboundarys.y0; y < oboundarys.y1; y++)
-        for (x = oboundarys.x0; x < oboundarys.x1; x++)
-            for (i = 0; i < 4; i++) {
-                output_pixels[4 * x + y * rowstride + i] =
-                    in_pixels[(mod ((x - boundarys.x0), (boundarys.x1 - boundarys.x0)) +
-                               boundarys.x0) * 4 +
-                              (mod ((y - boundarys.y0), (boundarys.y1 - boundarys.y0)) +
-                               boundarys.y0) * rowstride + i];
+    tilewidth = boundarys.x1 - boundarys.x0;
+    tileheight = boundarys.y1 - boundarys.y0;
+
+    /* Each output row is a run of whole-tile-row copies, wrapping back to
+       the start of the tile row only at its right edge */
+    if (tilewidth > 0 && tileheight > 0)
+        for (y = oboundarys.y0; y < oboundarys.y1; y++) {
+            guchar *src_row;
+
+            sy = mod (y - boundarys.y0, tileheight) + boundarys.y0;
+            src_row = in_pixels + sy * in_rowstride;
+
+            sx = mod (oboundarys.x0 - boundarys.x0, tilewidth) + boundarys.x0;
+            for (x = oboundarys.x0; x < oboundarys.x1; x += n) {
+                n = MIN (boundarys.x1 - sx, oboundarys.x1 - x);
+                memcpy (output_pixels + y * rowstride + x * 4, src_row + sx * 4, n * 4);
+                sx = boundarys.x0;
             }
+        }
 
     rsvg_filter_store_result (self->result, output, ctx);
 
+    g_object_unref (G_OBJECT (in));
     g_object_unref (G_OBJECT (output));
 }
 
@@ -4517,11 +4838,11 @@ rsvg_filter_primitive_tile_set_atts (RsvgNode * self, RsvgHandle * ctx, RsvgProp
 }
 
 RsvgNode *
-rsvg_new_filter_primitive_tile (void)
+rsvg_new_filter_primitive_tile (RsvgArena * arena)
 {
     RsvgFilterPrimitiveTile *filter;
-    filter = g_new (RsvgFilterPrimitiveTile, 1);
-    _rsvg_node_init (&filter->super.super);
+    filter = _rsvg_node_new (RsvgFilterPrimitiveTile, arena);
+    _rsvg_node_init (&filter->super.super, arena);
     filter->super.in = g_string_new ("none");
     filter->super.result = g_string_new ("none");
     filter->super.x.factor = filter->super.y.factor = filter->super.width.factor =
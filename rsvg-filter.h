@@ -41,31 +41,31 @@ struct _RsvgFilter {
     RsvgFilterUnits primitiveunits;
 };
 
-GdkPixbuf   *rsvg_filter_render	    (RsvgFilter * self, GdkPixbuf * source, GdkPixbuf * bg,
+GdkPixbuf   *rsvg_filter_render	    (RsvgFilter * self, GdkPixbuf * source,
 				     RsvgDrawingCtx * context, RsvgBbox * dimentions, char *channelmap);
 
-RsvgNode    *rsvg_new_filter	    (void);
+RsvgNode    *rsvg_new_filter	    (RsvgArena * arena);
 RsvgFilter  *rsvg_filter_parse	    (const RsvgDefs * defs, const char *str);
 
-RsvgNode    *rsvg_new_filter_primitive_blend		    (void);
-RsvgNode    *rsvg_new_filter_primitive_convolve_matrix	    (void);
-RsvgNode    *rsvg_new_filter_primitive_gaussian_blur	    (void);
-RsvgNode    *rsvg_new_filter_primitive_offset		    (void);
-RsvgNode    *rsvg_new_filter_primitive_merge		    (void);
-RsvgNode    *rsvg_new_filter_primitive_merge_node	    (void);
-RsvgNode    *rsvg_new_filter_primitive_colour_matrix	    (void);
-RsvgNode    *rsvg_new_filter_primitive_component_transfer   (void);
-RsvgNode    *rsvg_new_node_component_transfer_function	    (char channel);
-RsvgNode    *rsvg_new_filter_primitive_erode		    (void);
-RsvgNode    *rsvg_new_filter_primitive_composite	    (void);
-RsvgNode    *rsvg_new_filter_primitive_flood		    (void);
-RsvgNode    *rsvg_new_filter_primitive_displacement_map	    (void);
-RsvgNode    *rsvg_new_filter_primitive_turbulence	    (void);
-RsvgNode    *rsvg_new_filter_primitive_image		    (void);
-RsvgNode    *rsvg_new_filter_primitive_diffuse_lighting	    (void);
-RsvgNode    *rsvg_new_filter_primitive_light_source	    (char type);
-RsvgNode    *rsvg_new_filter_primitive_specular_lighting    (void);
-RsvgNode    *rsvg_new_filter_primitive_tile		    (void);
+RsvgNode    *rsvg_new_filter_primitive_blend		    (RsvgArena * arena);
+RsvgNode    *rsvg_new_filter_primitive_convolve_matrix	    (RsvgArena * arena);
+RsvgNode    *rsvg_new_filter_primitive_gaussian_blur	    (RsvgArena * arena);
+RsvgNode    *rsvg_new_filter_primitive_offset		    (RsvgArena * arena);
+RsvgNode    *rsvg_new_filter_primitive_merge		    (RsvgArena * arena);
+RsvgNode    *rsvg_new_filter_primitive_merge_node	    (RsvgArena * arena);
+RsvgNode    *rsvg_new_filter_primitive_colour_matrix	    (RsvgArena * arena);
+RsvgNode    *rsvg_new_filter_primitive_component_transfer   (RsvgArena * arena);
+RsvgNode    *rsvg_new_node_component_transfer_function	    (RsvgArena * arena, char channel);
+RsvgNode    *rsvg_new_filter_primitive_erode		    (RsvgArena * arena);
+RsvgNode    *rsvg_new_filter_primitive_composite	    (RsvgArena * arena);
+RsvgNode    *rsvg_new_filter_primitive_flood		    (RsvgArena * arena);
+RsvgNode    *rsvg_new_filter_primitive_displacement_map	    (RsvgArena * arena);
+RsvgNode    *rsvg_new_filter_primitive_turbulence	    (RsvgArena * arena);
+RsvgNode    *rsvg_new_filter_primitive_image		    (RsvgArena * arena);
+RsvgNode    *rsvg_new_filter_primitive_diffuse_lighting	    (RsvgArena * arena);
+RsvgNode    *rsvg_new_filter_primitive_light_source	    (RsvgArena * arena, char type);
+RsvgNode    *rsvg_new_filter_primitive_specular_lighting    (RsvgArena * arena);
+RsvgNode    *rsvg_new_filter_primitive_tile		    (RsvgArena * arena);
 
 void	     rsvg_filter_adobe_blend	(gint modenum, GdkPixbuf * in, GdkPixbuf * bg,
 					 GdkPixbuf * output, RsvgIRect boundarys, 
@@ -76,6 +76,10 @@ void	     rsvg_alpha_blt		(GdkPixbuf * src, gint srcx, gint srcy,
 void	     rsvg_art_affine_image	(const GdkPixbuf * img, GdkPixbuf * intermediate,
 					 double *affine, double w, double h);
 
+gboolean     _rsvg_filter_component_transfer_lut	(RsvgNode * func, guchar lut[256]);
+void	     _rsvg_filter_colour_matrix_pixel	(const gint * kernel, const guchar * inpix,
+						 guchar * outpix);
+
 G_END_DECLS
 
 #endif
@@ -22,6 +22,7 @@
 
 #include "rsvg-private.h"
 #include "rsvg-defs.h"
+#include "rsvg-structure.h"
 
 enum {
     PROP_0,
@@ -48,6 +49,7 @@ instance_init (RsvgHandle * self)
 {
     self->priv = g_new0 (RsvgHandlePrivate, 1);
     self->priv->defs = rsvg_defs_new ();
+    self->priv->arena = _rsvg_arena_new ();
     self->priv->handler_nest = 0;
     self->priv->entities = g_hash_table_new (g_str_hash, g_str_equal);
     self->priv->dpi_x = rsvg_internal_dpi_x;
@@ -95,6 +97,7 @@ instance_dispose (GObject * instance)
     g_hash_table_foreach (self->priv->entities, rsvg_ctx_free_helper, NULL);
     g_hash_table_destroy (self->priv->entities);
     rsvg_defs_free (self->priv->defs);
+    _rsvg_arena_free (self->priv->arena);
     g_hash_table_destroy (self->priv->css_props);
 
     if (self->priv->user_data_destroy)
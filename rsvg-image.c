@@ -32,193 +32,186 @@
 #include <string.h>
 #include <math.h>
 #include <errno.h>
+#include <stdio.h>
+#include <sys/stat.h>
 #include "rsvg-css.h"
 #ifdef HAVE_GIO
 #include <gio/gio.h>
 #endif
 
-static const char s_UTF8_B64Alphabet[64] = {
-    0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x4b, 0x4c, 0x4d, 0x4e, 0x4f,
-    0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a,   /* A-Z */
-    0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x6b, 0x6c, 0x6d, 0x6e, 0x6f,
-    0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a,   /* a-z */
-    0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, /* 0-9 */
-    0x2b,                       /* + */
-    0x2f                        /* / */
+#define RSVG_BASE64_SPACE 0x40
+#define RSVG_BASE64_PAD   0x41
+#define RSVG_BASE64_BAD   0x42
+
+/* data: URIs are decoded this many input bytes at a time */
+#define RSVG_BASE64_CHUNK 65536
+
+/* the 6 bit value of each base64 character, or one of the markers above */
+static const guint8 rsvg_base64_decode_table[256] = {
+    0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x40, 0x40, 0x40, 0x40, 0x40, 0x42, 0x42,
+    0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42,
+    0x40, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x3e, 0x42, 0x42, 0x42, 0x3f,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x42, 0x42, 0x42, 0x41, 0x42, 0x42,
+    0x42, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+    0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x42, 0x42, 0x42, 0x42, 0x42,
+    0x42, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30, 0x31, 0x32, 0x33, 0x42, 0x42, 0x42, 0x42, 0x42,
+    0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42,
+    0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42,
+    0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42,
+    0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42,
+    0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42,
+    0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42,
+    0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42,
+    0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42
 };
-static const char utf8_b64_pad = 0x3d;
 
-static gboolean
-b64_decode_char (char c, int *b64)
+typedef struct {
+    guint32 bits;               /* characters of the current quantum */
+    int n_chars;
+    gboolean padding;           /* an '=' has been seen */
+} RsvgBase64Decoder;
+
+/* Decodes @len bytes of @in into @out, which has to have room for
+   len / 4 * 3 + 3 bytes, and returns how many it wrote, or -1 if @in is
+   not base64.  A quantum may straddle two calls. */
+static gssize
+rsvg_base64_decode_step (RsvgBase64Decoder * decoder, const guchar * in, gsize len, guchar * out)
 {
-    if ((c >= 0x41) && (c <= 0x5a)) {
-        *b64 = c - 0x41;
-        return TRUE;
-    }
-    if ((c >= 0x61) && (c <= 0x7a)) {
-        *b64 = c - (0x61 - 26);
-        return TRUE;
-    }
-    if ((c >= 0x30) && (c <= 0x39)) {
-        *b64 = c + (52 - 0x30);
-        return TRUE;
-    }
-    if (c == 0x2b) {
-        *b64 = 62;
-        return TRUE;
-    }
-    if (c == 0x2f) {
-        *b64 = 63;
-        return TRUE;
+    const guchar *end = in + len;
+    guchar *p = out;
+    guint32 bits = decoder->bits;
+    int n_chars = decoder->n_chars;
+    guint8 v;
+
+    for (; in < end; in++) {
+        v = rsvg_base64_decode_table[*in];
+        if (v < 64) {
+            if (decoder->padding)
+                return -1;
+            bits = (bits << 6) | v;
+            if (++n_chars == 4) {
+                *p++ = bits >> 16;
+                *p++ = bits >> 8;
+                *p++ = bits;
+                bits = 0;
+                n_chars = 0;
+            }
+        } else if (v == RSVG_BASE64_PAD) {
+            if (decoder->padding)
+                continue;
+            if (n_chars < 2)
+                return -1;
+            if (n_chars == 2) {
+                *p++ = bits >> 4;
+            } else {
+                *p++ = bits >> 10;
+                *p++ = bits >> 2;
+            }
+            bits = 0;
+            n_chars = 0;
+            decoder->padding = TRUE;
+        } else if (v != RSVG_BASE64_SPACE)
+            return -1;
     }
-    return FALSE;
+
+    decoder->bits = bits;
+    decoder->n_chars = n_chars;
+    return p - out;
 }
 
-static gboolean
-utf8_base64_decode (guchar ** binptr, size_t * binlen, const char *b64ptr, size_t b64len)
+/* flushes the bytes of an unpadded final quantum into @out */
+static gsize
+rsvg_base64_decode_end (RsvgBase64Decoder * decoder, guchar * out)
 {
-    gboolean decoded = TRUE;
-    gboolean padding = FALSE;
-
-    int i = 0;
-    glong ucs4_len, j;
-
-    unsigned char byte1 = 0;
-    unsigned char byte2;
-
-    gunichar ucs4, *ucs4_str;
-
-    if (b64len == 0)
-        return TRUE;
-
-    if ((binptr == 0) || (b64ptr == 0))
-        return FALSE;
-
-    ucs4_str = g_utf8_to_ucs4_fast (b64ptr, b64len, &ucs4_len);
-
-    for (j = 0; j < ucs4_len; j++) {
-        ucs4 = ucs4_str[j];
-        if ((ucs4 & 0x7f) == ucs4) {
-            int b64;
-            char c = (char) (ucs4);
-
-            if (b64_decode_char (c, &b64)) {
-                if (padding || (*binlen == 0)) {
-                    decoded = FALSE;
-                    break;
-                }
-
-                switch (i) {
-                case 0:
-                    byte1 = (unsigned char) (b64) << 2;
-                    i++;
-                    break;
-                case 1:
-                    byte2 = (unsigned char) (b64);
-                    byte1 |= byte2 >> 4;
-                    *(*binptr)++ = (char) (byte1);
-                    (*binlen)--;
-                    byte1 = (byte2 & 0x0f) << 4;
-                    i++;
-                    break;
-                case 2:
-                    byte2 = (unsigned char) (b64);
-                    byte1 |= byte2 >> 2;
-                    *(*binptr)++ = (char) (byte1);
-                    (*binlen)--;
-                    byte1 = (byte2 & 0x03) << 6;
-                    i++;
-                    break;
-                default:
-                    byte1 |= (unsigned char) (b64);
-                    *(*binptr)++ = (char) (byte1);
-                    (*binlen)--;
-                    i = 0;
-                    break;
-                }
-
-                if (!decoded)
-                    break;
-
-                continue;
-            } else if (c == utf8_b64_pad) {
-                switch (i) {
-                case 0:
-                case 1:
-                    decoded = FALSE;
-                    break;
-                case 2:
-                    if (*binlen == 0)
-                        decoded = FALSE;
-                    else {
-                        *(*binptr)++ = (char) (byte1);
-                        (*binlen)--;
-                        padding = TRUE;
-                    }
-                    i++;
-                    break;
-                default:
-                    if (!padding) {
-                        if (*binlen == 0)
-                            decoded = FALSE;
-                        else {
-                            *(*binptr)++ = (char) (byte1);
-                            (*binlen)--;
-                            padding = TRUE;
-                        }
-                    }
-                    i = 0;
-                    break;
-                }
-                if (!decoded)
-                    break;
-
-                continue;
-            }
-        }
-        if (g_unichar_isspace (ucs4))
-            continue;
-
-        decoded = FALSE;
-        break;
+    guint32 bits = decoder->bits;
+
+    switch (decoder->n_chars) {
+    case 2:
+        out[0] = bits >> 4;
+        return 1;
+    case 3:
+        out[0] = bits >> 10;
+        out[1] = bits >> 2;
+        return 2;
+    default:
+        return 0;
     }
+}
 
-    g_free (ucs4_str);
-    return decoded;
+static const char *
+rsvg_data_uri_payload (const char *data)
+{
+    while (*data)
+        if (*data++ == ',')
+            break;
+    return data;
 }
 
 static GByteArray *
 rsvg_acquire_base64_resource (const char *data, GError ** error)
 {
+    RsvgBase64Decoder decoder = { 0, 0, FALSE };
     GByteArray *array;
-
-    guchar *bufptr;
-    size_t buffer_len, buffer_max_len, data_len;
+    gsize data_len;
+    gssize len;
 
     rsvg_return_val_if_fail (data != NULL, NULL, error);
 
-    while (*data)
-        if (*data++ == ',')
-            break;
-
+    data = rsvg_data_uri_payload (data);
     data_len = strlen (data);
 
-    buffer_max_len = ((data_len >> 2) + 1) * 3;
-    buffer_len = buffer_max_len;
-
-    array = g_byte_array_sized_new (buffer_max_len);
-    bufptr = array->data;
-
-    if (!utf8_base64_decode (&bufptr, &buffer_len, data, data_len)) {
+    array = g_byte_array_sized_new (data_len / 4 * 3 + 3);
+    g_byte_array_set_size (array, data_len / 4 * 3 + 3);
+    len = rsvg_base64_decode_step (&decoder, (const guchar *) data, data_len, array->data);
+    if (len < 0) {
         g_byte_array_free (array, TRUE);
+        g_set_error (error, RSVG_ERROR, RSVG_ERROR_FAILED, _("Invalid base64 data"));
         return NULL;
     }
-
-    array->len = buffer_max_len - buffer_len;
+    len += rsvg_base64_decode_end (&decoder, array->data + len);
+    g_byte_array_set_size (array, len);
 
     return array;
 }
 
+/* decodes a base64 data: URI into @loader a chunk at a time, so that
+   neither the whole payload nor the whole image is ever held twice */
+static gboolean
+rsvg_pixbuf_loader_write_base64 (GdkPixbufLoader * loader, const char *data, GError ** error)
+{
+    RsvgBase64Decoder decoder = { 0, 0, FALSE };
+    guchar *buffer;
+    gsize data_len, chunk;
+    gssize len;
+    gboolean res = TRUE;
+
+    data = rsvg_data_uri_payload (data);
+    data_len = strlen (data);
+    buffer = g_malloc (RSVG_BASE64_CHUNK / 4 * 3 + 3);
+
+    while (res && data_len > 0) {
+        chunk = MIN (data_len, RSVG_BASE64_CHUNK);
+        len = rsvg_base64_decode_step (&decoder, (const guchar *) data, chunk, buffer);
+        if (len < 0) {
+            g_set_error (error, RSVG_ERROR, RSVG_ERROR_FAILED, _("Invalid base64 data"));
+            res = FALSE;
+        } else if (len > 0)
+            res = gdk_pixbuf_loader_write (loader, buffer, len, error);
+        data += chunk;
+        data_len -= chunk;
+    }
+
+    if (res) {
+        len = rsvg_base64_decode_end (&decoder, buffer);
+        if (len > 0)
+            res = gdk_pixbuf_loader_write (loader, buffer, len, error);
+    }
+
+    g_free (buffer);
+    return res;
+}
+
 gchar *
 rsvg_get_file_path (const gchar * filename, const gchar * base_uri)
 {
@@ -254,7 +247,8 @@ rsvg_acquire_file_resource (const char *filename, const char *base_uri, GError *
     gchar *path;
 
     guchar buffer[4096];
-    int length;
+    size_t length;
+    struct stat st;
     FILE *f;
 
     rsvg_return_val_if_fail (filename != NULL, NULL, error);
@@ -274,8 +268,17 @@ rsvg_acquire_file_resource (const char *filename, const char *base_uri, GError *
         return NULL;
     }
 
-    /* TODO: an optimization is to use the file's size */
-    array = g_byte_array_new ();
+    /* a regular file is read in one go into a buffer of its size; pipes,
+       devices and whatever a file grew by meanwhile go through the chunked
+       loop below */
+    if (fstat (fileno (f), &st) == 0 && S_ISREG (st.st_mode) &&
+        st.st_size > 0 && (guint64) st.st_size <= G_MAXUINT) {
+        array = g_byte_array_sized_new (st.st_size);
+        g_byte_array_set_size (array, st.st_size);
+        length = fread (array->data, 1, st.st_size, f);
+        g_byte_array_set_size (array, length);
+    } else
+        array = g_byte_array_new ();
 
     while (!feof (f)) {
         length = fread (buffer, 1, sizeof (buffer), f);
@@ -380,51 +383,54 @@ _rsvg_acquire_xlink_href_resource (const char *href, const char *base_uri, GErro
 GdkPixbuf *
 rsvg_pixbuf_new_from_href (const char *href, const char *base_uri, GError ** error)
 {
-    GByteArray *arr;
-
-    arr = _rsvg_acquire_xlink_href_resource (href, base_uri, error);
-    if (arr) {
-        GdkPixbufLoader *loader;
-        GdkPixbuf *pixbuf = NULL;
-        int res;
+    GdkPixbufLoader *loader;
+    GdkPixbuf *pixbuf = NULL;
+    int res;
 
+    if (href && !strncmp (href, "data:", 5)) {
         loader = gdk_pixbuf_loader_new ();
+        res = rsvg_pixbuf_loader_write_base64 (loader, href, error);
+    } else {
+        GByteArray *arr;
 
-        res = gdk_pixbuf_loader_write (loader, arr->data, arr->len, error);
-        g_byte_array_free (arr, TRUE);
-
-        if (!res) {
-            gdk_pixbuf_loader_close (loader, NULL);
-            g_object_unref (loader);
+        arr = _rsvg_acquire_xlink_href_resource (href, base_uri, error);
+        if (!arr)
             return NULL;
-        }
 
-        if (!gdk_pixbuf_loader_close (loader, error)) {
-            g_object_unref (loader);
-            return NULL;
-        }
+        loader = gdk_pixbuf_loader_new ();
+        res = gdk_pixbuf_loader_write (loader, arr->data, arr->len, error);
+        g_byte_array_free (arr, TRUE);
+    }
 
-        pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
+    if (!res) {
+        gdk_pixbuf_loader_close (loader, NULL);
+        g_object_unref (loader);
+        return NULL;
+    }
 
-        if (!pixbuf) {
-            g_object_unref (loader);
-            g_set_error (error,
-                         GDK_PIXBUF_ERROR,
-                         GDK_PIXBUF_ERROR_FAILED,
-                         _
-                         ("Failed to load image '%s': reason not known, probably a corrupt image file"),
-                         href);
-            return NULL;
-        }
+    if (!gdk_pixbuf_loader_close (loader, error)) {
+        g_object_unref (loader);
+        return NULL;
+    }
 
-        g_object_ref (pixbuf);
+    pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
 
+    if (!pixbuf) {
         g_object_unref (loader);
-
-        return pixbuf;
+        g_set_error (error,
+                     GDK_PIXBUF_ERROR,
+                     GDK_PIXBUF_ERROR_FAILED,
+                     _
+                     ("Failed to load image '%s': reason not known, probably a corrupt image file"),
+                     href);
+        return NULL;
     }
 
-    return NULL;
+    g_object_ref (pixbuf);
+
+    g_object_unref (loader);
+
+    return pixbuf;
 }
 
 void
@@ -470,11 +476,9 @@ static void
 rsvg_node_image_free (RsvgNode * self)
 {
     RsvgNodeImage *z = (RsvgNodeImage *) self;
-    rsvg_state_finalize (z->super.state);
-    g_free (z->super.state);
     if (z->img)
         g_object_unref (G_OBJECT (z->img));
-    g_free (z);
+    _rsvg_node_free (self);
 }
 
 static void
@@ -549,16 +553,14 @@ rsvg_node_image_set_atts (RsvgNode * self, RsvgHandle * ctx, RsvgPropertyBag * a
 }
 
 RsvgNode *
-rsvg_new_image (void)
+rsvg_new_image (RsvgArena * arena)
 {
     RsvgNodeImage *image;
-    image = g_new (RsvgNodeImage, 1);
-    _rsvg_node_init (&image->super);
+    image = _rsvg_node_new (RsvgNodeImage, arena);
+    _rsvg_node_init (&image->super, arena);
     image->img = NULL;
     image->preserve_aspect_ratio = RSVG_ASPECT_RATIO_XMID_YMID;
     image->x = image->y = image->w = image->h = _rsvg_css_parse_length ("0");
-    image->super.state = g_new (RsvgState, 1);
-    rsvg_state_init (image->super.state);
     image->super.free = rsvg_node_image_free;
     image->super.draw = rsvg_node_image_draw;
     image->super.set_atts = rsvg_node_image_set_atts;
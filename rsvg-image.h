@@ -33,7 +33,7 @@
 
 G_BEGIN_DECLS 
 
-RsvgNode *rsvg_new_image (void);
+RsvgNode *rsvg_new_image (RsvgArena * arena);
 
 typedef struct _RsvgNodeImage RsvgNodeImage;
 
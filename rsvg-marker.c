@@ -79,11 +79,11 @@ rsvg_node_marker_set_atts (RsvgNode * self, RsvgHandle * ctx, RsvgPropertyBag *
 }
 
 RsvgNode *
-rsvg_new_marker (void)
+rsvg_new_marker (RsvgArena * arena)
 {
     RsvgMarker *marker;
-    marker = g_new (RsvgMarker, 1);
-    _rsvg_node_init (&marker->super);
+    marker = _rsvg_node_new (RsvgMarker, arena);
+    _rsvg_node_init (&marker->super, arena);
     marker->orient = 0;
     marker->orientAuto = FALSE;
     marker->preserve_aspect_ratio = RSVG_ASPECT_RATIO_XMID_YMID;
@@ -95,6 +95,160 @@ rsvg_new_marker (void)
     return &marker->super;
 }
 
+/* The contents of a marker are recorded once per drawing context and
+   replayed at each vertex.  Markers that draw anything but plain paths
+   (images, text, clipped or composited groups) are drawn the slow way. */
+
+typedef struct {
+    /* the caller's viewport and font size, which the marker's own
+       lengths resolve against, and whether text would use pango */
+    double vb_w, vb_h;
+    RsvgLength font_size;
+    gboolean has_pango;
+
+    double affine[6];           /* refX/refY and viewBox transform */
+    double clip[4];
+    RsvgState state;            /* as rebuilt by rsvg_state_reconstruct */
+    RsvgRecording *recording;
+} RsvgMarkerCache;
+
+static void
+rsvg_marker_cache_free (RsvgMarkerCache * cache)
+{
+    rsvg_recording_free (cache->recording);
+    rsvg_state_finalize (&cache->state);
+    g_free (cache);
+}
+
+static RsvgMarkerCache *
+rsvg_marker_record (RsvgMarker * self, RsvgDrawingCtx * ctx)
+{
+    RsvgMarkerCache *cache = g_new0 (RsvgMarkerCache, 1);
+    RsvgState *state = rsvg_state_current (ctx);
+    gdouble taffine[6];
+    guint i;
+
+    cache->vb_w = ctx->vb.w;
+    cache->vb_h = ctx->vb.h;
+    cache->font_size = state->font_size;
+    cache->has_pango = ctx->render->render_pango_layout != NULL;
+
+    _rsvg_affine_identity (cache->affine);
+    if (self->vbox.active) {
+        double w, h, x, y;
+        w = _rsvg_css_normalize_length (&self->width, ctx, 'h');
+        h = _rsvg_css_normalize_length (&self->height, ctx, 'v');
+        x = 0;
+        y = 0;
+
+        rsvg_preserve_aspect_ratio (self->preserve_aspect_ratio,
+                                    self->vbox.w, self->vbox.h, &w, &h, &x, &y);
+
+        taffine[0] = w / self->vbox.w;
+        taffine[1] = 0.;
+        taffine[2] = 0.;
+        taffine[3] = h / self->vbox.h;
+        taffine[4] = -self->vbox.x * w / self->vbox.w;
+        taffine[5] = -self->vbox.y * h / self->vbox.h;
+        _rsvg_affine_multiply (cache->affine, taffine, cache->affine);
+        _rsvg_push_view_box (ctx, self->vbox.w, self->vbox.h);
+    }
+    _rsvg_affine_translate (taffine,
+                            -_rsvg_css_normalize_length (&self->refX, ctx, 'h'),
+                            -_rsvg_css_normalize_length (&self->refY, ctx, 'v'));
+    _rsvg_affine_multiply (cache->affine, taffine, cache->affine);
+
+    rsvg_state_push (ctx);
+    state = rsvg_state_current (ctx);
+
+    rsvg_state_finalize (state);
+    rsvg_state_init (state);
+    rsvg_state_reconstruct (state, &self->super);
+
+    rsvg_state_init (&cache->state);
+    rsvg_state_clone (&cache->state, state);
+
+    for (i = 0; i < 6; i++)
+        state->affine[i] = cache->affine[i];
+
+    if (self->vbox.active) {
+        cache->clip[0] = self->vbox.x;
+        cache->clip[1] = self->vbox.y;
+        cache->clip[2] = self->vbox.w;
+        cache->clip[3] = self->vbox.h;
+    } else {
+        cache->clip[0] = 0;
+        cache->clip[1] = 0;
+        cache->clip[2] = _rsvg_css_normalize_length (&self->width, ctx, 'h');
+        cache->clip[3] = _rsvg_css_normalize_length (&self->height, ctx, 'v');
+    }
+
+    cache->recording = rsvg_recording_new (ctx, FALSE);
+    for (i = 0; i < self->super.children->len; i++) {
+        rsvg_state_push (ctx);
+        rsvg_node_draw (g_ptr_array_index (self->super.children, i), ctx, 0);
+        rsvg_state_pop (ctx);
+    }
+    rsvg_recording_finish (ctx, cache->recording);
+
+    rsvg_state_pop (ctx);
+    if (self->vbox.active)
+        _rsvg_pop_view_box (ctx);
+
+    return cache;
+}
+
+static RsvgMarkerCache *
+rsvg_marker_lookup_cache (RsvgMarker * self, RsvgDrawingCtx * ctx)
+{
+    RsvgState *state = rsvg_state_current (ctx);
+    RsvgMarkerCache *cache;
+
+    if (ctx->marker_cache == NULL)
+        ctx->marker_cache = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+                                                   (GDestroyNotify) rsvg_marker_cache_free);
+
+    cache = g_hash_table_lookup (ctx->marker_cache, self);
+    if (cache != NULL
+        && cache->vb_w == ctx->vb.w && cache->vb_h == ctx->vb.h
+        && cache->font_size.length == state->font_size.length
+        && cache->font_size.factor == state->font_size.factor
+        && cache->has_pango == (ctx->render->render_pango_layout != NULL))
+        return cache;
+
+    cache = rsvg_marker_record (self, ctx);
+    g_hash_table_replace (ctx->marker_cache, self, cache);
+    return cache;
+}
+
+static void
+rsvg_marker_replay (RsvgMarker * self, RsvgMarkerCache * cache, const gdouble vertex[6],
+                    RsvgDrawingCtx * ctx)
+{
+    RsvgState *state;
+
+    if (self->vbox.active)
+        _rsvg_push_view_box (ctx, self->vbox.w, self->vbox.h);
+
+    rsvg_state_push (ctx);
+    state = rsvg_state_current (ctx);
+    rsvg_state_clone (state, &cache->state);
+    _rsvg_affine_multiply (state->affine, cache->affine, vertex);
+
+    rsvg_push_discrete_layer (ctx);
+
+    if (!state->overflow)
+        rsvg_add_clipping_rect (ctx, cache->clip[0], cache->clip[1], cache->clip[2], cache->clip[3]);
+
+    rsvg_recording_replay (ctx, cache->recording, vertex);
+
+    rsvg_pop_discrete_layer (ctx);
+
+    rsvg_state_pop (ctx);
+    if (self->vbox.active)
+        _rsvg_pop_view_box (ctx);
+}
+
 void
 rsvg_marker_render (RsvgMarker * self, gdouble x, gdouble y, gdouble orient, gdouble linewidth,
                     RsvgDrawingCtx * ctx)
@@ -120,6 +274,15 @@ rsvg_marker_render (RsvgMarker * self, gdouble x, gdouble y, gdouble orient, gdo
         _rsvg_affine_multiply (affine, taffine, affine);
     }
 
+    /* drawing a sub-node only visits part of the tree, so never record then */
+    if (ctx->drawsub_stack == NULL) {
+        RsvgMarkerCache *cache = rsvg_marker_lookup_cache (self, ctx);
+        if (rsvg_recording_is_replayable (cache->recording)) {
+            rsvg_marker_replay (self, cache, affine, ctx);
+            return;
+        }
+    }
+
     if (self->vbox.active) {
 
         double w, h, x, y;
@@ -198,7 +361,7 @@ rsvg_marker_parse (const RsvgDefs * defs, const char *str)
         val = rsvg_defs_lookup (defs, name);
         g_free (name);
 
-        if (val && (!strcmp (val->type->str, "marker")))
+        if (val && (val->type == RSVG_NODE_TYPE_MARKER))
             return val;
     }
     return NULL;
@@ -41,7 +41,7 @@ struct _RsvgMarker {
     RsvgViewBox vbox;
 };
 
-RsvgNode    *rsvg_new_marker	    (void);
+RsvgNode    *rsvg_new_marker	    (RsvgArena * arena);
 void	     rsvg_marker_render	    (RsvgMarker * self, gdouble x, gdouble y, 
 				     gdouble orient, gdouble linewidth, RsvgDrawingCtx * ctx);
 RsvgNode    *rsvg_marker_parse	    (const RsvgDefs * defs, const char *str);
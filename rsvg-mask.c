@@ -68,12 +68,12 @@ rsvg_mask_set_atts (RsvgNode * self, RsvgHandle * ctx, RsvgPropertyBag * atts)
 }
 
 RsvgNode *
-rsvg_new_mask (void)
+rsvg_new_mask (RsvgArena * arena)
 {
     RsvgMask *mask;
 
-    mask = g_new (RsvgMask, 1);
-    _rsvg_node_init (&mask->super);
+    mask = _rsvg_node_new (RsvgMask, arena);
+    _rsvg_node_init (&mask->super, arena);
     mask->maskunits = objectBoundingBox;
     mask->contentunits = userSpaceOnUse;
     mask->x = _rsvg_css_parse_length ("0");
@@ -112,7 +112,7 @@ rsvg_mask_parse (const RsvgDefs * defs, const char *str)
         val = rsvg_defs_lookup (defs, name);
         g_free (name);
 
-        if (val && (!strcmp (val->type->str, "mask")))
+        if (val && (val->type == RSVG_NODE_TYPE_MASK))
             return val;
     }
     return NULL;
@@ -129,7 +129,7 @@ rsvg_clip_path_parse (const RsvgDefs * defs, const char *str)
         val = rsvg_defs_lookup (defs, name);
         g_free (name);
 
-        if (val && (!strcmp (val->type->str, "clipPath")))
+        if (val && (val->type == RSVG_NODE_TYPE_CLIP_PATH))
             return val;
     }
     return NULL;
@@ -164,12 +164,12 @@ rsvg_clip_path_set_atts (RsvgNode * self, RsvgHandle * ctx, RsvgPropertyBag * at
 }
 
 RsvgNode *
-rsvg_new_clip_path (void)
+rsvg_new_clip_path (RsvgArena * arena)
 {
     RsvgClipPath *clip_path;
 
-    clip_path = g_new (RsvgClipPath, 1);
-    _rsvg_node_init (&clip_path->super);
+    clip_path = _rsvg_node_new (RsvgClipPath, arena);
+    _rsvg_node_init (&clip_path->super, arena);
     clip_path->units = userSpaceOnUse;
     clip_path->super.set_atts = rsvg_clip_path_set_atts;
     clip_path->super.free = _rsvg_node_free;
@@ -45,7 +45,7 @@ struct _RsvgMask {
     RsvgMaskUnits contentunits;
 };
 
-RsvgNode *rsvg_new_mask	    (void);
+RsvgNode *rsvg_new_mask	    (RsvgArena * arena);
 RsvgNode *rsvg_mask_parse   (const RsvgDefs * defs, const char *str);
 
 typedef struct _RsvgClipPath RsvgClipPath;
@@ -55,7 +55,7 @@ struct _RsvgClipPath {
     RsvgCoordUnits units;
 };
 
-RsvgNode *rsvg_new_clip_path	(void);
+RsvgNode *rsvg_new_clip_path	(RsvgArena * arena);
 RsvgNode *rsvg_clip_path_parse	(const RsvgDefs * defs, const char *str);
 
 G_END_DECLS
@@ -37,91 +37,77 @@
 
 #include "rsvg-css.h"
 
-static RsvgPaintServer *
-rsvg_paint_server_solid (guint32 rgb)
-{
-    RsvgPaintServer *result = g_new (RsvgPaintServer, 1);
-
-    result->refcnt = 1;
-    result->type = RSVG_PAINT_SERVER_SOLID;
-    result->core.colour = g_new (RsvgSolidColour, 1);
-    result->core.colour->rgb = rgb;
-    result->core.colour->currentcolour = FALSE;
-
-    return result;
-}
+/* The initial fill of every state, shared so that initialising a state
+   allocates nothing */
+static RsvgPaintServer rsvg_paint_server_black = {
+    RSVG_PAINT_SERVER_SOLID, {{FALSE, 0x000000}}
+};
 
-static RsvgPaintServer *
-rsvg_paint_server_solid_current_colour ()
-{
-    RsvgPaintServer *result = g_new (RsvgPaintServer, 1);
-
-    result->refcnt = 1;
-    result->type = RSVG_PAINT_SERVER_SOLID;
-    result->core.colour = g_new (RsvgSolidColour, 1);
-    result->core.colour->currentcolour = TRUE;
-
-    return result;
-}
-
-static RsvgPaintServer *
-rsvg_paint_server_lin_grad (RsvgLinearGradient * gradient)
+RsvgPaintServer *
+rsvg_paint_server_default_fill (void)
 {
-    RsvgPaintServer *result = g_new (RsvgPaintServer, 1);
-
-    result->refcnt = 1;
-    result->type = RSVG_PAINT_SERVER_LIN_GRAD;
-    result->core.lingrad = gradient;
-
-    return result;
+    return &rsvg_paint_server_black;
 }
 
-static RsvgPaintServer *
-rsvg_paint_server_rad_grad (RsvgRadialGradient * gradient)
+guint
+rsvg_paint_server_hash (gconstpointer key)
 {
-    RsvgPaintServer *result = g_new (RsvgPaintServer, 1);
+    const RsvgPaintServer *ps = key;
 
-    result->refcnt = 1;
-    result->type = RSVG_PAINT_SERVER_RAD_GRAD;
-    result->core.radgrad = gradient;
-
-    return result;
+    if (ps->type == RSVG_PAINT_SERVER_SOLID)
+        return ps->core.colour.currentcolour ? G_MAXUINT : ps->core.colour.rgb;
+    return g_direct_hash (ps->core.lingrad) ^ ps->type;
 }
 
-static RsvgPaintServer *
-rsvg_paint_server_pattern (RsvgPattern * pattern)
+gboolean
+rsvg_paint_server_equal (gconstpointer a, gconstpointer b)
 {
-    RsvgPaintServer *result = g_new (RsvgPaintServer, 1);
-
-    result->refcnt = 1;
-    result->type = RSVG_PAINT_SERVER_PATTERN;
-    rsvg_pattern_fix_fallback (pattern);
-    result->core.pattern = pattern;
+    const RsvgPaintServer *psa = a, *psb = b;
+
+    if (psa->type != psb->type)
+        return FALSE;
+
+    switch (psa->type) {
+    case RSVG_PAINT_SERVER_SOLID:
+        return psa->core.colour.currentcolour == psb->core.colour.currentcolour
+            && psa->core.colour.rgb == psb->core.colour.rgb;
+    case RSVG_PAINT_SERVER_LIN_GRAD:
+        return psa->core.lingrad == psb->core.lingrad;
+    case RSVG_PAINT_SERVER_RAD_GRAD:
+        return psa->core.radgrad == psb->core.radgrad;
+    case RSVG_PAINT_SERVER_PATTERN:
+        return psa->core.pattern == psb->core.pattern;
+    }
 
-    return result;
+    return FALSE;
 }
 
 /**
  * rsvg_paint_server_parse: Parse an SVG paint specification.
- * @defs: Defs for looking up gradients.
+ * @defs: Defs for looking up gradients, and which own the result.
  * @str: The SVG paint specification string to parse.
  *
- * Parses the paint specification @str, creating a new paint server
- * object.
+ * Parses the paint specification @str.  Equal paint servers are shared
+ * by everything parsed into the same @defs, and live as long as it does.
  *
- * Return value: The newly created paint server, or NULL on error.
+ * Return value: The paint server, or NULL for none or on error.
  **/
 RsvgPaintServer *
 rsvg_paint_server_parse (gboolean * inherit, const RsvgDefs * defs, const char *str,
                          guint32 current_color)
 {
+    RsvgPaintServer ps;
     char *name;
-    guint32 rgb;
+
     if (inherit != NULL)
         *inherit = 1;
     if (!strcmp (str, "none"))
         return NULL;
 
+    ps.type = RSVG_PAINT_SERVER_SOLID;
+    ps.core.colour.currentcolour = FALSE;
+    ps.core.colour.rgb = 0;
+
     name = rsvg_get_url_string (str);
     if (name) {
         RsvgNode *val;
@@ -130,54 +116,27 @@ rsvg_paint_server_parse (gboolean * inherit, const RsvgDefs * defs, const char *
 
         if (val == NULL)
             return NULL;
-        if (!strcmp (val->type->str, "linearGradient"))
-            return rsvg_paint_server_lin_grad ((RsvgLinearGradient *) val);
-        else if (!strcmp (val->type->str, "radialGradient"))
-            return rsvg_paint_server_rad_grad ((RsvgRadialGradient *) val);
-        else if (!strcmp (val->type->str, "pattern"))
-            return rsvg_paint_server_pattern ((RsvgPattern *) val);
-        else
+        if (val->type == RSVG_NODE_TYPE_LINEAR_GRADIENT) {
+            ps.type = RSVG_PAINT_SERVER_LIN_GRAD;
+            ps.core.lingrad = (RsvgLinearGradient *) val;
+        } else if (val->type == RSVG_NODE_TYPE_RADIAL_GRADIENT) {
+            ps.type = RSVG_PAINT_SERVER_RAD_GRAD;
+            ps.core.radgrad = (RsvgRadialGradient *) val;
+        } else if (val->type == RSVG_NODE_TYPE_PATTERN) {
+            ps.type = RSVG_PAINT_SERVER_PATTERN;
+            ps.core.pattern = (RsvgPattern *) val;
+        } else
             return NULL;
     } else if (!strcmp (str, "inherit")) {
         if (inherit != NULL)
             *inherit = 0;
-        return rsvg_paint_server_solid (0);
     } else if (!strcmp (str, "currentColor")) {
-        RsvgPaintServer *ps;
-        ps = rsvg_paint_server_solid_current_colour ();
-        return ps;
+        ps.core.colour.currentcolour = TRUE;
     } else {
-        rgb = rsvg_css_parse_color (str, inherit);
-        return rsvg_paint_server_solid (rgb);
+        ps.core.colour.rgb = rsvg_css_parse_color (str, inherit);
     }
-}
-
-/**
- * rsvg_paint_server_ref: Reference a paint server object.
- * @ps: The paint server object to reference.
- **/
-void
-rsvg_paint_server_ref (RsvgPaintServer * ps)
-{
-    if (ps == NULL)
-        return;
-    ps->refcnt++;
-}
 
-/**
- * rsvg_paint_server_unref: Unreference a paint server object.
- * @ps: The paint server object to unreference.
- **/
-void
-rsvg_paint_server_unref (RsvgPaintServer * ps)
-{
-    if (ps == NULL)
-        return;
-    if (--ps->refcnt == 0) {
-        if (ps->type == RSVG_PAINT_SERVER_SOLID)
-            g_free (ps->core.colour);
-        g_free (ps);
-    }
+    return rsvg_defs_intern_paint_server (defs, &ps);
 }
 
 static void
@@ -222,10 +181,10 @@ rsvg_stop_set_atts (RsvgNode * self, RsvgHandle * ctx, RsvgPropertyBag * atts)
 }
 
 RsvgNode *
-rsvg_new_stop (void)
+rsvg_new_stop (RsvgArena * arena)
 {
-    RsvgGradientStop *stop = g_new (RsvgGradientStop, 1);
-    _rsvg_node_init (&stop->super);
+    RsvgGradientStop *stop = _rsvg_node_new (RsvgGradientStop, arena);
+    _rsvg_node_init (&stop->super, arena);
     stop->super.set_atts = rsvg_stop_set_atts;
     stop->offset = 0;
     stop->rgba = 0;
@@ -288,11 +247,11 @@ rsvg_linear_gradient_set_atts (RsvgNode * self, RsvgHandle * ctx, RsvgPropertyBa
 
 
 RsvgNode *
-rsvg_new_linear_gradient (void)
+rsvg_new_linear_gradient (RsvgArena * arena)
 {
     RsvgLinearGradient *grad = NULL;
-    grad = g_new (RsvgLinearGradient, 1);
-    _rsvg_node_init (&grad->super);
+    grad = _rsvg_node_new (RsvgLinearGradient, arena);
+    _rsvg_node_init (&grad->super, arena);
     _rsvg_affine_identity (grad->affine);
     grad->has_current_color = FALSE;
     grad->x1 = grad->y1 = grad->y2 = _rsvg_css_parse_length ("0");
@@ -369,11 +328,11 @@ rsvg_radial_gradient_set_atts (RsvgNode * self, RsvgHandle * ctx, RsvgPropertyBa
 }
 
 RsvgNode *
-rsvg_new_radial_gradient (void)
+rsvg_new_radial_gradient (RsvgArena * arena)
 {
 
-    RsvgRadialGradient *grad = g_new (RsvgRadialGradient, 1);
-    _rsvg_node_init (&grad->super);
+    RsvgRadialGradient *grad = _rsvg_node_new (RsvgRadialGradient, arena);
+    _rsvg_node_init (&grad->super, arena);
     _rsvg_affine_identity (grad->affine);
     grad->has_current_color = FALSE;
     grad->obj_bbox = TRUE;
@@ -450,10 +409,10 @@ rsvg_pattern_set_atts (RsvgNode * self, RsvgHandle * ctx, RsvgPropertyBag * atts
 
 
 RsvgNode *
-rsvg_new_pattern (void)
+rsvg_new_pattern (RsvgArena * arena)
 {
-    RsvgPattern *pattern = g_new (RsvgPattern, 1);
-    _rsvg_node_init (&pattern->super);
+    RsvgPattern *pattern = _rsvg_node_new (RsvgPattern, arena);
+    _rsvg_node_init (&pattern->super, arena);
     pattern->obj_bbox = TRUE;
     pattern->obj_cbbox = FALSE;
     pattern->x = pattern->y = pattern->width = pattern->height = _rsvg_css_parse_length ("0");
@@ -473,7 +432,7 @@ hasstop (GPtrArray * lookin)
 {
     unsigned int i;
     for (i = 0; i < lookin->len; i++) {
-        if (!strcmp (((RsvgNode *) g_ptr_array_index (lookin, i))->type->str, "stop"))
+        if (((RsvgNode *) g_ptr_array_index (lookin, i))->type == RSVG_NODE_TYPE_STOP)
             return 1;
     }
     return 0;
@@ -486,7 +445,7 @@ rsvg_linear_gradient_fix_fallback (RsvgLinearGradient * grad)
     int i;
     ufallback = grad->fallback;
     while (ufallback != NULL) {
-        if (!strcmp (ufallback->type->str, "linearGradient")) {
+        if (ufallback->type == RSVG_NODE_TYPE_LINEAR_GRADIENT) {
             RsvgLinearGradient *fallback = (RsvgLinearGradient *) ufallback;
             if (!grad->hasx1 && fallback->hasx1) {
                 grad->hasx1 = TRUE;
@@ -521,7 +480,7 @@ rsvg_linear_gradient_fix_fallback (RsvgLinearGradient * grad)
                 grad->super.children = fallback->super.children;
             }
             ufallback = fallback->fallback;
-        } else if (!strcmp (ufallback->type->str, "radialGradient")) {
+        } else if (ufallback->type == RSVG_NODE_TYPE_RADIAL_GRADIENT) {
             RsvgRadialGradient *fallback = (RsvgRadialGradient *) ufallback;
             if (!grad->hastransform && fallback->hastransform) {
                 grad->hastransform = TRUE;
@@ -551,7 +510,7 @@ rsvg_radial_gradient_fix_fallback (RsvgRadialGradient * grad)
     int i;
     ufallback = grad->fallback;
     while (ufallback != NULL) {
-        if (!strcmp (ufallback->type->str, "radialGradient")) {
+        if (ufallback->type == RSVG_NODE_TYPE_RADIAL_GRADIENT) {
             RsvgRadialGradient *fallback = (RsvgRadialGradient *) ufallback;
             if (!grad->hascx && fallback->hascx) {
                 grad->hascx = TRUE;
@@ -590,7 +549,7 @@ rsvg_radial_gradient_fix_fallback (RsvgRadialGradient * grad)
                 grad->super.children = fallback->super.children;
             }
             ufallback = fallback->fallback;
-        } else if (!strcmp (ufallback->type->str, "linearGradient")) {
+        } else if (ufallback->type == RSVG_NODE_TYPE_LINEAR_GRADIENT) {
             RsvgLinearGradient *fallback = (RsvgLinearGradient *) ufallback;
             if (!grad->hastransform && fallback->hastransform) {
                 grad->hastransform = TRUE;
@@ -38,8 +38,6 @@ typedef struct _RsvgRadialGradient RsvgRadialGradient;
 typedef struct _RsvgPattern RsvgPattern;
 typedef struct _RsvgSolidColour RsvgSolidColour;
 
-typedef struct _RsvgPaintServer RsvgPaintServer;
-
 typedef struct _RsvgPSCtx RsvgPSCtx;
 
 typedef enum {
@@ -121,9 +119,9 @@ typedef enum _RsvgPaintServerType RsvgPaintServerType;
 typedef union _RsvgPaintServerCore RsvgPaintServerCore;
 
 union _RsvgPaintServerCore {
+    RsvgSolidColour colour;
     RsvgLinearGradient *lingrad;
     RsvgRadialGradient *radgrad;
-    RsvgSolidColour *colour;
     RsvgPattern *pattern;
 };
 
@@ -134,8 +132,9 @@ enum _RsvgPaintServerType {
     RSVG_PAINT_SERVER_PATTERN
 };
 
+/* Paint servers are interned in the RsvgDefs they were parsed into, so
+   states only ever borrow them */
 struct _RsvgPaintServer {
-    int refcnt;
     RsvgPaintServerType type;
     RsvgPaintServerCore core;
 };
@@ -143,16 +142,17 @@ struct _RsvgPaintServer {
 /* Create a new paint server based on a specification string. */
 RsvgPaintServer	    *rsvg_paint_server_parse	(gboolean * inherit, const RsvgDefs * defs,
 						 const char *str, guint32 current_color);
-void		     rsvg_paint_server_ref	(RsvgPaintServer * ps);
-void		     rsvg_paint_server_unref	(RsvgPaintServer * ps);
+RsvgPaintServer	    *rsvg_paint_server_default_fill (void);
+guint		     rsvg_paint_server_hash	(gconstpointer key);
+gboolean	     rsvg_paint_server_equal	(gconstpointer a, gconstpointer b);
 RsvgRadialGradient  *rsvg_clone_radial_gradient (const RsvgRadialGradient * grad,
 						 gboolean * shallow_cloned);
 RsvgLinearGradient  *rsvg_clone_linear_gradient (const RsvgLinearGradient * grad,
 						 gboolean * shallow_cloned);
-RsvgNode *rsvg_new_linear_gradient  (void);
-RsvgNode *rsvg_new_radial_gradient  (void);
-RsvgNode *rsvg_new_stop		    (void);
-RsvgNode *rsvg_new_pattern	    (void);
+RsvgNode *rsvg_new_linear_gradient  (RsvgArena * arena);
+RsvgNode *rsvg_new_radial_gradient  (RsvgArena * arena);
+RsvgNode *rsvg_new_stop		    (RsvgArena * arena);
+RsvgNode *rsvg_new_pattern	    (RsvgArena * arena);
 void rsvg_pattern_fix_fallback		(RsvgPattern * pattern);
 void rsvg_linear_gradient_fix_fallback	(RsvgLinearGradient * grad);
 void rsvg_radial_gradient_fix_fallback	(RsvgRadialGradient * grad);
@@ -33,6 +33,7 @@
 #include <string.h>
 
 #include "rsvg-private.h"
+#include "rsvg-css.h"
 
 /* This module parses an SVG path element into an RsvgBpathDef.
 
@@ -403,10 +404,31 @@ rsvg_parse_path_do_cmd (RSVGParsePathCtx * ctx, gboolean final)
     }
 }
 
+/* the number of parameters that complete one @cmd segment; unknown commands
+   swallow their numbers one at a time */
+static int
+rsvg_path_cmd_n_params (char cmd)
+{
+    switch (cmd) {
+    case 'm':
+    case 'l':
+    case 't':
+        return 2;
+    case 'c':
+        return 6;
+    case 's':
+    case 'q':
+        return 4;
+    case 'a':
+        return 7;
+    default:
+        return 1;
+    }
+}
+
 static void
-rsvg_path_end_of_number (RSVGParsePathCtx * ctx, double val, int sign, int exp_sign, int exp)
+rsvg_path_end_of_number (RSVGParsePathCtx * ctx, double val)
 {
-    val *= sign * pow (10, exp_sign * exp);
     if (ctx->rel) {
       /* Handle relative coordinates. This switch statement attempts
 	 to determine _what_ the coords are relative to. This is
@@ -454,108 +476,65 @@ rsvg_path_end_of_number (RSVGParsePathCtx * ctx, double val, int sign, int exp_s
       }
     }
     ctx->params[ctx->param++] = val;
-    rsvg_parse_path_do_cmd (ctx, FALSE);    
 }
 
+/* Numbers are scanned whole by _rsvg_css_strtod, which rounds them
+   correctly, and a segment is only emitted once its last parameter has
+   been read. */
 static void
 rsvg_parse_path_data (RSVGParsePathCtx * ctx, const char *data)
 {
-    int i = 0;
-    double val = 0;
-    char c = 0;
-    gboolean in_num = FALSE;
-    gboolean in_frac = FALSE;
-    gboolean in_exp = FALSE;
-    gboolean exp_wait_sign = FALSE;
-    int sign = 0;
-    int exp = 0;
-    int exp_sign = 0;
-    double frac = 0.0;
-
-    in_num = FALSE;
-    for (i = 0;; i++) {
-        c = data[i];
-        if (c >= '0' && c <= '9') {
-            /* digit */
-            if (in_num) {
-                if (in_exp) {
-                    exp = (exp * 10) + c - '0';
-                    exp_wait_sign = FALSE;
-                } else if (in_frac)
-                    val += (frac *= 0.1) * (c - '0');
-                else
-                    val = (val * 10) + c - '0';
-            } else {
-                in_num = TRUE;
-                in_frac = FALSE;
-                in_exp = FALSE;
-                exp = 0;
-                exp_sign = 1;
-                exp_wait_sign = FALSE;
-                val = c - '0';
-                sign = 1;
+    const char *p = data;
+    char *end;
+    int n_params = rsvg_path_cmd_n_params (ctx->cmd);
+    double val;
+    char c;
+
+    while ((c = *p) != '\0') {
+        if ((c >= '0' && c <= '9') || c == '.' || c == '+' || c == '-') {
+            /* a sign or dot has to lead into digits to start a number */
+            if ((c == '+' || c == '-') && !(g_ascii_isdigit (p[1]) || p[1] == '.')) {
+                p++;
+                continue;
+            }
+            val = _rsvg_css_strtod (p, &end);
+            if (end == p) {
+                p++;
+                continue;
             }
-        } else if (c == '.') {
-	    if (in_frac) {
-	      rsvg_path_end_of_number(ctx, val, sign, exp_sign, exp);
-	      in_num = TRUE;
-	      in_frac = FALSE;
-	      in_exp = FALSE;
-	      exp = 0;
-	      exp_sign = 1;
-	      exp_wait_sign = FALSE;
-	      val = 0;
-	      sign = 1;
-	    }
-	    else if (!in_num) {
-                in_num = TRUE;
-                val = 0;
+            p = end;
+
+            rsvg_path_end_of_number (ctx, val);
+            if (ctx->param == n_params) {
+                rsvg_parse_path_do_cmd (ctx, FALSE);
+                n_params = rsvg_path_cmd_n_params (ctx->cmd);
             }
-            in_frac = TRUE;
-            frac = 1;
-        } else if ((c == 'E' || c == 'e') && in_num) {
-            in_exp = TRUE;
-            exp_wait_sign = TRUE;
-            exp = 0;
-            exp_sign = 1;
-        } else if ((c == '+' || c == '-') && in_exp) {
-            exp_sign = c == '+' ? 1 : -1;
-        } else if (in_num) {
-            /* end of number */
-	    rsvg_path_end_of_number(ctx, val, sign, exp_sign, exp);
-	    in_num = FALSE;
+            continue;
         }
 
-        if (c == '\0')
-            break;
-        else if ((c == '+' || c == '-') && !exp_wait_sign) {
-            sign = c == '+' ? 1 : -1;
-            val = 0;
-            in_num = TRUE;
-            in_frac = FALSE;
-            in_exp = FALSE;
-            exp = 0;
-            exp_sign = 1;
-            exp_wait_sign = FALSE;
-        } else if (c == 'z' || c == 'Z') {
+        if (c == 'z' || c == 'Z') {
             if (ctx->param)
                 rsvg_parse_path_do_cmd (ctx, TRUE);
             rsvg_bpath_def_closepath (ctx->bpath);
 
             ctx->cpx = ctx->rpx = ctx->bpath->bpath[ctx->bpath->n_bpath - 1].x3;
             ctx->cpy = ctx->rpy = ctx->bpath->bpath[ctx->bpath->n_bpath - 1].y3;
+            n_params = rsvg_path_cmd_n_params (ctx->cmd);
         } else if (c >= 'A' && c <= 'Z' && c != 'E') {
             if (ctx->param)
                 rsvg_parse_path_do_cmd (ctx, TRUE);
             ctx->cmd = c + 'a' - 'A';
             ctx->rel = FALSE;
+            n_params = rsvg_path_cmd_n_params (ctx->cmd);
         } else if (c >= 'a' && c <= 'z' && c != 'e') {
             if (ctx->param)
                 rsvg_parse_path_do_cmd (ctx, TRUE);
             ctx->cmd = c;
             ctx->rel = TRUE;
+            n_params = rsvg_path_cmd_n_params (ctx->cmd);
         }
         /* else c _should_ be whitespace or , */
+        p++;
     }
 }
 
@@ -565,10 +544,12 @@ rsvg_parse_path (const char *path_str)
     RSVGParsePathCtx ctx;
 
     ctx.bpath = rsvg_bpath_def_new ();
-    ctx.cpx = 0.0;
-    ctx.cpy = 0.0;
+    ctx.cpx = ctx.rpx = 0.0;
+    ctx.cpy = ctx.rpy = 0.0;
     ctx.cmd = 0;
+    ctx.rel = FALSE;
     ctx.param = 0;
+    memset (ctx.params, 0, sizeof (ctx.params));
 
     rsvg_parse_path_data (&ctx, path_str);
 
@@ -50,8 +50,11 @@ typedef struct _RsvgState RsvgState;
 typedef struct _RsvgDefs RsvgDefs;
 typedef struct _RsvgNode RsvgNode;
 typedef struct _RsvgFilter RsvgFilter;
+typedef struct _RsvgPaintServer RsvgPaintServer;
 typedef struct _RsvgNodeChars RsvgNodeChars;
 typedef struct _RsvgIRect RsvgIRect;
+typedef struct _RsvgArena RsvgArena;
+typedef struct _RsvgRecording RsvgRecording;
 
 /* prepare for gettext */
 #ifndef _
@@ -134,6 +137,8 @@ struct RsvgHandlePrivate {
     /* stack; there is a state for each element */
 
     RsvgDefs *defs;
+    /* owns node and state storage; NULL to allocate them individually */
+    RsvgArena *arena;
     guint nest_level;
     RsvgNode *currentnode;
     /* this is the root level of the displayable tree, essentially what the
@@ -178,7 +183,9 @@ typedef struct {
 
 struct RsvgDrawingCtx {
     RsvgRender *render;
-    GSList *state;
+    /* state stack, the first n_states are live */
+    GPtrArray *state;
+    guint n_states;
     GError **error;
     RsvgDefs *defs;
     gchar *base_uri;
@@ -187,6 +194,12 @@ struct RsvgDrawingCtx {
     RsvgViewBox vb;
     GSList *vb_stack;
     GSList *drawsub_stack;
+    /* RsvgMarker -> contents recorded for replay, see rsvg-marker.c */
+    GHashTable *marker_cache;
+    /* RsvgNode -> GSList of recorded <use> targets, see rsvg-structure.c */
+    GHashTable *use_cache;
+    /* RsvgNodeChars -> layout shaped for it by this render, see rsvg-text.c */
+    GHashTable *layout_cache;
 };
 
 /*Abstract base class for context for our backends (one as yet)*/
@@ -206,6 +219,8 @@ struct RsvgRender {
 						 double w, double h);
     GdkPixbuf	    *(*get_image_of_node)	(RsvgDrawingCtx * ctx, RsvgNode * drawable, 
 						 double w, double h);
+    void	     (*get_background)		(RsvgDrawingCtx * ctx, RsvgIRect region,
+						 GdkPixbuf * dest);
 };
 
 
@@ -251,10 +266,74 @@ struct _RsvgPropertyBag {
     GHashTable *props;
 };
 
+/* Numeric tag for each kind of node, assigned by the element factory in
+   rsvg-base.c. Elements that share an implementation (g, a and subImage;
+   switch and multiImage; image and subImageRef) share a tag. */
+typedef enum {
+    RSVG_NODE_TYPE_INVALID = 0,
+    RSVG_NODE_TYPE_UNKNOWN,     /* unrecognised element, drawn as a group */
+    RSVG_NODE_TYPE_CHARS,
+    RSVG_NODE_TYPE_CIRCLE,
+    RSVG_NODE_TYPE_CLIP_PATH,
+    RSVG_NODE_TYPE_CONICAL_GRADIENT,
+    RSVG_NODE_TYPE_DEFS,
+    RSVG_NODE_TYPE_ELLIPSE,
+    RSVG_NODE_TYPE_FILTER,
+    RSVG_NODE_TYPE_GROUP,
+    RSVG_NODE_TYPE_IMAGE,
+    RSVG_NODE_TYPE_LIGHT_SOURCE,
+    RSVG_NODE_TYPE_LINE,
+    RSVG_NODE_TYPE_LINEAR_GRADIENT,
+    RSVG_NODE_TYPE_MARKER,
+    RSVG_NODE_TYPE_MASK,
+    RSVG_NODE_TYPE_PATH,
+    RSVG_NODE_TYPE_PATTERN,
+    RSVG_NODE_TYPE_POLYGON,
+    RSVG_NODE_TYPE_POLYLINE,
+    RSVG_NODE_TYPE_RADIAL_GRADIENT,
+    RSVG_NODE_TYPE_RECT,
+    RSVG_NODE_TYPE_STOP,
+    RSVG_NODE_TYPE_SVG,
+    RSVG_NODE_TYPE_SWITCH,
+    RSVG_NODE_TYPE_SYMBOL,
+    RSVG_NODE_TYPE_TEXT,
+    RSVG_NODE_TYPE_TREF,
+    RSVG_NODE_TYPE_TSPAN,
+    RSVG_NODE_TYPE_USE,
+
+    /* feFuncR, feFuncG, feFuncB and feFuncA, in that order */
+    RSVG_NODE_TYPE_COMPONENT_TRANSFER_FUNCTION_R,
+    RSVG_NODE_TYPE_COMPONENT_TRANSFER_FUNCTION_G,
+    RSVG_NODE_TYPE_COMPONENT_TRANSFER_FUNCTION_B,
+    RSVG_NODE_TYPE_COMPONENT_TRANSFER_FUNCTION_A,
+
+    /* everything in this range is an RsvgFilterPrimitive */
+    RSVG_NODE_TYPE_FILTER_PRIMITIVE_FIRST,
+    RSVG_NODE_TYPE_FILTER_PRIMITIVE_BLEND = RSVG_NODE_TYPE_FILTER_PRIMITIVE_FIRST,
+    RSVG_NODE_TYPE_FILTER_PRIMITIVE_COLOUR_MATRIX,
+    RSVG_NODE_TYPE_FILTER_PRIMITIVE_COMPONENT_TRANSFER,
+    RSVG_NODE_TYPE_FILTER_PRIMITIVE_COMPOSITE,
+    RSVG_NODE_TYPE_FILTER_PRIMITIVE_CONVOLVE_MATRIX,
+    RSVG_NODE_TYPE_FILTER_PRIMITIVE_DIFFUSE_LIGHTING,
+    RSVG_NODE_TYPE_FILTER_PRIMITIVE_DISPLACEMENT_MAP,
+    RSVG_NODE_TYPE_FILTER_PRIMITIVE_ERODE,
+    RSVG_NODE_TYPE_FILTER_PRIMITIVE_FLOOD,
+    RSVG_NODE_TYPE_FILTER_PRIMITIVE_GAUSSIAN_BLUR,
+    RSVG_NODE_TYPE_FILTER_PRIMITIVE_IMAGE,
+    RSVG_NODE_TYPE_FILTER_PRIMITIVE_MERGE,
+    RSVG_NODE_TYPE_FILTER_PRIMITIVE_MERGE_NODE,
+    RSVG_NODE_TYPE_FILTER_PRIMITIVE_OFFSET,
+    RSVG_NODE_TYPE_FILTER_PRIMITIVE_SPECULAR_LIGHTING,
+    RSVG_NODE_TYPE_FILTER_PRIMITIVE_TILE,
+    RSVG_NODE_TYPE_FILTER_PRIMITIVE_TURBULENCE,
+    RSVG_NODE_TYPE_FILTER_PRIMITIVE_LAST = RSVG_NODE_TYPE_FILTER_PRIMITIVE_TURBULENCE
+} RsvgNodeType;
+
 struct _RsvgNode {
     RsvgState *state;
     RsvgNode *parent;
-    GString *type;
+    RsvgNodeType type;
+    gboolean in_arena;          /* node and state belong to the document's RsvgArena */
     GPtrArray *children;
     void (*free) (RsvgNode * self);
     void (*draw) (RsvgNode * self, RsvgDrawingCtx * ctx, int dominate);
@@ -291,11 +370,20 @@ GByteArray  *_rsvg_acquire_xlink_href_resource	(const char *href,
 void rsvg_pop_discrete_layer	(RsvgDrawingCtx * ctx);
 void rsvg_push_discrete_layer	(RsvgDrawingCtx * ctx);
 void rsvg_render_path		(RsvgDrawingCtx * ctx, const char *d);
+void rsvg_render_bpath		(RsvgDrawingCtx * ctx, const RsvgBpathDef * bpath_def);
 void rsvg_render_image		(RsvgDrawingCtx * ctx, GdkPixbuf * pb,
 				 double x, double y, double w, double h);
 void rsvg_render_free		(RsvgRender * render);
 void rsvg_add_clipping_rect	(RsvgDrawingCtx * ctx, double x, double y, double w, double h);
 GdkPixbuf *rsvg_get_image_of_node (RsvgDrawingCtx * ctx, RsvgNode * drawable, double w, double h);
+void rsvg_get_background		(RsvgDrawingCtx * ctx, RsvgIRect region, GdkPixbuf * dest);
+
+RsvgRecording *rsvg_recording_new	(RsvgDrawingCtx * ctx, gboolean draw);
+void rsvg_recording_finish		(RsvgDrawingCtx * ctx, RsvgRecording * recording);
+gboolean rsvg_recording_is_replayable	(const RsvgRecording * recording);
+void rsvg_recording_replay		(RsvgDrawingCtx * ctx, const RsvgRecording * recording,
+					 const double affine[6]);
+void rsvg_recording_free		(RsvgRecording * recording);
 
 
 void _rsvg_affine_invert (double dst_affine[6], const double src_affine[6]);
@@ -44,8 +44,7 @@ rsvg_node_path_free (RsvgNode * self)
     RsvgNodePath *z = (RsvgNodePath *) self;
     if (z->d)
         g_free (z->d);
-    _rsvg_node_finalize (&z->super);
-    g_free (z);
+    _rsvg_node_free (&z->super);
 }
 
 static void
@@ -84,11 +83,11 @@ rsvg_node_path_set_atts (RsvgNode * self, RsvgHandle * ctx, RsvgPropertyBag * at
 }
 
 RsvgNode *
-rsvg_new_path (void)
+rsvg_new_path (RsvgArena * arena)
 {
     RsvgNodePath *path;
-    path = g_new (RsvgNodePath, 1);
-    _rsvg_node_init (&path->super);
+    path = _rsvg_node_new (RsvgNodePath, arena);
+    _rsvg_node_init (&path->super, arena);
     path->d = NULL;
     path->super.free = rsvg_node_path_free;
     path->super.draw = rsvg_node_path_draw;
@@ -174,17 +173,16 @@ _rsvg_node_poly_free (RsvgNode * self)
     RsvgNodePoly *z = (RsvgNodePoly *) self;
     if (z->pointlist)
         g_free (z->pointlist);
-    _rsvg_node_finalize (&z->super);
-    g_free (z);
+    _rsvg_node_free (&z->super);
 }
 
 
 static RsvgNode *
-rsvg_new_any_poly (gboolean is_polyline)
+rsvg_new_any_poly (RsvgArena * arena, gboolean is_polyline)
 {
     RsvgNodePoly *poly;
-    poly = g_new (RsvgNodePoly, 1);
-    _rsvg_node_init (&poly->super);
+    poly = _rsvg_node_new (RsvgNodePoly, arena);
+    _rsvg_node_init (&poly->super, arena);
     poly->super.free = _rsvg_node_poly_free;
     poly->super.draw = _rsvg_node_poly_draw;
     poly->super.set_atts = _rsvg_node_poly_set_atts;
@@ -195,15 +193,15 @@ rsvg_new_any_poly (gboolean is_polyline)
 }
 
 RsvgNode *
-rsvg_new_polygon (void)
+rsvg_new_polygon (RsvgArena * arena)
 {
-    return rsvg_new_any_poly (FALSE);
+    return rsvg_new_any_poly (arena, FALSE);
 }
 
 RsvgNode *
-rsvg_new_polyline (void)
+rsvg_new_polyline (RsvgArena * arena)
 {
-    return rsvg_new_any_poly (TRUE);
+    return rsvg_new_any_poly (arena, TRUE);
 }
 
 
@@ -270,11 +268,11 @@ _rsvg_node_line_draw (RsvgNode * overself, RsvgDrawingCtx * ctx, int dominate)
 }
 
 RsvgNode *
-rsvg_new_line (void)
+rsvg_new_line (RsvgArena * arena)
 {
     RsvgNodeLine *line;
-    line = g_new (RsvgNodeLine, 1);
-    _rsvg_node_init (&line->super);
+    line = _rsvg_node_new (RsvgNodeLine, arena);
+    _rsvg_node_init (&line->super, arena);
     line->super.draw = _rsvg_node_line_draw;
     line->super.set_atts = _rsvg_node_line_set_atts;
     line->x1 = line->x2 = line->y1 = line->y2 = _rsvg_css_parse_length ("0");
@@ -443,11 +441,11 @@ _rsvg_node_rect_draw (RsvgNode * self, RsvgDrawingCtx * ctx, int dominate)
 }
 
 RsvgNode *
-rsvg_new_rect (void)
+rsvg_new_rect (RsvgArena * arena)
 {
     RsvgNodeRect *rect;
-    rect = g_new (RsvgNodeRect, 1);
-    _rsvg_node_init (&rect->super);
+    rect = _rsvg_node_new (RsvgNodeRect, arena);
+    _rsvg_node_init (&rect->super, arena);
     rect->super.draw = _rsvg_node_rect_draw;
     rect->super.set_atts = _rsvg_node_rect_set_atts;
     rect->x = rect->y = rect->w = rect->h = rect->rx = rect->ry = _rsvg_css_parse_length ("0");
@@ -569,11 +567,11 @@ _rsvg_node_circle_draw (RsvgNode * self, RsvgDrawingCtx * ctx, int dominate)
 }
 
 RsvgNode *
-rsvg_new_circle (void)
+rsvg_new_circle (RsvgArena * arena)
 {
     RsvgNodeCircle *circle;
-    circle = g_new (RsvgNodeCircle, 1);
-    _rsvg_node_init (&circle->super);
+    circle = _rsvg_node_new (RsvgNodeCircle, arena);
+    _rsvg_node_init (&circle->super, arena);
     circle->super.draw = _rsvg_node_circle_draw;
     circle->super.set_atts = _rsvg_node_circle_set_atts;
     circle->cx = circle->cy = circle->r = _rsvg_css_parse_length ("0");
@@ -695,11 +693,11 @@ _rsvg_node_ellipse_draw (RsvgNode * self, RsvgDrawingCtx * ctx, int dominate)
 }
 
 RsvgNode *
-rsvg_new_ellipse (void)
+rsvg_new_ellipse (RsvgArena * arena)
 {
     RsvgNodeEllipse *ellipse;
-    ellipse = g_new (RsvgNodeEllipse, 1);
-    _rsvg_node_init (&ellipse->super);
+    ellipse = _rsvg_node_new (RsvgNodeEllipse, arena);
+    _rsvg_node_init (&ellipse->super, arena);
     ellipse->super.draw = _rsvg_node_ellipse_draw;
     ellipse->super.set_atts = _rsvg_node_ellipse_set_atts;
     ellipse->cx = ellipse->cy = ellipse->rx = ellipse->ry = _rsvg_css_parse_length ("0");
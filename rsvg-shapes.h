@@ -33,13 +33,13 @@
 
 G_BEGIN_DECLS 
 
-RsvgNode * rsvg_new_path (void);
-RsvgNode *rsvg_new_polygon (void);
-RsvgNode *rsvg_new_polyline (void);
-RsvgNode *rsvg_new_line (void);
-RsvgNode *rsvg_new_rect (void);
-RsvgNode *rsvg_new_circle (void);
-RsvgNode *rsvg_new_ellipse (void);
+RsvgNode * rsvg_new_path (RsvgArena * arena);
+RsvgNode *rsvg_new_polygon (RsvgArena * arena);
+RsvgNode *rsvg_new_polyline (RsvgArena * arena);
+RsvgNode *rsvg_new_line (RsvgArena * arena);
+RsvgNode *rsvg_new_rect (RsvgArena * arena);
+RsvgNode *rsvg_new_circle (RsvgArena * arena);
+RsvgNode *rsvg_new_ellipse (RsvgArena * arena);
 
 
 typedef struct _RsvgNodePath RsvgNodePath;
@@ -73,6 +73,23 @@ _rsvg_node_draw_children (RsvgNode * self, RsvgDrawingCtx * ctx, int dominate)
         rsvg_pop_discrete_layer (ctx);
 }
 
+/* Like _rsvg_node_draw_children with @dominate 0, but with @affine applied
+   before the node's own transform.  The node itself is left alone, as it
+   may be drawn by other renders at the same time. */
+void
+_rsvg_node_draw_children_under (RsvgNode * self, RsvgDrawingCtx * ctx, const double affine[6])
+{
+    RsvgState *state;
+
+    rsvg_state_reinherit_top (ctx, self->state, 0);
+    state = rsvg_state_current (ctx);
+    _rsvg_affine_multiply (state->affine, affine, state->affine);
+
+    rsvg_push_discrete_layer (ctx);
+    _rsvg_node_draw_children (self, ctx, -1);
+    rsvg_pop_discrete_layer (ctx);
+}
+
 /* generic function that doesn't draw anything at all */
 static void
 _rsvg_node_draw_nothing (RsvgNode * self, RsvgDrawingCtx * ctx, int dominate)
@@ -84,17 +101,86 @@ _rsvg_node_dont_set_atts (RsvgNode * node, RsvgHandle * ctx, RsvgPropertyBag * a
 {
 }
 
+/* Node and state storage for one document is carved out of large blocks
+   and released all at once by _rsvg_arena_free.  Nodes still own heap
+   memory outside the arena (their children array, dash arrays and the
+   strings taken from their attributes), so each node's free function is
+   still called before the arena goes; it just doesn't free the node
+   itself.  Nodes made without an arena use g_malloc as before. */
+struct _RsvgArena {
+    GSList *blocks;
+    gchar *pos;
+    gsize left;
+    gsize size;                 /* of all the blocks */
+};
+
+#define RSVG_ARENA_BLOCK_SIZE 65536
+#define RSVG_ARENA_ALIGN 16
+
+RsvgArena *
+_rsvg_arena_new (void)
+{
+    return g_new0 (RsvgArena, 1);
+}
+
+gpointer
+_rsvg_arena_alloc (RsvgArena * arena, gsize size)
+{
+    gpointer mem;
+
+    size = (size + RSVG_ARENA_ALIGN - 1) & ~((gsize) RSVG_ARENA_ALIGN - 1);
+    if (size > arena->left) {
+        gsize block_size = MAX (size, RSVG_ARENA_BLOCK_SIZE);
+
+        arena->pos = g_malloc (block_size);
+        arena->left = block_size;
+        arena->size += block_size;
+        arena->blocks = g_slist_prepend (arena->blocks, arena->pos);
+    }
+
+    mem = arena->pos;
+    arena->pos += size;
+    arena->left -= size;
+    return mem;
+}
+
+/* Bytes held by @arena, used or not */
+gsize
+_rsvg_arena_size (const RsvgArena * arena)
+{
+    return arena->size;
+}
+
 void
-_rsvg_node_init (RsvgNode * self)
+_rsvg_arena_free (RsvgArena * arena)
+{
+    g_slist_foreach (arena->blocks, (GFunc) g_free, NULL);
+    g_slist_free (arena->blocks);
+    g_free (arena);
+}
+
+/* Storage for a node, from the document's arena when it has one */
+gpointer
+_rsvg_node_alloc (RsvgArena * arena, gsize size)
+{
+    if (arena != NULL)
+        return _rsvg_arena_alloc (arena, size);
+    return g_malloc (size);
+}
+
+/* @arena must be the one @self was allocated from */
+void
+_rsvg_node_init (RsvgNode * self, RsvgArena * arena)
 {
 	self->parent = NULL;
     self->children = g_ptr_array_new ();
-    self->state = g_new (RsvgState, 1);
+    self->state = _rsvg_node_new (RsvgState, arena);
+    self->in_arena = arena != NULL;
     rsvg_state_init (self->state);
     self->free = _rsvg_node_free;
     self->draw = _rsvg_node_draw_nothing;
     self->set_atts = _rsvg_node_dont_set_atts;
-    self->type = NULL;
+    self->type = RSVG_NODE_TYPE_INVALID;
 }
 
 void
@@ -102,20 +188,19 @@ _rsvg_node_finalize (RsvgNode * self)
 {
     if (self->state != NULL) {
         rsvg_state_finalize (self->state);
-        g_free (self->state);
+        if (!self->in_arena)
+            g_free (self->state);
     }
     if (self->children != NULL)
         g_ptr_array_free (self->children, TRUE);
-    if (self->type != NULL)
-        g_string_free (self->type, TRUE);
-
 }
 
 void
 _rsvg_node_free (RsvgNode * self)
 {
     _rsvg_node_finalize (self);
-    g_free (self);
+    if (!self->in_arena)
+        g_free (self);
 }
 
 static void
@@ -136,11 +221,11 @@ rsvg_node_group_set_atts (RsvgNode * self, RsvgHandle * ctx, RsvgPropertyBag * a
 }
 
 RsvgNode *
-rsvg_new_group (void)
+rsvg_new_group (RsvgArena * arena)
 {
     RsvgNodeGroup *group;
-    group = g_new (RsvgNodeGroup, 1);
-    _rsvg_node_init (&group->super);
+    group = _rsvg_node_new (RsvgNodeGroup, arena);
+    _rsvg_node_init (&group->super, arena);
     group->super.draw = _rsvg_node_draw_children;
     group->super.set_atts = rsvg_node_group_set_atts;
     return &group->super;
@@ -160,21 +245,226 @@ rsvg_node_group_pack (RsvgNode * self, RsvgNode * child)
     child->parent = self;
 }
 
-static gboolean
-rsvg_node_is_ancestor (RsvgNode * potential_ancestor, RsvgNode * potential_descendant)
+/* What a <use> draws of its target depends only on the inherited state
+   and the viewport, not on where it is placed, so each drawing context
+   records a target once per distinct state, while drawing it the first
+   time, and replays it under every transform that state comes with.  The
+   few most recent states are kept per target. */
+
+#define RSVG_USE_CACHE_ENTRIES 4
+
+typedef struct {
+    double vb_w, vb_h;
+    gboolean has_pango;
+    RsvgState state;            /* recorded under, transform aside */
+    double inverse[6];          /* undoes the transform recorded under */
+    RsvgRecording *recording;
+} RsvgUseCacheEntry;
+
+static void
+rsvg_use_cache_entry_free (RsvgUseCacheEntry * entry)
+{
+    rsvg_recording_free (entry->recording);
+    rsvg_state_finalize (&entry->state);
+    g_free (entry);
+}
+
+static void
+rsvg_use_cache_entries_free (GSList * entries)
 {
-    /* work our way up the family tree */
-    while (TRUE) {
-        if (potential_ancestor == potential_descendant)
-            return TRUE;
-        else if (potential_descendant->parent == NULL)
-            return FALSE;
-        else
-            potential_descendant = potential_descendant->parent;
+    g_slist_foreach (entries, (GFunc) rsvg_use_cache_entry_free, NULL);
+    g_slist_free (entries);
+}
+
+static void
+rsvg_node_use_draw_target_direct (RsvgNode * target, RsvgDrawingCtx * ctx)
+{
+    rsvg_state_push (ctx);
+    if (target->type == RSVG_NODE_TYPE_SYMBOL)
+        _rsvg_node_draw_children (target, ctx, 1);
+    else
+        rsvg_node_draw (target, ctx, 1);
+    rsvg_state_pop (ctx);
+}
+
+/* Draws @target and keeps what it drew as the newest entry for it */
+static void
+rsvg_node_use_record_target (RsvgNode * target, RsvgDrawingCtx * ctx)
+{
+    RsvgUseCacheEntry *entry = g_new0 (RsvgUseCacheEntry, 1);
+    RsvgState *state = rsvg_state_current (ctx);
+    GSList *entries, *link;
+    guint n;
+
+    entry->vb_w = ctx->vb.w;
+    entry->vb_h = ctx->vb.h;
+    entry->has_pango = ctx->render->render_pango_layout != NULL;
+    rsvg_state_init (&entry->state);
+    rsvg_state_clone (&entry->state, state);
+    _rsvg_affine_invert (entry->inverse, state->affine);
+
+    entry->recording = rsvg_recording_new (ctx, TRUE);
+    rsvg_node_use_draw_target_direct (target, ctx);
+    rsvg_recording_finish (ctx, entry->recording);
+
+    entries = g_hash_table_lookup (ctx->use_cache, target);
+    entries = g_slist_prepend (entries, entry);
+
+    n = g_slist_length (entries);
+    if (n > RSVG_USE_CACHE_ENTRIES) {
+        link = g_slist_nth (entries, n - 1);
+        entries = g_slist_remove_link (entries, link);
+        rsvg_use_cache_entries_free (link);
+    }
+
+    g_hash_table_steal (ctx->use_cache, target);
+    g_hash_table_insert (ctx->use_cache, target, entries);
+}
+
+/* The entry for @target recorded under the current state, or NULL */
+static RsvgUseCacheEntry *
+rsvg_node_use_lookup_target (RsvgNode * target, RsvgDrawingCtx * ctx)
+{
+    RsvgState *state = rsvg_state_current (ctx);
+    gboolean has_pango = ctx->render->render_pango_layout != NULL;
+    RsvgUseCacheEntry *entry;
+    GSList *entries, *link;
+
+    if (ctx->use_cache == NULL)
+        ctx->use_cache = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+                                                (GDestroyNotify) rsvg_use_cache_entries_free);
+
+    entries = g_hash_table_lookup (ctx->use_cache, target);
+    for (link = entries; link != NULL; link = link->next) {
+        entry = link->data;
+        if (entry->vb_w == ctx->vb.w && entry->vb_h == ctx->vb.h
+            && entry->has_pango == has_pango
+            && rsvg_state_equal_except_affine (&entry->state, state))
+            break;
+    }
+
+    if (link == NULL)
+        return NULL;
+
+    entries = g_slist_remove_link (entries, link);
+    entries = g_slist_concat (link, entries);
+    g_hash_table_steal (ctx->use_cache, target);
+    g_hash_table_insert (ctx->use_cache, target, entries);
+    return entry;
+}
+
+static void
+rsvg_node_use_draw_target (RsvgNode * target, RsvgDrawingCtx * ctx)
+{
+    double *affine = rsvg_state_current (ctx)->affine;
+    RsvgUseCacheEntry *entry;
+    double replay[6];
+
+    /* drawing a sub-node only visits part of the tree, so never record
+       then, nor under a transform that can't be undone for replaying */
+    if (ctx->drawsub_stack != NULL || affine[0] * affine[3] - affine[1] * affine[2] == 0) {
+        rsvg_node_use_draw_target_direct (target, ctx);
+        return;
     }
 
-    g_assert_not_reached ();
-    return FALSE;
+    entry = rsvg_node_use_lookup_target (target, ctx);
+    if (entry == NULL)
+        rsvg_node_use_record_target (target, ctx);
+    else if (rsvg_recording_is_replayable (entry->recording)) {
+        _rsvg_affine_multiply (replay, entry->inverse, affine);
+        rsvg_recording_replay (ctx, entry->recording, replay);
+    } else
+        rsvg_node_use_draw_target_direct (target, ctx);
+}
+
+enum {
+    RSVG_USE_TARGET_VISITING = 1,
+    RSVG_USE_TARGET_DONE
+};
+
+/* Subtrees that draw nothing in place, waiting to be walked on their own */
+typedef struct {
+    GQueue *queue;
+    GHashTable *queued;
+} RsvgUseCyclesPending;
+
+/* Walks what drawing @node in place draws.  <defs>, <mask>, <clipPath>,
+   <marker>, <pattern> and the like draw nothing in place, as in draw, so
+   they are queued instead: they are drawn from whatever refers to them,
+   which is a walk of its own. */
+static void
+rsvg_node_break_use_cycles_in (RsvgNode * node, GHashTable * visited,
+                               RsvgUseCyclesPending * pending)
+{
+    guint i;
+
+    if (node->type == RSVG_NODE_TYPE_USE) {
+        RsvgNodeUse *use = (RsvgNodeUse *) node;
+        RsvgNode *target = use->link;
+
+        /* a <use> of something that draws nothing in place, like a <mask>,
+           draws nothing; only a <symbol> gets its children drawn */
+        if (target != NULL
+            && (target->draw != _rsvg_node_draw_nothing
+                || target->type == RSVG_NODE_TYPE_SYMBOL)) {
+            switch (GPOINTER_TO_INT (g_hash_table_lookup (visited, target))) {
+            case RSVG_USE_TARGET_VISITING:
+                /* the target is being drawn already, so would draw itself */
+                use->link = NULL;
+                break;
+            case RSVG_USE_TARGET_DONE:
+                break;
+            default:
+                g_hash_table_insert (visited, target,
+                                     GINT_TO_POINTER (RSVG_USE_TARGET_VISITING));
+                rsvg_node_break_use_cycles_in (target, visited, pending);
+                g_hash_table_insert (visited, target, GINT_TO_POINTER (RSVG_USE_TARGET_DONE));
+                break;
+            }
+        }
+    }
+
+    for (i = 0; i < node->children->len; i++) {
+        RsvgNode *child = g_ptr_array_index (node->children, i);
+
+        if (child->draw != _rsvg_node_draw_nothing)
+            rsvg_node_break_use_cycles_in (child, visited, pending);
+        else if (g_hash_table_lookup (pending->queued, child) == NULL) {
+            g_hash_table_insert (pending->queued, child, child);
+            g_queue_push_tail (pending->queue, child);
+        }
+    }
+}
+
+/**
+ * rsvg_node_break_use_cycles: Unlinks every <use> that would end up drawing
+ * itself, whether it points at one of its ancestors or goes round through
+ * other <use> elements.  Run once all links are resolved, so that drawing
+ * never has to check.
+ **/
+void
+rsvg_node_break_use_cycles (RsvgNode * root)
+{
+    RsvgUseCyclesPending pending;
+    GHashTable *visited;
+
+    if (root == NULL)
+        return;
+
+    pending.queue = g_queue_new ();
+    pending.queued = g_hash_table_new (g_direct_hash, g_direct_equal);
+    g_hash_table_insert (pending.queued, root, root);
+    g_queue_push_tail (pending.queue, root);
+
+    while ((root = g_queue_pop_head (pending.queue)) != NULL) {
+        visited = g_hash_table_new (g_direct_hash, g_direct_equal);
+        g_hash_table_insert (visited, root, GINT_TO_POINTER (RSVG_USE_TARGET_VISITING));
+        rsvg_node_break_use_cycles_in (root, visited, &pending);
+        g_hash_table_destroy (visited);
+    }
+
+    g_hash_table_destroy (pending.queued);
+    g_queue_free (pending.queue);
 }
 
 static void
@@ -194,21 +484,18 @@ rsvg_node_use_draw (RsvgNode * self, RsvgDrawingCtx * ctx, int dominate)
 
     child = use->link;
 
-    /* If it can find nothing to draw... draw nothing */
+    /* If it can find nothing to draw... draw nothing; links that would
+       draw themselves were cut by rsvg_node_break_use_cycles */
     if (!child)
         return;
-    else if (rsvg_node_is_ancestor (child, self))       /* or, if we're <use>'ing ourself */
-        return;
 
     state = rsvg_state_current (ctx);
-    if (strcmp (child->type->str, "symbol")) {
+    if (child->type != RSVG_NODE_TYPE_SYMBOL) {
         _rsvg_affine_translate (affine, x, y);
         _rsvg_affine_multiply (state->affine, affine, state->affine);
 
         rsvg_push_discrete_layer (ctx);
-        rsvg_state_push (ctx);
-        rsvg_node_draw (child, ctx, 1);
-        rsvg_state_pop (ctx);
+        rsvg_node_use_draw_target (child, ctx);
         rsvg_pop_discrete_layer (ctx);
     } else {
         RsvgNodeSymbol *symbol = (RsvgNodeSymbol *) child;
@@ -235,9 +522,7 @@ rsvg_node_use_draw (RsvgNode * self, RsvgDrawingCtx * ctx, int dominate)
             rsvg_push_discrete_layer (ctx);
         }
 
-        rsvg_state_push (ctx);
-        _rsvg_node_draw_children (child, ctx, 1);
-        rsvg_state_pop (ctx);
+        rsvg_node_use_draw_target (child, ctx);
         rsvg_pop_discrete_layer (ctx);
         if (symbol->vbox.active)
             _rsvg_pop_view_box (ctx);
@@ -350,11 +635,11 @@ rsvg_node_svg_set_atts (RsvgNode * self, RsvgHandle * ctx, RsvgPropertyBag * att
 }
 
 RsvgNode *
-rsvg_new_svg (void)
+rsvg_new_svg (RsvgArena * arena)
 {
     RsvgNodeSvg *svg;
-    svg = g_new (RsvgNodeSvg, 1);
-    _rsvg_node_init (&svg->super);
+    svg = _rsvg_node_new (RsvgNodeSvg, arena);
+    _rsvg_node_init (&svg->super, arena);
     svg->vbox.active = FALSE;
     svg->preserve_aspect_ratio = RSVG_ASPECT_RATIO_XMID_YMID;
     svg->x = _rsvg_css_parse_length ("0");
@@ -396,11 +681,11 @@ rsvg_node_use_set_atts (RsvgNode * self, RsvgHandle * ctx, RsvgPropertyBag * att
 }
 
 RsvgNode *
-rsvg_new_use ()
+rsvg_new_use (RsvgArena * arena)
 {
     RsvgNodeUse *use;
-    use = g_new (RsvgNodeUse, 1);
-    _rsvg_node_init (&use->super);
+    use = _rsvg_node_new (RsvgNodeUse, arena);
+    _rsvg_node_init (&use->super, arena);
     use->super.draw = rsvg_node_use_draw;
     use->super.set_atts = rsvg_node_use_set_atts;
     use->x = _rsvg_css_parse_length ("0");
@@ -437,11 +722,11 @@ rsvg_node_symbol_set_atts (RsvgNode * self, RsvgHandle * ctx, RsvgPropertyBag *
 
 
 RsvgNode *
-rsvg_new_symbol (void)
+rsvg_new_symbol (RsvgArena * arena)
 {
     RsvgNodeSymbol *symbol;
-    symbol = g_new (RsvgNodeSymbol, 1);
-    _rsvg_node_init (&symbol->super);
+    symbol = _rsvg_node_new (RsvgNodeSymbol, arena);
+    _rsvg_node_init (&symbol->super, arena);
     symbol->vbox.active = FALSE;
     symbol->preserve_aspect_ratio = RSVG_ASPECT_RATIO_XMID_YMID;
     symbol->super.draw = _rsvg_node_draw_nothing;
@@ -450,11 +735,11 @@ rsvg_new_symbol (void)
 }
 
 RsvgNode *
-rsvg_new_defs ()
+rsvg_new_defs (RsvgArena * arena)
 {
     RsvgNodeGroup *group;
-    group = g_new (RsvgNodeGroup, 1);
-    _rsvg_node_init (&group->super);
+    group = _rsvg_node_new (RsvgNodeGroup, arena);
+    _rsvg_node_init (&group->super, arena);
     group->super.draw = _rsvg_node_draw_nothing;
     group->super.set_atts = rsvg_node_group_set_atts;
     return &group->super;
@@ -485,11 +770,11 @@ _rsvg_node_switch_draw (RsvgNode * self, RsvgDrawingCtx * ctx, int dominate)
 }
 
 RsvgNode *
-rsvg_new_switch (void)
+rsvg_new_switch (RsvgArena * arena)
 {
     RsvgNodeGroup *group;
-    group = g_new (RsvgNodeGroup, 1);
-    _rsvg_node_init (&group->super);
+    group = _rsvg_node_new (RsvgNodeGroup, arena);
+    _rsvg_node_init (&group->super, arena);
     group->super.draw = _rsvg_node_switch_draw;
     group->super.set_atts = rsvg_node_group_set_atts;
     return &group->super;
@@ -35,12 +35,12 @@
 
 G_BEGIN_DECLS 
 
-RsvgNode * rsvg_new_use (void);
-RsvgNode *rsvg_new_symbol (void);
-RsvgNode *rsvg_new_svg (void);
-RsvgNode *rsvg_new_defs (void);
-RsvgNode *rsvg_new_group (void);
-RsvgNode *rsvg_new_switch (void);
+RsvgNode * rsvg_new_use (RsvgArena * arena);
+RsvgNode *rsvg_new_symbol (RsvgArena * arena);
+RsvgNode *rsvg_new_svg (RsvgArena * arena);
+RsvgNode *rsvg_new_defs (RsvgArena * arena);
+RsvgNode *rsvg_new_group (RsvgArena * arena);
+RsvgNode *rsvg_new_switch (RsvgArena * arena);
 
 typedef struct _RsvgNodeGroup RsvgNodeGroup;
 typedef struct _RsvgNodeUse RsvgNodeUse;
@@ -76,9 +76,21 @@ void rsvg_node_group_pack	(RsvgNode * self, RsvgNode * child);
 
 void rsvg_node_draw		(RsvgNode * self, RsvgDrawingCtx * ctx, int dominate);
 void _rsvg_node_draw_children	(RsvgNode * self, RsvgDrawingCtx * ctx, int dominate);
+void _rsvg_node_draw_children_under (RsvgNode * self, RsvgDrawingCtx * ctx,
+				       const double affine[6]);
+void rsvg_node_break_use_cycles	(RsvgNode * root);
 void _rsvg_node_finalize	(RsvgNode * self);
 void _rsvg_node_free		(RsvgNode * self);
-void _rsvg_node_init		(RsvgNode * self);
+void _rsvg_node_init		(RsvgNode * self, RsvgArena * arena);
+gpointer _rsvg_node_alloc	(RsvgArena * arena, gsize size);
+
+#define _rsvg_node_new(struct_type, arena) \
+    ((struct_type *) _rsvg_node_alloc ((arena), sizeof (struct_type)))
+
+RsvgArena *_rsvg_arena_new	(void);
+gpointer _rsvg_arena_alloc	(RsvgArena * arena, gsize size);
+gsize _rsvg_arena_size		(const RsvgArena * arena);
+void _rsvg_arena_free		(RsvgArena * arena);
 
 G_END_DECLS
 
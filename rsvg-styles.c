@@ -29,6 +29,7 @@
 #include "rsvg-private.h"
 #include "rsvg-filter.h"
 #include "rsvg-css.h"
+#include "rsvg-defs.h"
 #include "rsvg-styles.h"
 #include "rsvg-shapes.h"
 #include "rsvg-mask.h"
@@ -58,7 +59,7 @@ rsvg_state_init (RsvgState * state)
     state->mask = NULL;
     state->opacity = 0xff;
     state->adobe_blend = 0;
-    state->fill = rsvg_paint_server_parse (NULL, NULL, "#000", 0);
+    state->fill = rsvg_paint_server_default_fill ();
     state->fill_opacity = 0xff;
     state->stroke_opacity = 0xff;
     state->stroke_width = _rsvg_css_parse_length ("1");
@@ -74,7 +75,7 @@ rsvg_state_init (RsvgState * state)
     state->flood_color = 0;
     state->flood_opacity = 255;
 
-    state->font_family = g_strdup (RSVG_DEFAULT_FONT);
+    state->font_family = g_intern_static_string (RSVG_DEFAULT_FONT);
     state->font_size = _rsvg_css_parse_length ("12.0");
     state->font_style = PANGO_STYLE_NORMAL;
     state->font_variant = PANGO_VARIANT_NORMAL;
@@ -134,6 +135,50 @@ rsvg_state_init (RsvgState * state)
 	state->has_text_rendering_type = FALSE;
 }
 
+/* Compares everything but the two transforms, field by field.  Paint
+   servers and strings are interned, so comparing their pointers is
+   enough. */
+gboolean
+rsvg_state_equal_except_affine (const RsvgState * a, const RsvgState * b)
+{
+#define EQ(field) (a->field == b->field)
+#define EQ_LENGTH(field) (EQ (field.length) && EQ (field.factor))
+    if (!(EQ (filter) && EQ (mask) && EQ (clip_path_ref) && EQ (adobe_blend) && EQ (opacity)
+          && EQ (fill) && EQ (has_fill_server) && EQ (fill_opacity) && EQ (has_fill_opacity)
+          && EQ (fill_rule) && EQ (has_fill_rule) && EQ (clip_rule) && EQ (has_clip_rule)
+          && EQ (overflow) && EQ (has_overflow)
+          && EQ (stroke) && EQ (has_stroke_server) && EQ (stroke_opacity)
+          && EQ (has_stroke_opacity) && EQ_LENGTH (stroke_width) && EQ (has_stroke_width)
+          && EQ (miter_limit) && EQ (has_miter_limit)
+          && EQ (cap) && EQ (has_cap) && EQ (join) && EQ (has_join)
+          && EQ_LENGTH (font_size) && EQ (has_font_size)
+          && EQ (font_family) && EQ (has_font_family) && EQ (lang) && EQ (has_lang)
+          && EQ (font_style) && EQ (has_font_style) && EQ (font_variant) && EQ (has_font_variant)
+          && EQ (font_weight) && EQ (has_font_weight) && EQ (font_stretch)
+          && EQ (has_font_stretch) && EQ (font_decor) && EQ (has_font_decor)
+          && EQ (text_dir) && EQ (has_text_dir) && EQ (unicode_bidi) && EQ (has_unicode_bidi)
+          && EQ (text_anchor) && EQ (has_text_anchor)
+          && EQ_LENGTH (letter_spacing) && EQ (has_letter_spacing) && EQ (text_offset)
+          && EQ (stop_color) && EQ (has_stop_color) && EQ (stop_opacity) && EQ (has_stop_opacity)
+          && EQ (visible) && EQ (has_visible) && EQ (space_preserve) && EQ (has_space_preserve)
+          && EQ (has_cond) && EQ (cond_true)
+          && EQ_LENGTH (dash.offset) && EQ (dash.n_dash) && EQ (has_dash) && EQ (has_dashoffset)
+          && EQ (current_color) && EQ (has_current_color)
+          && EQ (flood_color) && EQ (has_flood_color)
+          && EQ (flood_opacity) && EQ (has_flood_opacity)
+          && EQ (startMarker) && EQ (middleMarker) && EQ (endMarker)
+          && EQ (has_startMarker) && EQ (has_middleMarker) && EQ (has_endMarker)
+          && EQ (comp_op) && EQ (enable_background)
+          && EQ (shape_rendering_type) && EQ (has_shape_rendering_type)
+          && EQ (text_rendering_type) && EQ (has_text_rendering_type)))
+        return FALSE;
+#undef EQ_LENGTH
+#undef EQ
+
+    return a->dash.n_dash == 0
+        || memcmp (a->dash.dash, b->dash.dash, a->dash.n_dash * sizeof (double)) == 0;
+}
+
 typedef int (*InheritanceFunction) (int dst, int src);
 
 void
@@ -144,10 +189,6 @@ rsvg_state_clone (RsvgState * dst, const RsvgState * src)
     rsvg_state_finalize (dst);
 
     *dst = *src;
-    dst->font_family = g_strdup (src->font_family);
-    dst->lang = g_strdup (src->lang);
-    rsvg_paint_server_ref (dst->fill);
-    rsvg_paint_server_ref (dst->stroke);
 
     if (src->dash.n_dash > 0) {
         dst->dash.dash = g_new (gdouble, src->dash.n_dash);
@@ -175,12 +216,8 @@ rsvg_state_inherit_run (RsvgState * dst, const RsvgState * src,
         dst->flood_color = src->flood_color;
     if (function (dst->has_flood_opacity, src->has_flood_opacity))
         dst->flood_opacity = src->flood_opacity;
-    if (function (dst->has_fill_server, src->has_fill_server)) {
-        rsvg_paint_server_ref (src->fill);
-        if (dst->fill)
-            rsvg_paint_server_unref (dst->fill);
+    if (function (dst->has_fill_server, src->has_fill_server))
         dst->fill = src->fill;
-    }
     if (function (dst->has_fill_opacity, src->has_fill_opacity))
         dst->fill_opacity = src->fill_opacity;
     if (function (dst->has_fill_rule, src->has_fill_rule))
@@ -189,12 +226,8 @@ rsvg_state_inherit_run (RsvgState * dst, const RsvgState * src,
         dst->clip_rule = src->clip_rule;
     if (function (dst->overflow, src->overflow))
         dst->overflow = src->overflow;
-    if (function (dst->has_stroke_server, src->has_stroke_server)) {
-        rsvg_paint_server_ref (src->stroke);
-        if (dst->stroke)
-            rsvg_paint_server_unref (dst->stroke);
+    if (function (dst->has_stroke_server, src->has_stroke_server))
         dst->stroke = src->stroke;
-    }
     if (function (dst->has_stroke_opacity, src->has_stroke_opacity))
         dst->stroke_opacity = src->stroke_opacity;
     if (function (dst->has_stroke_width, src->has_stroke_width))
@@ -242,10 +275,8 @@ rsvg_state_inherit_run (RsvgState * dst, const RsvgState * src,
 	if (function (dst->has_text_rendering_type, src->has_text_rendering_type))
 		dst->text_rendering_type = src->text_rendering_type;
 
-    if (function (dst->has_font_family, src->has_font_family)) {
-        g_free (dst->font_family);      /* font_family is always set to something */
-        dst->font_family = g_strdup (src->font_family);
-    }
+    if (function (dst->has_font_family, src->has_font_family))
+        dst->font_family = src->font_family;
 
 	if (function (dst->has_space_preserve, src->has_space_preserve))
 		dst->space_preserve = src->space_preserve;
@@ -253,11 +284,8 @@ rsvg_state_inherit_run (RsvgState * dst, const RsvgState * src,
 	if (function (dst->has_visible, src->has_visible))
 		dst->visible = src->visible;
 
-    if (function (dst->has_lang, src->has_lang)) {
-        if (dst->has_lang)
-            g_free (dst->lang);
-        dst->lang = g_strdup (src->lang);
-    }
+    if (function (dst->has_lang, src->has_lang))
+        dst->lang = src->lang;
 
     if (src->dash.n_dash > 0 && (function (dst->has_dash, src->has_dash))) {
         if (dst->has_dash)
@@ -363,358 +391,571 @@ rsvg_state_inherit (RsvgState * dst, const RsvgState * src)
 void
 rsvg_state_finalize (RsvgState * state)
 {
-    g_free (state->font_family);
-    g_free (state->lang);
-    rsvg_paint_server_unref (state->fill);
-    rsvg_paint_server_unref (state->stroke);
-
     if (state->dash.n_dash != 0)
         g_free (state->dash.dash);
 }
 
-/* Parse a CSS2 style argument, setting the SVG context attributes. */
+/* Properties understood by rsvg_parse_style_arg.  Presentation attributes
+ * are applied in this order, which decides between properties that set the
+ * same field (display and visibility, direction and writing-mode). */
+typedef enum {
+    RSVG_STYLE_PROP_A_ADOBE_BLENDING_MODE,
+    RSVG_STYLE_PROP_CLIP_PATH,
+    RSVG_STYLE_PROP_CLIP_RULE,
+    RSVG_STYLE_PROP_COLOR,
+    RSVG_STYLE_PROP_DIRECTION,
+    RSVG_STYLE_PROP_DISPLAY,
+    RSVG_STYLE_PROP_ENABLE_BACKGROUND,
+    RSVG_STYLE_PROP_COMP_OP,
+    RSVG_STYLE_PROP_FILL,
+    RSVG_STYLE_PROP_FILL_OPACITY,
+    RSVG_STYLE_PROP_FILL_RULE,
+    RSVG_STYLE_PROP_FILTER,
+    RSVG_STYLE_PROP_FLOOD_COLOR,
+    RSVG_STYLE_PROP_FLOOD_OPACITY,
+    RSVG_STYLE_PROP_FONT_FAMILY,
+    RSVG_STYLE_PROP_FONT_SIZE,
+    RSVG_STYLE_PROP_FONT_STRETCH,
+    RSVG_STYLE_PROP_FONT_STYLE,
+    RSVG_STYLE_PROP_FONT_VARIANT,
+    RSVG_STYLE_PROP_FONT_WEIGHT,
+    RSVG_STYLE_PROP_MARKER_END,
+    RSVG_STYLE_PROP_MASK,
+    RSVG_STYLE_PROP_MARKER_MID,
+    RSVG_STYLE_PROP_MARKER_START,
+    RSVG_STYLE_PROP_OPACITY,
+    RSVG_STYLE_PROP_OVERFLOW,
+    RSVG_STYLE_PROP_STOP_COLOR,
+    RSVG_STYLE_PROP_STOP_OPACITY,
+    RSVG_STYLE_PROP_STROKE,
+    RSVG_STYLE_PROP_STROKE_DASHARRAY,
+    RSVG_STYLE_PROP_STROKE_DASHOFFSET,
+    RSVG_STYLE_PROP_STROKE_LINECAP,
+    RSVG_STYLE_PROP_STROKE_LINEJOIN,
+    RSVG_STYLE_PROP_STROKE_MITERLIMIT,
+    RSVG_STYLE_PROP_STROKE_OPACITY,
+    RSVG_STYLE_PROP_STROKE_WIDTH,
+    RSVG_STYLE_PROP_TEXT_ANCHOR,
+    RSVG_STYLE_PROP_TEXT_DECORATION,
+    RSVG_STYLE_PROP_UNICODE_BIDI,
+    RSVG_STYLE_PROP_LETTER_SPACING,
+    RSVG_STYLE_PROP_VISIBILITY,
+    RSVG_STYLE_PROP_WRITING_MODE,
+    RSVG_STYLE_PROP_XML_LANG,
+    RSVG_STYLE_PROP_XML_SPACE,
+    /* only recognised inside style="" and stylesheets */
+    RSVG_STYLE_PROP_SHAPE_RENDERING,
+    RSVG_STYLE_PROP_TEXT_RENDERING,
+    RSVG_STYLE_PROP_COUNT
+} RsvgStyleProp;
+
+/* Sorted by name for binary search */
+static const struct {
+    const char *name;
+    RsvgStyleProp prop;
+} rsvg_style_props[] = {
+    {"a:adobe-blending-mode", RSVG_STYLE_PROP_A_ADOBE_BLENDING_MODE},
+    {"clip-path", RSVG_STYLE_PROP_CLIP_PATH},
+    {"clip-rule", RSVG_STYLE_PROP_CLIP_RULE},
+    {"color", RSVG_STYLE_PROP_COLOR},
+    {"comp-op", RSVG_STYLE_PROP_COMP_OP},
+    {"direction", RSVG_STYLE_PROP_DIRECTION},
+    {"display", RSVG_STYLE_PROP_DISPLAY},
+    {"enable-background", RSVG_STYLE_PROP_ENABLE_BACKGROUND},
+    {"fill", RSVG_STYLE_PROP_FILL},
+    {"fill-opacity", RSVG_STYLE_PROP_FILL_OPACITY},
+    {"fill-rule", RSVG_STYLE_PROP_FILL_RULE},
+    {"filter", RSVG_STYLE_PROP_FILTER},
+    {"flood-color", RSVG_STYLE_PROP_FLOOD_COLOR},
+    {"flood-opacity", RSVG_STYLE_PROP_FLOOD_OPACITY},
+    {"font-family", RSVG_STYLE_PROP_FONT_FAMILY},
+    {"font-size", RSVG_STYLE_PROP_FONT_SIZE},
+    {"font-stretch", RSVG_STYLE_PROP_FONT_STRETCH},
+    {"font-style", RSVG_STYLE_PROP_FONT_STYLE},
+    {"font-variant", RSVG_STYLE_PROP_FONT_VARIANT},
+    {"font-weight", RSVG_STYLE_PROP_FONT_WEIGHT},
+    {"letter-spacing", RSVG_STYLE_PROP_LETTER_SPACING},
+    {"marker-end", RSVG_STYLE_PROP_MARKER_END},
+    {"marker-mid", RSVG_STYLE_PROP_MARKER_MID},
+    {"marker-start", RSVG_STYLE_PROP_MARKER_START},
+    {"mask", RSVG_STYLE_PROP_MASK},
+    {"opacity", RSVG_STYLE_PROP_OPACITY},
+    {"overflow", RSVG_STYLE_PROP_OVERFLOW},
+    {"shape-rendering", RSVG_STYLE_PROP_SHAPE_RENDERING},
+    {"stop-color", RSVG_STYLE_PROP_STOP_COLOR},
+    {"stop-opacity", RSVG_STYLE_PROP_STOP_OPACITY},
+    {"stroke", RSVG_STYLE_PROP_STROKE},
+    {"stroke-dasharray", RSVG_STYLE_PROP_STROKE_DASHARRAY},
+    {"stroke-dashoffset", RSVG_STYLE_PROP_STROKE_DASHOFFSET},
+    {"stroke-linecap", RSVG_STYLE_PROP_STROKE_LINECAP},
+    {"stroke-linejoin", RSVG_STYLE_PROP_STROKE_LINEJOIN},
+    {"stroke-miterlimit", RSVG_STYLE_PROP_STROKE_MITERLIMIT},
+    {"stroke-opacity", RSVG_STYLE_PROP_STROKE_OPACITY},
+    {"stroke-width", RSVG_STYLE_PROP_STROKE_WIDTH},
+    {"text-anchor", RSVG_STYLE_PROP_TEXT_ANCHOR},
+    {"text-decoration", RSVG_STYLE_PROP_TEXT_DECORATION},
+    {"text-rendering", RSVG_STYLE_PROP_TEXT_RENDERING},
+    {"unicode-bidi", RSVG_STYLE_PROP_UNICODE_BIDI},
+    {"visibility", RSVG_STYLE_PROP_VISIBILITY},
+    {"writing-mode", RSVG_STYLE_PROP_WRITING_MODE},
+    {"xml:lang", RSVG_STYLE_PROP_XML_LANG},
+    {"xml:space", RSVG_STYLE_PROP_XML_SPACE},
+};
+
+static const char *rsvg_style_prop_names[RSVG_STYLE_PROP_COUNT] = {
+    "a:adobe-blending-mode",
+    "clip-path",
+    "clip-rule",
+    "color",
+    "direction",
+    "display",
+    "enable-background",
+    "comp-op",
+    "fill",
+    "fill-opacity",
+    "fill-rule",
+    "filter",
+    "flood-color",
+    "flood-opacity",
+    "font-family",
+    "font-size",
+    "font-stretch",
+    "font-style",
+    "font-variant",
+    "font-weight",
+    "marker-end",
+    "mask",
+    "marker-mid",
+    "marker-start",
+    "opacity",
+    "overflow",
+    "stop-color",
+    "stop-opacity",
+    "stroke",
+    "stroke-dasharray",
+    "stroke-dashoffset",
+    "stroke-linecap",
+    "stroke-linejoin",
+    "stroke-miterlimit",
+    "stroke-opacity",
+    "stroke-width",
+    "text-anchor",
+    "text-decoration",
+    "unicode-bidi",
+    "letter-spacing",
+    "visibility",
+    "writing-mode",
+    "xml:lang",
+    "xml:space",
+    "shape-rendering",
+    "text-rendering",
+};
+
+static int
+rsvg_style_prop_compare (const char *name, gsize len, const char *prop_name)
+{
+    int cmp = strncmp (name, prop_name, len);
+
+    if (cmp == 0 && prop_name[len] != '\0')
+        return -1;              /* name is a proper prefix of prop_name */
+    return cmp;
+}
+
+static gint
+rsvg_style_prop_lookup (const char *name, gsize len)
+{
+    gint lo = 0, hi = G_N_ELEMENTS (rsvg_style_props);
+
+    while (lo < hi) {
+        gint mid = (lo + hi) / 2;
+        int cmp = rsvg_style_prop_compare (name, len, rsvg_style_props[mid].name);
+
+        if (cmp == 0)
+            return rsvg_style_props[mid].prop;
+        if (cmp < 0)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+
+    return -1;
+}
+
+/* Set one property on the SVG context attributes. */
 static void
-rsvg_parse_style_arg (RsvgHandle * ctx, RsvgState * state, const char *str)
+rsvg_parse_style_prop (RsvgHandle * ctx, RsvgState * state, RsvgStyleProp prop, const char *value)
 {
-    int arg_off;
-
-    arg_off = rsvg_css_param_arg_offset (str);
-
-    if (rsvg_css_param_match (str, "color"))
-        state->current_color = rsvg_css_parse_color (str + arg_off, &state->has_current_color);
-    else if (rsvg_css_param_match (str, "opacity"))
-        state->opacity = rsvg_css_parse_opacity (str + arg_off);
-    else if (rsvg_css_param_match (str, "flood-color"))
-        state->flood_color = rsvg_css_parse_color (str + arg_off, &state->has_flood_color);
-    else if (rsvg_css_param_match (str, "flood-opacity")) {
-        state->flood_opacity = rsvg_css_parse_opacity (str + arg_off);
+    switch (prop) {
+    case RSVG_STYLE_PROP_COLOR:
+        state->current_color = rsvg_css_parse_color (value, &state->has_current_color);
+        break;
+    case RSVG_STYLE_PROP_OPACITY:
+        state->opacity = rsvg_css_parse_opacity (value);
+        break;
+    case RSVG_STYLE_PROP_FLOOD_COLOR:
+        state->flood_color = rsvg_css_parse_color (value, &state->has_flood_color);
+        break;
+    case RSVG_STYLE_PROP_FLOOD_OPACITY:
+        state->flood_opacity = rsvg_css_parse_opacity (value);
         state->has_flood_opacity = TRUE;
-    } else if (rsvg_css_param_match (str, "filter"))
-        state->filter = rsvg_filter_parse (ctx->priv->defs, str + arg_off);
-    else if (rsvg_css_param_match (str, "a:adobe-blending-mode")) {
-        if (!strcmp (str + arg_off, "normal"))
+        break;
+    case RSVG_STYLE_PROP_FILTER:
+        state->filter = rsvg_filter_parse (ctx->priv->defs, value);
+        break;
+    case RSVG_STYLE_PROP_A_ADOBE_BLENDING_MODE:
+        if (!strcmp (value, "normal"))
             state->adobe_blend = 0;
-        else if (!strcmp (str + arg_off, "multiply"))
+        else if (!strcmp (value, "multiply"))
             state->adobe_blend = 1;
-        else if (!strcmp (str + arg_off, "screen"))
+        else if (!strcmp (value, "screen"))
             state->adobe_blend = 2;
-        else if (!strcmp (str + arg_off, "darken"))
+        else if (!strcmp (value, "darken"))
             state->adobe_blend = 3;
-        else if (!strcmp (str + arg_off, "lighten"))
+        else if (!strcmp (value, "lighten"))
             state->adobe_blend = 4;
-        else if (!strcmp (str + arg_off, "softlight"))
+        else if (!strcmp (value, "softlight"))
             state->adobe_blend = 5;
-        else if (!strcmp (str + arg_off, "hardlight"))
+        else if (!strcmp (value, "hardlight"))
             state->adobe_blend = 6;
-        else if (!strcmp (str + arg_off, "colordodge"))
+        else if (!strcmp (value, "colordodge"))
             state->adobe_blend = 7;
-        else if (!strcmp (str + arg_off, "colorburn"))
+        else if (!strcmp (value, "colorburn"))
             state->adobe_blend = 8;
-        else if (!strcmp (str + arg_off, "overlay"))
+        else if (!strcmp (value, "overlay"))
             state->adobe_blend = 9;
-        else if (!strcmp (str + arg_off, "exclusion"))
+        else if (!strcmp (value, "exclusion"))
             state->adobe_blend = 10;
-        else if (!strcmp (str + arg_off, "difference"))
+        else if (!strcmp (value, "difference"))
             state->adobe_blend = 11;
-        else if (!strcmp (str + arg_off, "hue"))
+        else if (!strcmp (value, "hue"))
             state->adobe_blend = 12;
-        else if (!strcmp (str + arg_off, "saturation"))
+        else if (!strcmp (value, "saturation"))
             state->adobe_blend = 13;
-        else if (!strcmp (str + arg_off, "color"))
+        else if (!strcmp (value, "color"))
             state->adobe_blend = 14;
-        else if (!strcmp (str + arg_off, "luminosity"))
+        else if (!strcmp (value, "luminosity"))
             state->adobe_blend = 15;
         else
             state->adobe_blend = 0;
-    } else if (rsvg_css_param_match (str, "mask"))
-        state->mask = rsvg_mask_parse (ctx->priv->defs, str + arg_off);
-    else if (rsvg_css_param_match (str, "clip-path")) {
-        state->clip_path_ref = rsvg_clip_path_parse (ctx->priv->defs, str + arg_off);
-    } else if (rsvg_css_param_match (str, "overflow")) {
-        if (strcmp (str + arg_off, "inherit")) {
-            state->overflow = rsvg_css_parse_overflow (str + arg_off, &state->has_overflow);
+        break;
+    case RSVG_STYLE_PROP_MASK:
+        state->mask = rsvg_mask_parse (ctx->priv->defs, value);
+        break;
+    case RSVG_STYLE_PROP_CLIP_PATH:
+        state->clip_path_ref = rsvg_clip_path_parse (ctx->priv->defs, value);
+        break;
+    case RSVG_STYLE_PROP_OVERFLOW:
+        if (strcmp (value, "inherit")) {
+            state->overflow = rsvg_css_parse_overflow (value, &state->has_overflow);
         }
-    } else if (rsvg_css_param_match (str, "enable-background")) {
-        if (!strcmp (str + arg_off, "new"))
+        break;
+    case RSVG_STYLE_PROP_ENABLE_BACKGROUND:
+        if (!strcmp (value, "new"))
             state->enable_background = RSVG_ENABLE_BACKGROUND_NEW;
         else
             state->enable_background = RSVG_ENABLE_BACKGROUND_ACCUMULATE;
-    } else if (rsvg_css_param_match (str, "comp-op")) {
-        if (!strcmp (str + arg_off, "clear"))
+        break;
+    case RSVG_STYLE_PROP_COMP_OP:
+        if (!strcmp (value, "clear"))
             state->comp_op = RSVG_COMP_OP_CLEAR;
-        else if (!strcmp (str + arg_off, "src"))
+        else if (!strcmp (value, "src"))
             state->comp_op = RSVG_COMP_OP_SRC;
-        else if (!strcmp (str + arg_off, "dst"))
+        else if (!strcmp (value, "dst"))
             state->comp_op = RSVG_COMP_OP_DST;
-        else if (!strcmp (str + arg_off, "src-over"))
+        else if (!strcmp (value, "src-over"))
             state->comp_op = RSVG_COMP_OP_SRC_OVER;
-        else if (!strcmp (str + arg_off, "dst-over"))
+        else if (!strcmp (value, "dst-over"))
             state->comp_op = RSVG_COMP_OP_DST_OVER;
-        else if (!strcmp (str + arg_off, "src-in"))
+        else if (!strcmp (value, "src-in"))
             state->comp_op = RSVG_COMP_OP_SRC_IN;
-        else if (!strcmp (str + arg_off, "dst-in"))
+        else if (!strcmp (value, "dst-in"))
             state->comp_op = RSVG_COMP_OP_DST_IN;
-        else if (!strcmp (str + arg_off, "src-out"))
+        else if (!strcmp (value, "src-out"))
             state->comp_op = RSVG_COMP_OP_SRC_OUT;
-        else if (!strcmp (str + arg_off, "dst-out"))
+        else if (!strcmp (value, "dst-out"))
             state->comp_op = RSVG_COMP_OP_DST_OUT;
-        else if (!strcmp (str + arg_off, "src-atop"))
+        else if (!strcmp (value, "src-atop"))
             state->comp_op = RSVG_COMP_OP_SRC_ATOP;
-        else if (!strcmp (str + arg_off, "dst-atop"))
+        else if (!strcmp (value, "dst-atop"))
             state->comp_op = RSVG_COMP_OP_DST_ATOP;
-        else if (!strcmp (str + arg_off, "xor"))
+        else if (!strcmp (value, "xor"))
             state->comp_op = RSVG_COMP_OP_XOR;
-        else if (!strcmp (str + arg_off, "plus"))
+        else if (!strcmp (value, "plus"))
             state->comp_op = RSVG_COMP_OP_PLUS;
-        else if (!strcmp (str + arg_off, "multiply"))
+        else if (!strcmp (value, "multiply"))
             state->comp_op = RSVG_COMP_OP_MULTIPLY;
-        else if (!strcmp (str + arg_off, "screen"))
+        else if (!strcmp (value, "screen"))
             state->comp_op = RSVG_COMP_OP_SCREEN;
-        else if (!strcmp (str + arg_off, "overlay"))
+        else if (!strcmp (value, "overlay"))
             state->comp_op = RSVG_COMP_OP_OVERLAY;
-        else if (!strcmp (str + arg_off, "darken"))
+        else if (!strcmp (value, "darken"))
             state->comp_op = RSVG_COMP_OP_DARKEN;
-        else if (!strcmp (str + arg_off, "lighten"))
+        else if (!strcmp (value, "lighten"))
             state->comp_op = RSVG_COMP_OP_LIGHTEN;
-        else if (!strcmp (str + arg_off, "color-dodge"))
+        else if (!strcmp (value, "color-dodge"))
             state->comp_op = RSVG_COMP_OP_COLOR_DODGE;
-        else if (!strcmp (str + arg_off, "color-burn"))
+        else if (!strcmp (value, "color-burn"))
             state->comp_op = RSVG_COMP_OP_COLOR_BURN;
-        else if (!strcmp (str + arg_off, "hard-light"))
+        else if (!strcmp (value, "hard-light"))
             state->comp_op = RSVG_COMP_OP_HARD_LIGHT;
-        else if (!strcmp (str + arg_off, "soft-light"))
+        else if (!strcmp (value, "soft-light"))
             state->comp_op = RSVG_COMP_OP_SOFT_LIGHT;
-        else if (!strcmp (str + arg_off, "difference"))
+        else if (!strcmp (value, "difference"))
             state->comp_op = RSVG_COMP_OP_DIFFERENCE;
-        else if (!strcmp (str + arg_off, "exclusion"))
+        else if (!strcmp (value, "exclusion"))
             state->comp_op = RSVG_COMP_OP_EXCLUSION;
         else
             state->comp_op = RSVG_COMP_OP_SRC_OVER;
-    } else if (rsvg_css_param_match (str, "display")) {
+        break;
+    case RSVG_STYLE_PROP_DISPLAY:
         state->has_visible = TRUE;
-        if (!strcmp (str + arg_off, "none"))
+        if (!strcmp (value, "none"))
             state->visible = FALSE;
-        else if (strcmp (str + arg_off, "inherit") != 0)
+        else if (strcmp (value, "inherit") != 0)
             state->visible = TRUE;
         else
             state->has_visible = FALSE;
-	} else if (rsvg_css_param_match (str, "xml:space")) {
+        break;
+    case RSVG_STYLE_PROP_XML_SPACE:
         state->has_space_preserve = TRUE;
-        if (!strcmp (str + arg_off, "default"))
+        if (!strcmp (value, "default"))
             state->space_preserve = FALSE;
-        else if (strcmp (str + arg_off, "preserve") == 0)
+        else if (strcmp (value, "preserve") == 0)
             state->space_preserve = TRUE;
         else
             state->space_preserve = FALSE;
-    } else if (rsvg_css_param_match (str, "visibility")) {
+        break;
+    case RSVG_STYLE_PROP_VISIBILITY:
         state->has_visible = TRUE;
-        if (!strcmp (str + arg_off, "visible"))
+        if (!strcmp (value, "visible"))
             state->visible = TRUE;
-        else if (strcmp (str + arg_off, "inherit") != 0)
+        else if (strcmp (value, "inherit") != 0)
             state->visible = FALSE;     /* collapse or hidden */
         else
             state->has_visible = FALSE;
-    } else if (rsvg_css_param_match (str, "fill")) {
-        RsvgPaintServer *fill = state->fill;
+        break;
+    case RSVG_STYLE_PROP_FILL:
         state->fill =
-            rsvg_paint_server_parse (&state->has_fill_server, ctx->priv->defs, str + arg_off, 0);
-        rsvg_paint_server_unref (fill);
-    } else if (rsvg_css_param_match (str, "fill-opacity")) {
-        state->fill_opacity = rsvg_css_parse_opacity (str + arg_off);
+            rsvg_paint_server_parse (&state->has_fill_server, ctx->priv->defs, value, 0);
+        break;
+    case RSVG_STYLE_PROP_FILL_OPACITY:
+        state->fill_opacity = rsvg_css_parse_opacity (value);
         state->has_fill_opacity = TRUE;
-    } else if (rsvg_css_param_match (str, "fill-rule")) {
+        break;
+    case RSVG_STYLE_PROP_FILL_RULE:
         state->has_fill_rule = TRUE;
-        if (!strcmp (str + arg_off, "nonzero"))
+        if (!strcmp (value, "nonzero"))
             state->fill_rule = FILL_RULE_NONZERO;
-        else if (!strcmp (str + arg_off, "evenodd"))
+        else if (!strcmp (value, "evenodd"))
             state->fill_rule = FILL_RULE_EVENODD;
         else
             state->has_fill_rule = FALSE;
-    } else if (rsvg_css_param_match (str, "clip-rule")) {
+        break;
+    case RSVG_STYLE_PROP_CLIP_RULE:
         state->has_clip_rule = TRUE;
-        if (!strcmp (str + arg_off, "nonzero"))
+        if (!strcmp (value, "nonzero"))
             state->clip_rule = FILL_RULE_NONZERO;
-        else if (!strcmp (str + arg_off, "evenodd"))
+        else if (!strcmp (value, "evenodd"))
             state->clip_rule = FILL_RULE_EVENODD;
         else
             state->has_clip_rule = FALSE;
-    } else if (rsvg_css_param_match (str, "stroke")) {
-        RsvgPaintServer *stroke = state->stroke;
-
+        break;
+    case RSVG_STYLE_PROP_STROKE:
         state->stroke =
-            rsvg_paint_server_parse (&state->has_stroke_server, ctx->priv->defs, str + arg_off, 0);
-
-        rsvg_paint_server_unref (stroke);
-    } else if (rsvg_css_param_match (str, "stroke-width")) {
-        state->stroke_width = _rsvg_css_parse_length (str + arg_off);
+            rsvg_paint_server_parse (&state->has_stroke_server, ctx->priv->defs, value, 0);
+        break;
+    case RSVG_STYLE_PROP_STROKE_WIDTH:
+        state->stroke_width = _rsvg_css_parse_length (value);
         state->has_stroke_width = TRUE;
-    } else if (rsvg_css_param_match (str, "stroke-linecap")) {
+        break;
+    case RSVG_STYLE_PROP_STROKE_LINECAP:
         state->has_cap = TRUE;
-        if (!strcmp (str + arg_off, "butt"))
+        if (!strcmp (value, "butt"))
             state->cap = RSVG_PATH_STROKE_CAP_BUTT;
-        else if (!strcmp (str + arg_off, "round"))
+        else if (!strcmp (value, "round"))
             state->cap = RSVG_PATH_STROKE_CAP_ROUND;
-        else if (!strcmp (str + arg_off, "square"))
+        else if (!strcmp (value, "square"))
             state->cap = RSVG_PATH_STROKE_CAP_SQUARE;
         else
-            g_warning (_("unknown line cap style %s\n"), str + arg_off);
-    } else if (rsvg_css_param_match (str, "stroke-opacity")) {
-        state->stroke_opacity = rsvg_css_parse_opacity (str + arg_off);
+            g_warning (_("unknown line cap style %s\n"), value);
+        break;
+    case RSVG_STYLE_PROP_STROKE_OPACITY:
+        state->stroke_opacity = rsvg_css_parse_opacity (value);
         state->has_stroke_opacity = TRUE;
-    } else if (rsvg_css_param_match (str, "stroke-linejoin")) {
+        break;
+    case RSVG_STYLE_PROP_STROKE_LINEJOIN:
         state->has_join = TRUE;
-        if (!strcmp (str + arg_off, "miter"))
+        if (!strcmp (value, "miter"))
             state->join = RSVG_PATH_STROKE_JOIN_MITER;
-        else if (!strcmp (str + arg_off, "round"))
+        else if (!strcmp (value, "round"))
             state->join = RSVG_PATH_STROKE_JOIN_ROUND;
-        else if (!strcmp (str + arg_off, "bevel"))
+        else if (!strcmp (value, "bevel"))
             state->join = RSVG_PATH_STROKE_JOIN_BEVEL;
         else
-            g_warning (_("unknown line join style %s\n"), str + arg_off);
-    } else if (rsvg_css_param_match (str, "font-size")) {
-        state->font_size = _rsvg_css_parse_length (str + arg_off);
+            g_warning (_("unknown line join style %s\n"), value);
+        break;
+    case RSVG_STYLE_PROP_FONT_SIZE:
+        state->font_size = _rsvg_css_parse_length (value);
         state->has_font_size = TRUE;
-    } else if (rsvg_css_param_match (str, "font-family")) {
-        char *save = g_strdup (rsvg_css_parse_font_family (str + arg_off, &state->has_font_family));
-        g_free (state->font_family);
-        state->font_family = save;
-    } else if (rsvg_css_param_match (str, "xml:lang")) {
-        char *save = g_strdup (str + arg_off);
-        g_free (state->lang);
-        state->lang = save;
+        break;
+    case RSVG_STYLE_PROP_FONT_FAMILY:
+        state->font_family =
+            rsvg_defs_intern_string (ctx->priv->defs,
+                                     rsvg_css_parse_font_family (value, &state->has_font_family));
+        break;
+    case RSVG_STYLE_PROP_XML_LANG:
+        state->lang = rsvg_defs_intern_string (ctx->priv->defs, value);
         state->has_lang = TRUE;
-    } else if (rsvg_css_param_match (str, "font-style")) {
-        state->font_style = rsvg_css_parse_font_style (str + arg_off, &state->has_font_style);
-    } else if (rsvg_css_param_match (str, "font-variant")) {
-        state->font_variant = rsvg_css_parse_font_variant (str + arg_off, &state->has_font_variant);
-    } else if (rsvg_css_param_match (str, "font-weight")) {
-        state->font_weight = rsvg_css_parse_font_weight (str + arg_off, &state->has_font_weight);
-    } else if (rsvg_css_param_match (str, "font-stretch")) {
-        state->font_stretch = rsvg_css_parse_font_stretch (str + arg_off, &state->has_font_stretch);
-    } else if (rsvg_css_param_match (str, "text-decoration")) {
-        if (!strcmp (str + arg_off, "inherit")) {
+        break;
+    case RSVG_STYLE_PROP_FONT_STYLE:
+        state->font_style = rsvg_css_parse_font_style (value, &state->has_font_style);
+        break;
+    case RSVG_STYLE_PROP_FONT_VARIANT:
+        state->font_variant = rsvg_css_parse_font_variant (value, &state->has_font_variant);
+        break;
+    case RSVG_STYLE_PROP_FONT_WEIGHT:
+        state->font_weight = rsvg_css_parse_font_weight (value, &state->has_font_weight);
+        break;
+    case RSVG_STYLE_PROP_FONT_STRETCH:
+        state->font_stretch = rsvg_css_parse_font_stretch (value, &state->has_font_stretch);
+        break;
+    case RSVG_STYLE_PROP_TEXT_DECORATION:
+        if (!strcmp (value, "inherit")) {
             state->has_font_decor = FALSE;
             state->font_decor = TEXT_NORMAL;
         } else {
-            if (strstr (str + arg_off, "underline"))
+            if (strstr (value, "underline"))
                 state->font_decor |= TEXT_UNDERLINE;
-            if (strstr (str + arg_off, "overline"))
+            if (strstr (value, "overline"))
                 state->font_decor |= TEXT_OVERLINE;
-            if (strstr (str + arg_off, "strike") || strstr (str + arg_off, "line-through"))     /* strike though or line-through */
+            if (strstr (value, "strike") || strstr (value, "line-through"))     /* strike though or line-through */
                 state->font_decor |= TEXT_STRIKE;
             state->has_font_decor = TRUE;
         }
-    } else if (rsvg_css_param_match (str, "direction")) {
+        break;
+    case RSVG_STYLE_PROP_DIRECTION:
         state->has_text_dir = TRUE;
-        if (!strcmp (str + arg_off, "inherit")) {
+        if (!strcmp (value, "inherit")) {
             state->text_dir = PANGO_DIRECTION_LTR;
             state->has_text_dir = FALSE;
-        } else if (!strcmp (str + arg_off, "rtl"))
+        } else if (!strcmp (value, "rtl"))
             state->text_dir = PANGO_DIRECTION_RTL;
         else                    /* ltr */
             state->text_dir = PANGO_DIRECTION_LTR;
-    } else if (rsvg_css_param_match (str, "unicode-bidi")) {
+        break;
+    case RSVG_STYLE_PROP_UNICODE_BIDI:
         state->has_unicode_bidi = TRUE;
-        if (!strcmp (str + arg_off, "inherit")) {
+        if (!strcmp (value, "inherit")) {
             state->unicode_bidi = PANGO_DIRECTION_LTR;
             state->has_unicode_bidi = FALSE;
-        } else if (!strcmp (str + arg_off, "embed"))
+        } else if (!strcmp (value, "embed"))
             state->unicode_bidi = UNICODE_BIDI_EMBED;
-        else if (!strcmp (str + arg_off, "bidi-override"))
+        else if (!strcmp (value, "bidi-override"))
             state->unicode_bidi = UNICODE_BIDI_OVERRIDE;
         else                    /* normal */
             state->unicode_bidi = UNICODE_BIDI_NORMAL;
-    } else if (rsvg_css_param_match (str, "writing-mode")) {
+        break;
+    case RSVG_STYLE_PROP_WRITING_MODE:
         /* TODO: these aren't quite right... */
 
         state->has_text_dir = TRUE;
-        if (!strcmp (str + arg_off, "inherit")) {
+        if (!strcmp (value, "inherit")) {
             state->text_dir = PANGO_DIRECTION_LTR;
             state->has_text_dir = FALSE;
-        } else if (!strcmp (str + arg_off, "lr-tb") || !strcmp (str + arg_off, "tb"))
+        } else if (!strcmp (value, "lr-tb") || !strcmp (value, "tb"))
             state->text_dir = PANGO_DIRECTION_TTB_LTR;
-        else if (!strcmp (str + arg_off, "rl"))
+        else if (!strcmp (value, "rl"))
             state->text_dir = PANGO_DIRECTION_RTL;
-        else if (!strcmp (str + arg_off, "tb-rl") || !strcmp (str + arg_off, "rl-tb"))
+        else if (!strcmp (value, "tb-rl") || !strcmp (value, "rl-tb"))
             state->text_dir = PANGO_DIRECTION_TTB_RTL;
         else
             state->text_dir = PANGO_DIRECTION_LTR;
-    } else if (rsvg_css_param_match (str, "text-anchor")) {
+        break;
+    case RSVG_STYLE_PROP_TEXT_ANCHOR:
         state->has_text_anchor = TRUE;
-        if (!strcmp (str + arg_off, "inherit")) {
+        if (!strcmp (value, "inherit")) {
             state->text_anchor = TEXT_ANCHOR_START;
             state->has_text_anchor = FALSE;
         } else {
-            if (strstr (str + arg_off, "start"))
+            if (strstr (value, "start"))
                 state->text_anchor = TEXT_ANCHOR_START;
-            else if (strstr (str + arg_off, "middle"))
+            else if (strstr (value, "middle"))
                 state->text_anchor = TEXT_ANCHOR_MIDDLE;
-            else if (strstr (str + arg_off, "end"))
+            else if (strstr (value, "end"))
                 state->text_anchor = TEXT_ANCHOR_END;
         }
-    } else if (rsvg_css_param_match (str, "letter-spacing")) {
+        break;
+    case RSVG_STYLE_PROP_LETTER_SPACING:
 	state->has_letter_spacing = TRUE;
-	state->letter_spacing = _rsvg_css_parse_length (str + arg_off);
-    } else if (rsvg_css_param_match (str, "stop-color")) {
-        if (strcmp (str + arg_off, "inherit")) {
-            state->stop_color = rsvg_css_parse_color (str + arg_off, &state->has_stop_color);
+	state->letter_spacing = _rsvg_css_parse_length (value);
+        break;
+    case RSVG_STYLE_PROP_STOP_COLOR:
+        if (strcmp (value, "inherit")) {
+            state->stop_color = rsvg_css_parse_color (value, &state->has_stop_color);
         }
-    } else if (rsvg_css_param_match (str, "stop-opacity")) {
-        if (strcmp (str + arg_off, "inherit")) {
+        break;
+    case RSVG_STYLE_PROP_STOP_OPACITY:
+        if (strcmp (value, "inherit")) {
             state->has_stop_opacity = TRUE;
-            state->stop_opacity = rsvg_css_parse_opacity (str + arg_off);
+            state->stop_opacity = rsvg_css_parse_opacity (value);
         }
-    } else if (rsvg_css_param_match (str, "marker-start")) {
-        state->startMarker = rsvg_marker_parse (ctx->priv->defs, str + arg_off);
+        break;
+    case RSVG_STYLE_PROP_MARKER_START:
+        state->startMarker = rsvg_marker_parse (ctx->priv->defs, value);
         state->has_startMarker = TRUE;
-    } else if (rsvg_css_param_match (str, "marker-mid")) {
-        state->middleMarker = rsvg_marker_parse (ctx->priv->defs, str + arg_off);
+        break;
+    case RSVG_STYLE_PROP_MARKER_MID:
+        state->middleMarker = rsvg_marker_parse (ctx->priv->defs, value);
         state->has_middleMarker = TRUE;
-    } else if (rsvg_css_param_match (str, "marker-end")) {
-        state->endMarker = rsvg_marker_parse (ctx->priv->defs, str + arg_off);
+        break;
+    case RSVG_STYLE_PROP_MARKER_END:
+        state->endMarker = rsvg_marker_parse (ctx->priv->defs, value);
         state->has_endMarker = TRUE;
-    } else if (rsvg_css_param_match (str, "stroke-miterlimit")) {
+        break;
+    case RSVG_STYLE_PROP_STROKE_MITERLIMIT:
         state->has_miter_limit = TRUE;
-        state->miter_limit = g_ascii_strtod (str + arg_off, NULL);
-    } else if (rsvg_css_param_match (str, "stroke-dashoffset")) {
+        state->miter_limit = g_ascii_strtod (value, NULL);
+        break;
+    case RSVG_STYLE_PROP_STROKE_DASHOFFSET:
         state->has_dashoffset = TRUE;
-        state->dash.offset = _rsvg_css_parse_length (str + arg_off);
+        state->dash.offset = _rsvg_css_parse_length (value);
         if (state->dash.offset.length < 0.)
             state->dash.offset.length = 0.;
-	} else if (rsvg_css_param_match (str, "shape-rendering")) {
+        break;
+    case RSVG_STYLE_PROP_SHAPE_RENDERING:
 		state->has_shape_rendering_type = TRUE;
 
-        if (!strcmp (str + arg_off, "auto") || !strcmp (str + arg_off, "default"))
+        if (!strcmp (value, "auto") || !strcmp (value, "default"))
 			state->shape_rendering_type = SHAPE_RENDERING_AUTO;
-        else if (!strcmp (str + arg_off, "optimizeSpeed"))
+        else if (!strcmp (value, "optimizeSpeed"))
 			state->shape_rendering_type = SHAPE_RENDERING_OPTIMIZE_SPEED;
-        else if (!strcmp (str + arg_off, "crispEdges"))
+        else if (!strcmp (value, "crispEdges"))
 			state->shape_rendering_type = SHAPE_RENDERING_CRISP_EDGES;
-        else if (!strcmp (str + arg_off, "geometricPrecision"))
+        else if (!strcmp (value, "geometricPrecision"))
 			state->shape_rendering_type = SHAPE_RENDERING_GEOMETRIC_PRECISION;
-
-	} else if (rsvg_css_param_match (str, "text-rendering")) {
+        break;
+    case RSVG_STYLE_PROP_TEXT_RENDERING:
 		state->has_text_rendering_type = TRUE;
 
-        if (!strcmp (str + arg_off, "auto") || !strcmp (str + arg_off, "default"))
+        if (!strcmp (value, "auto") || !strcmp (value, "default"))
 			state->text_rendering_type = TEXT_RENDERING_AUTO;
-        else if (!strcmp (str + arg_off, "optimizeSpeed"))
+        else if (!strcmp (value, "optimizeSpeed"))
 			state->text_rendering_type = TEXT_RENDERING_OPTIMIZE_SPEED;
-        else if (!strcmp (str + arg_off, "optimizeLegibility"))
+        else if (!strcmp (value, "optimizeLegibility"))
 			state->text_rendering_type = TEXT_RENDERING_OPTIMIZE_LEGIBILITY;
-        else if (!strcmp (str + arg_off, "geometricPrecision"))
+        else if (!strcmp (value, "geometricPrecision"))
 			state->text_rendering_type = TEXT_RENDERING_GEOMETRIC_PRECISION;
-
-    } else if (rsvg_css_param_match (str, "stroke-dasharray")) {
+        break;
+    case RSVG_STYLE_PROP_STROKE_DASHARRAY:
         state->has_dash = TRUE;
-        if (!strcmp (str + arg_off, "none")) {
+        if (!strcmp (value, "none")) {
             if (state->dash.n_dash != 0) {
                 /* free any cloned dash data */
                 g_free (state->dash.dash);
                 state->dash.n_dash = 0;
             }
         } else {
-            gchar **dashes = g_strsplit (str + arg_off, ",", -1);
+            gchar **dashes = g_strsplit (value, ",", -1);
             if (NULL != dashes) {
                 gint n_dashes, i;
                 gboolean is_even = FALSE;
@@ -748,75 +989,82 @@ rsvg_parse_style_arg (RsvgHandle * ctx, RsvgState * state, const char *str)
                 }
             }
         }
+        break;
+    default:
+        break;
     }
 }
 
+/* Parse a CSS2 style argument, setting the SVG context attributes. */
+static void
+rsvg_parse_style_arg (RsvgHandle * ctx, RsvgState * state, const char *str)
+{
+    const char *colon;
+
+    /* the property name runs up to a colon, and may contain one itself */
+    for (colon = strchr (str, ':'); colon != NULL; colon = strchr (colon + 1, ':')) {
+        gint prop = rsvg_style_prop_lookup (str, colon - str);
+
+        if (prop >= 0) {
+            rsvg_parse_style_prop (ctx, state, prop, str + rsvg_css_param_arg_offset (str));
+            return;
+        }
+    }
+}
+
+static void
+rsvg_parse_style_pair_prop (RsvgHandle * ctx, RsvgState * state,
+                            RsvgStyleProp prop, const char *val)
+{
+    const char *key = rsvg_style_prop_names[prop];
+    gsize key_len = strlen (key), val_len = strlen (val);
+    gchar buf[256];
+    gchar *str;
+
+    /* The value is found with the same rules as in a style attribute */
+    str = key_len + val_len + 2 <= sizeof (buf) ? buf : g_new (gchar, key_len + val_len + 2);
+    memcpy (str, key, key_len);
+    str[key_len] = ':';
+    memcpy (str + key_len + 1, val, val_len + 1);
+
+    rsvg_parse_style_prop (ctx, state, prop, str + rsvg_css_param_arg_offset (str));
+
+    if (str != buf)
+        g_free (str);
+}
+
 void
 rsvg_parse_style_pair (RsvgHandle * ctx, RsvgState * state, const char *key, const char *val)
 {
-    gchar *str = g_strdup_printf ("%s:%s", key, val);
-    rsvg_parse_style_arg (ctx, state, str);
-    g_free (str);
+    gint prop = rsvg_style_prop_lookup (key, strlen (key));
+
+    if (prop >= 0)
+        rsvg_parse_style_pair_prop (ctx, state, prop, val);
 }
 
 static void
-rsvg_lookup_parse_style_pair (RsvgHandle * ctx, RsvgState * state,
-                              const char *key, RsvgPropertyBag * atts)
+rsvg_collect_style_pair (const char *key, const char *value, gpointer user_data)
 {
-    const char *value;
+    const char **values = user_data;
+    gint prop = rsvg_style_prop_lookup (key, strlen (key));
 
-    if ((value = rsvg_property_bag_lookup (atts, key)) != NULL)
-        rsvg_parse_style_pair (ctx, state, key, value);
+    if (prop >= 0 && prop < RSVG_STYLE_PROP_SHAPE_RENDERING)
+        values[prop] = value;
 }
 
 /* take a pair of the form (fill="#ff00ff") and parse it as a style */
 void
 rsvg_parse_style_pairs (RsvgHandle * ctx, RsvgState * state, RsvgPropertyBag * atts)
 {
-    rsvg_lookup_parse_style_pair (ctx, state, "a:adobe-blending-mode", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "clip-path", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "clip-rule", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "color", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "direction", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "display", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "enable-background", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "comp-op", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "fill", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "fill-opacity", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "fill-rule", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "filter", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "flood-color", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "flood-opacity", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "font-family", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "font-size", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "font-stretch", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "font-style", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "font-variant", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "font-weight", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "marker-end", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "mask", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "marker-mid", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "marker-start", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "opacity", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "overflow", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "stop-color", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "stop-opacity", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "stroke", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "stroke-dasharray", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "stroke-dashoffset", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "stroke-linecap", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "stroke-linejoin", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "stroke-miterlimit", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "stroke-opacity", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "stroke-width", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "text-anchor", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "text-decoration", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "unicode-bidi", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "letter-spacing", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "visibility", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "writing-mode", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "xml:lang", atts);
-    rsvg_lookup_parse_style_pair (ctx, state, "xml:space", atts);
+    const char *values[RSVG_STYLE_PROP_COUNT];
+    gint prop;
+
+    memset (values, 0, sizeof (values));
+    rsvg_property_bag_enumerate (atts, rsvg_collect_style_pair, values);
+
+    for (prop = 0; prop < RSVG_STYLE_PROP_COUNT; prop++)
+        if (values[prop] != NULL)
+            rsvg_parse_style_pair_prop (ctx, state, prop, values[prop]);
 
     {
         /* TODO: this conditional behavior isn't quite correct, and i'm not sure it should reside here */
@@ -840,23 +1088,29 @@ rsvg_parse_style_pairs (RsvgHandle * ctx, RsvgState * state, RsvgPropertyBag * a
 void
 rsvg_parse_style (RsvgHandle * ctx, RsvgState * state, const char *str)
 {
-    int start, end;
-    char *arg;
-
-    start = 0;
-    while (str[start] != '\0') {
-        for (end = start; str[end] != '\0' && str[end] != ';'; end++);
-        arg = g_new (char, 1 + end - start);
-        memcpy (arg, str + start, end - start);
-        arg[end - start] = '\0';
+    gchar buf[256];
+    gchar *copy, *arg, *end;
+    gsize len = strlen (str);
+
+    /* Terminate the arguments in place in one copy of the string */
+    copy = len < sizeof (buf) ? buf : g_new (gchar, len + 1);
+    memcpy (copy, str, len + 1);
+
+    arg = copy;
+    while (*arg != '\0') {
+        for (end = arg; *end != '\0' && *end != ';'; end++);
+        if (*end == ';') {
+            *end = '\0';
+            end++;
+        }
         rsvg_parse_style_arg (ctx, state, arg);
-        g_free (arg);
-        start = end;
-        if (str[start] == ';')
-            start++;
-        while (str[start] == ' ')
-            start++;
+        arg = end;
+        while (*arg == ' ')
+            arg++;
     }
+
+    if (copy != buf)
+        g_free (copy);
 }
 
 static void
@@ -1168,7 +1422,7 @@ rsvg_parse_transform (double dst[6], const char *src)
             if (g_ascii_isdigit (c) || c == '+' || c == '-' || c == '.') {
                 if (n_args == sizeof (args) / sizeof (args[0]))
                     return FALSE;       /* too many args */
-                args[n_args] = g_ascii_strtod (src + idx, &end_ptr);
+                args[n_args] = _rsvg_css_strtod (src + idx, &end_ptr);
                 idx = end_ptr - src;
 
                 while (g_ascii_isspace (src[idx]))
@@ -1370,13 +1624,17 @@ rsvg_parse_style_attrs (RsvgHandle * ctx,
 RsvgState *
 rsvg_state_current (RsvgDrawingCtx * ctx)
 {
-    return g_slist_nth_data (ctx->state, 0);
+    if (ctx->n_states < 1)
+        return NULL;
+    return g_ptr_array_index (ctx->state, ctx->n_states - 1);
 }
 
 RsvgState *
 rsvg_state_parent (RsvgDrawingCtx * ctx)
 {
-    return g_slist_nth_data (ctx->state, 1);
+    if (ctx->n_states < 2)
+        return NULL;
+    return g_ptr_array_index (ctx->state, ctx->n_states - 2);
 }
 
 RsvgPropertyBag *
@@ -1422,36 +1680,132 @@ rsvg_property_bag_enumerate (RsvgPropertyBag * bag, RsvgPropertyBagEnumFunc func
     g_hash_table_foreach (bag->props, (GHFunc) func, user_data);
 }
 
+/* The state a push produces: everything inheritable taken from the parent,
+ * nothing marked as explicitly set, and the non-inherited properties at
+ * their initial values.  This is what rsvg_state_init followed by
+ * rsvg_state_reinherit gives, without building the defaults only to
+ * replace them. */
+static void
+rsvg_state_init_from_parent (RsvgState * state, const RsvgState * parent)
+{
+    gint i;
+
+    *state = *parent;
+
+    if (parent->dash.n_dash > 0) {
+        state->dash.dash = g_new (gdouble, parent->dash.n_dash);
+        for (i = 0; i < parent->dash.n_dash; i++)
+            state->dash.dash[i] = parent->dash.dash[i];
+    } else {
+        state->dash.n_dash = 0;
+        state->dash.dash = NULL;
+    }
+
+    _rsvg_affine_identity (state->personal_affine);
+    state->filter = NULL;
+    state->mask = NULL;
+    state->clip_path_ref = NULL;
+    state->adobe_blend = 0;
+    state->opacity = 0xff;
+    state->comp_op = RSVG_COMP_OP_SRC_OVER;
+    state->enable_background = RSVG_ENABLE_BACKGROUND_ACCUMULATE;
+    state->text_offset = 0;
+
+    state->has_current_color = FALSE;
+    state->has_flood_color = FALSE;
+    state->has_flood_opacity = FALSE;
+    state->has_fill_server = FALSE;
+    state->has_fill_opacity = FALSE;
+    state->has_fill_rule = FALSE;
+    state->has_clip_rule = FALSE;
+    state->has_stroke_server = FALSE;
+    state->has_stroke_opacity = FALSE;
+    state->has_stroke_width = FALSE;
+    state->has_miter_limit = FALSE;
+    state->has_cap = FALSE;
+    state->has_join = FALSE;
+    state->has_dash = FALSE;
+    state->has_dashoffset = FALSE;
+    state->has_visible = FALSE;
+    state->has_cond = FALSE;
+    state->has_stop_color = FALSE;
+    state->has_stop_opacity = FALSE;
+    state->has_font_size = FALSE;
+    state->has_font_family = FALSE;
+    state->has_lang = FALSE;
+    state->has_font_style = FALSE;
+    state->has_font_variant = FALSE;
+    state->has_font_weight = FALSE;
+    state->has_font_stretch = FALSE;
+    state->has_font_decor = FALSE;
+    state->has_text_dir = FALSE;
+    state->has_unicode_bidi = FALSE;
+    state->has_text_anchor = FALSE;
+    state->has_letter_spacing = FALSE;
+    state->has_startMarker = FALSE;
+    state->has_middleMarker = FALSE;
+    state->has_endMarker = FALSE;
+    state->has_overflow = FALSE;
+    state->has_space_preserve = FALSE;
+    state->has_shape_rendering_type = FALSE;
+    state->has_text_rendering_type = FALSE;
+}
+
+/* States popped off the stack keep their memory in ctx->state and are
+ * reused by the next push, so drawing allocates only as many states as
+ * the tree is deep. */
 void
 rsvg_state_push (RsvgDrawingCtx * ctx)
 {
     RsvgState *data;
     RsvgState *baseon;
 
-    baseon = (RsvgState *) g_slist_nth_data (ctx->state, 0);
-    data = g_slice_new (RsvgState);
+    baseon = rsvg_state_current (ctx);
 
-    if (baseon) {
-        int i;
-        rsvg_state_init (data);
-        rsvg_state_reinherit (data, baseon);
-        for (i = 0; i < 6; i++)
-            data->affine[i] = baseon->affine[i];
-    } else
-        rsvg_state_init (data);
+    if (ctx->state == NULL)
+        ctx->state = g_ptr_array_new ();
 
-    ctx->state = g_slist_prepend (ctx->state, data);
+    if (ctx->n_states < ctx->state->len)
+        data = g_ptr_array_index (ctx->state, ctx->n_states);
+    else {
+        data = g_slice_new (RsvgState);
+        g_ptr_array_add (ctx->state, data);
+    }
+    ctx->n_states++;
+
+    if (baseon)
+        rsvg_state_init_from_parent (data, baseon);
+    else
+        rsvg_state_init (data);
 }
 
 void
 rsvg_state_pop (RsvgDrawingCtx * ctx)
 {
-    GSList *link = g_slist_nth (ctx->state, 0);
-    RsvgState *dead_state = (RsvgState *) link->data;
+    g_return_if_fail (ctx->n_states > 0);
+
+    ctx->n_states--;
+    rsvg_state_finalize (g_ptr_array_index (ctx->state, ctx->n_states));
+}
+
+/* Free the state stack of a drawing context, popped states included */
+void
+rsvg_state_stack_free (RsvgDrawingCtx * ctx)
+{
+    guint i;
 
-    rsvg_state_finalize (dead_state);
-    ctx->state = g_slist_delete_link (ctx->state, link);
-    g_slice_free (RsvgState, dead_state);
+    if (ctx->state == NULL)
+        return;
+
+    for (i = 0; i < ctx->state->len; i++) {
+        RsvgState *state = g_ptr_array_index (ctx->state, i);
+        if (i < ctx->n_states)
+            rsvg_state_finalize (state);
+        g_slice_free (RsvgState, state);
+    }
+    g_ptr_array_free (ctx->state, TRUE);
+    ctx->state = NULL;
+    ctx->n_states = 0;
 }
 
 /*
@@ -168,9 +168,9 @@ struct _RsvgState {
 
     RsvgLength font_size;
     gboolean has_font_size;
-    char *font_family;
+    const char *font_family;    /* interned in the RsvgDefs */
     gboolean has_font_family;
-    char *lang;
+    const char *lang;           /* interned in the RsvgDefs */
     gboolean has_lang;
     PangoStyle font_style;
     gboolean has_font_style;
@@ -246,6 +246,7 @@ void rsvg_state_reinherit   (RsvgState * dst, const RsvgState * src);
 void rsvg_state_dominate    (RsvgState * dst, const RsvgState * src);
 void rsvg_state_override    (RsvgState * dst, const RsvgState * src);
 void rsvg_state_finalize    (RsvgState * state);
+gboolean rsvg_state_equal_except_affine (const RsvgState * a, const RsvgState * b);
 
 void rsvg_parse_style_pairs (RsvgHandle * ctx, RsvgState * state, RsvgPropertyBag * atts);
 void rsvg_parse_style_pair  (RsvgHandle * ctx, RsvgState * state, const char *key, const char *val);
@@ -265,6 +266,7 @@ RsvgState *rsvg_state_current	(RsvgDrawingCtx * ctx);
 
 void rsvg_state_pop	(RsvgDrawingCtx * ctx);
 void rsvg_state_push	(RsvgDrawingCtx * ctx);
+void rsvg_state_stack_free	(RsvgDrawingCtx * ctx);
 
 void rsvg_state_reinherit_top	(RsvgDrawingCtx * ctx, RsvgState * state, int dominate);
 
@@ -159,8 +159,9 @@ _rsvg_node_text_set_atts (RsvgNode * self, RsvgHandle * ctx, RsvgPropertyBag * a
     }
 }
 
-void
- rsvg_text_render_text (RsvgDrawingCtx * ctx, const char *text, gdouble * x, gdouble * y);
+static void
+ rsvg_text_render_text (RsvgDrawingCtx * ctx, RsvgNodeChars * chars,
+                        const char *text, gdouble * x, gdouble * y);
 
 
 static void
@@ -180,17 +181,17 @@ _rsvg_node_text_type_children (RsvgNode * self, RsvgDrawingCtx * ctx,
     rsvg_push_discrete_layer (ctx);
     for (i = 0; i < self->children->len; i++) {
         RsvgNode *node = g_ptr_array_index (self->children, i);
-        if (!strcmp (node->type->str, "RSVG_NODE_CHARS")) {
+        if (node->type == RSVG_NODE_TYPE_CHARS) {
             RsvgNodeChars *chars = (RsvgNodeChars *) node;
             GString *str = _rsvg_text_chomp (rsvg_state_current (ctx), chars->contents, lastwasspace);
-            rsvg_text_render_text (ctx, str->str, x, y);
+            rsvg_text_render_text (ctx, chars, str->str, x, y);
             g_string_free (str, TRUE);
-        } else if (!strcmp (node->type->str, "tspan")) {
+        } else if (node->type == RSVG_NODE_TYPE_TSPAN) {
             RsvgNodeText *tspan = (RsvgNodeText *) node;
             rsvg_state_push (ctx);
             _rsvg_node_text_type_tspan (tspan, ctx, x, y, lastwasspace);
             rsvg_state_pop (ctx);
-        } else if (!strcmp (node->type->str, "tref")) {
+        } else if (node->type == RSVG_NODE_TYPE_TREF) {
             RsvgNodeTref *tref = (RsvgNodeTref *) node;
             _rsvg_node_text_type_tref (tref, ctx, x, y, lastwasspace);
         }
@@ -206,7 +207,8 @@ static int
  _rsvg_node_text_length_tspan (RsvgNodeText * self, RsvgDrawingCtx * ctx,
                                gdouble * x, gboolean * lastwasspace);
 
-static gdouble rsvg_text_length_text_as_string (RsvgDrawingCtx * ctx, const char *text);
+static gdouble rsvg_text_length_text_as_string (RsvgDrawingCtx * ctx, RsvgNodeChars * chars,
+                                                 const char *text);
 
 static int
 _rsvg_node_text_length_children (RsvgNode * self, RsvgDrawingCtx * ctx,
@@ -216,15 +218,15 @@ _rsvg_node_text_length_children (RsvgNode * self, RsvgDrawingCtx * ctx,
     int out = FALSE;
     for (i = 0; i < self->children->len; i++) {
         RsvgNode *node = g_ptr_array_index (self->children, i);
-        if (!strcmp (node->type->str, "RSVG_NODE_CHARS")) {
+        if (node->type == RSVG_NODE_TYPE_CHARS) {
             RsvgNodeChars *chars = (RsvgNodeChars *) node;
             GString *str = _rsvg_text_chomp (rsvg_state_current (ctx), chars->contents, lastwasspace);
-            *x += rsvg_text_length_text_as_string (ctx, str->str);
+            *x += rsvg_text_length_text_as_string (ctx, chars, str->str);
             g_string_free (str, TRUE);
-        } else if (!strcmp (node->type->str, "tspan")) {
+        } else if (node->type == RSVG_NODE_TYPE_TSPAN) {
             RsvgNodeText *tspan = (RsvgNodeText *) node;
             out = _rsvg_node_text_length_tspan (tspan, ctx, x, lastwasspace);
-        } else if (!strcmp (node->type->str, "tref")) {
+        } else if (node->type == RSVG_NODE_TYPE_TREF) {
             RsvgNodeTref *tref = (RsvgNodeTref *) node;
             out = _rsvg_node_text_length_tref (tref, ctx, x, lastwasspace);
         }
@@ -262,11 +264,11 @@ _rsvg_node_text_draw (RsvgNode * self, RsvgDrawingCtx * ctx, int dominate)
 }
 
 RsvgNode *
-rsvg_new_text (void)
+rsvg_new_text (RsvgArena * arena)
 {
     RsvgNodeText *text;
-    text = g_new (RsvgNodeText, 1);
-    _rsvg_node_init (&text->super);
+    text = _rsvg_node_new (RsvgNodeText, arena);
+    _rsvg_node_init (&text->super, arena);
     text->super.draw = _rsvg_node_text_draw;
     text->super.set_atts = _rsvg_node_text_set_atts;
     text->x = text->y = text->dx = text->dy = _rsvg_css_parse_length ("0");
@@ -334,11 +336,11 @@ _rsvg_node_tspan_set_atts (RsvgNode * self, RsvgHandle * ctx, RsvgPropertyBag *
 }
 
 RsvgNode *
-rsvg_new_tspan (void)
+rsvg_new_tspan (RsvgArena * arena)
 {
     RsvgNodeText *text;
-    text = g_new (RsvgNodeText, 1);
-    _rsvg_node_init (&text->super);
+    text = _rsvg_node_new (RsvgNodeText, arena);
+    _rsvg_node_init (&text->super, arena);
     text->super.set_atts = _rsvg_node_tspan_set_atts;
     text->x.factor = text->y.factor = 'n';
     text->dx = text->dy = _rsvg_css_parse_length ("0");
@@ -377,11 +379,11 @@ _rsvg_node_tref_set_atts (RsvgNode * self, RsvgHandle * ctx, RsvgPropertyBag * a
 }
 
 RsvgNode *
-rsvg_new_tref (void)
+rsvg_new_tref (RsvgArena * arena)
 {
     RsvgNodeTref *text;
-    text = g_new (RsvgNodeTref, 1);
-    _rsvg_node_init (&text->super);
+    text = _rsvg_node_new (RsvgNodeTref, arena);
+    _rsvg_node_init (&text->super, arena);
     text->super.set_atts = _rsvg_node_tref_set_atts;
     text->link = NULL;
     return &text->super;
@@ -400,10 +402,8 @@ struct _RsvgTextLayout {
 typedef struct _RenderCtx RenderCtx;
 
 struct _RenderCtx {
-    GString *path;
+    RsvgBpathDef *path;
     gboolean wrote;
-    gdouble offset_x;
-    gdouble offset_y;
 };
 
 #ifdef CAIRO_HAS_FT_FONT
@@ -426,7 +426,7 @@ rsvg_render_ctx_new (void)
     RenderCtx *ctx;
 
     ctx = g_new0 (RenderCtx, 1);
-    ctx->path = g_string_new (NULL);
+    ctx->path = rsvg_bpath_def_new ();
 
     return ctx;
 }
@@ -434,53 +434,82 @@ rsvg_render_ctx_new (void)
 static void
 rsvg_render_ctx_free (RenderCtx * ctx)
 {
-    g_string_free (ctx->path, TRUE);
+    if (ctx->path)
+        rsvg_bpath_def_free (ctx->path);
     g_free (ctx);
 }
 
+/* Pango only became thread-safe in 1.32, and before that the shared font
+ * maps below, their fonts and the fontconfig and FreeType state behind them
+ * may only be touched from one thread at a time.  Every call into pango is
+ * made with this lock held, but nothing else is: painting the fill and
+ * stroke of a layout happens outside it.  It is recursive because the
+ * helpers that free pango objects take it themselves and are also called
+ * from code that already holds it. */
+static GStaticRecMutex rsvg_text_pango_mutex = G_STATIC_REC_MUTEX_INIT;
+
+void
+_rsvg_text_pango_lock (void)
+{
+    g_static_rec_mutex_lock (&rsvg_text_pango_mutex);
+}
+
+void
+_rsvg_text_pango_unlock (void)
+{
+    g_static_rec_mutex_unlock (&rsvg_text_pango_mutex);
+}
+
+/* Font maps are expensive to set up (fontconfig has to be queried and its
+ * caches filled), so one is kept per resolution for the life of the process
+ * and shared by every handle.  Contexts are pooled with them: a render
+ * takes one for its text and hands it back when it is freed, so a context
+ * is never used by two renders at once but is reused by every later handle
+ * at that resolution.  The list is only used with the pango lock held. */
+typedef struct {
+    gdouble dpi_x, dpi_y;
+    PangoFontMap *fontmap;
+    GSList *idle_contexts;
+    /* what the cairo renderer draws pango layouts with, made on first use */
+    PangoFontMap *cairo_fontmap;
+    GSList *idle_cairo_contexts;
+} RsvgTextFontMap;
+
+static GSList *rsvg_text_font_maps = NULL;
+
 #ifdef CAIRO_HAS_FT_FONT
 static void
 rsvg_text_ft2_subst_func (FcPattern * pattern, gpointer data)
 {
-    RsvgHandle *ctx = (RsvgHandle *) data;
-
-    (void) ctx;
-
     FcPatternAddBool (pattern, FC_HINTING, 0);
     FcPatternAddBool (pattern, FC_ANTIALIAS, 0);
     FcPatternAddBool (pattern, FC_AUTOHINT, 0);
     FcPatternAddBool (pattern, FC_SCALABLE, 1);
 }
 
-static PangoContext *
-rsvg_text_get_pango_context (RsvgDrawingCtx * ctx)
+static PangoFontMap *
+rsvg_text_font_map_new (gdouble dpi_x, gdouble dpi_y)
 {
-    PangoContext *context;
     PangoFT2FontMap *fontmap;
 
     fontmap = PANGO_FT2_FONT_MAP (pango_ft2_font_map_new ());
 
-    pango_ft2_font_map_set_resolution (fontmap, ctx->dpi_x, ctx->dpi_y);
+    pango_ft2_font_map_set_resolution (fontmap, dpi_x, dpi_y);
 
     pango_ft2_font_map_set_default_substitute (fontmap,
                                                rsvg_text_ft2_subst_func,
-                                               ctx, (GDestroyNotify) NULL);
-
-    context = pango_ft2_font_map_create_context (fontmap);
-    g_object_unref (fontmap);
-
-    /*  Workaround for bug #143542 (PangoFT2Fontmap leak),
-     *  see also bug #344235 (Text layer rendering leaks font file descriptor):
-     *
-     *  Calling pango_ft2_font_map_substitute_changed() causes the
-     *  font_map cache to be flushed, thereby removing the circular
-     *  reference that causes the leak.
-     */
-    g_object_weak_ref (G_OBJECT (context),
-                       (GWeakNotify) pango_ft2_font_map_substitute_changed, fontmap);
+                                               NULL, (GDestroyNotify) NULL);
 
+    /* The font map lives as long as the process, so the reference cycle
+     * between it and its cached fonts (bug #143542) no longer leaks per
+     * context and the cache is deliberately left intact. */
+    return PANGO_FONT_MAP (fontmap);
+}
 
-    return context;
+static PangoContext *
+rsvg_text_font_map_create_context (PangoFontMap * fontmap)
+{
+    return pango_ft2_font_map_create_context (PANGO_FT2_FONT_MAP (fontmap));
 }
 #else
 /* although the #if condtionalizes on FT2 here we try to use pure cairo */
@@ -488,23 +517,145 @@ typedef void (*RsvgTextRenderFunc) (PangoFont * font,
                                     PangoGlyph glyph,
                                     gint x, gint y, gpointer render_data);
 
-static PangoContext *
-rsvg_text_get_pango_context (RsvgDrawingCtx * ctx)
+static PangoFontMap *
+rsvg_text_font_map_new (gdouble dpi_x, gdouble dpi_y)
 {
-    PangoContext *context;
     PangoCairoFontMap *fontmap;
     
     fontmap = PANGO_CAIRO_FONT_MAP (pango_cairo_font_map_new ());
-    if (ctx->dpi_x != ctx->dpi_y)
+    if (dpi_x != dpi_y)
 	g_warning ("asymmetric dpi not handled");
-    pango_cairo_font_map_set_resolution (fontmap, ctx->dpi_x);
-    context = pango_cairo_font_map_create_context (fontmap);
-    g_object_unref (fontmap);
+    pango_cairo_font_map_set_resolution (fontmap, dpi_x);
     
-    return context;
+    return PANGO_FONT_MAP (fontmap);
+}
+
+static PangoContext *
+rsvg_text_font_map_create_context (PangoFontMap * fontmap)
+{
+    return pango_cairo_font_map_create_context (PANGO_CAIRO_FONT_MAP (fontmap));
 }
 #endif /* #ifdef CAIRO_HAS_FT_FONT */
 
+static RsvgTextFontMap *
+rsvg_text_font_map_lookup (gdouble dpi_x, gdouble dpi_y)
+{
+    RsvgTextFontMap *entry;
+    GSList *link;
+
+    for (link = rsvg_text_font_maps; link != NULL; link = link->next) {
+        entry = link->data;
+        if (entry->dpi_x == dpi_x && entry->dpi_y == dpi_y)
+            return entry;
+    }
+
+    entry = g_new0 (RsvgTextFontMap, 1);
+    entry->dpi_x = dpi_x;
+    entry->dpi_y = dpi_y;
+    entry->fontmap = rsvg_text_font_map_new (dpi_x, dpi_y);
+    rsvg_text_font_maps = g_slist_prepend (rsvg_text_font_maps, entry);
+
+    return entry;
+}
+
+/**
+ * rsvg_text_pango_context_acquire: Takes a context from the shared pool.
+ * @ctx: the drawing context, for its resolution
+ * @for_cairo: whether the context is for pango-cairo drawing rather than
+ * for laying text out as outlines
+ *
+ * The context belongs to the caller until it is given back with
+ * rsvg_text_pango_context_release().
+ */
+PangoContext *
+rsvg_text_pango_context_acquire (RsvgDrawingCtx * ctx, gboolean for_cairo)
+{
+    RsvgTextFontMap *entry;
+    PangoContext *context;
+    GSList **idle;
+
+    _rsvg_text_pango_lock ();
+
+    entry = rsvg_text_font_map_lookup (ctx->dpi_x, ctx->dpi_y);
+    idle = for_cairo ? &entry->idle_cairo_contexts : &entry->idle_contexts;
+
+    if (*idle != NULL) {
+        context = (*idle)->data;
+        *idle = g_slist_delete_link (*idle, *idle);
+    } else if (for_cairo) {
+        if (entry->cairo_fontmap == NULL)
+            entry->cairo_fontmap = pango_cairo_font_map_new ();
+        context = pango_cairo_font_map_create_context (PANGO_CAIRO_FONT_MAP (entry->cairo_fontmap));
+        pango_cairo_context_set_resolution (context, ctx->dpi_y);
+    } else
+        context = rsvg_text_font_map_create_context (entry->fontmap);
+
+    _rsvg_text_pango_unlock ();
+
+    return context;
+}
+
+/**
+ * rsvg_text_pango_context_release: Gives a context back to the pool.
+ * @context: a context from rsvg_text_pango_context_acquire()
+ */
+void
+rsvg_text_pango_context_release (PangoContext * context)
+{
+    PangoFontMap *fontmap;
+    GSList *link;
+
+    _rsvg_text_pango_lock ();
+
+    /* drop what the last render set up for its target */
+    pango_context_set_matrix (context, NULL);
+
+    fontmap = pango_context_get_font_map (context);
+    for (link = rsvg_text_font_maps; link != NULL; link = link->next) {
+        RsvgTextFontMap *entry = link->data;
+
+        if (fontmap == entry->fontmap) {
+            entry->idle_contexts = g_slist_prepend (entry->idle_contexts, context);
+            break;
+        } else if (fontmap == entry->cairo_fontmap) {
+            pango_cairo_context_set_font_options (context, NULL);
+            entry->idle_cairo_contexts = g_slist_prepend (entry->idle_cairo_contexts, context);
+            break;
+        }
+    }
+
+    /* the pool is gone after rsvg_term () */
+    if (link == NULL)
+        g_object_unref (context);
+
+    _rsvg_text_pango_unlock ();
+}
+
+/* Drops the shared font maps and their contexts, for rsvg_term () */
+void
+rsvg_text_font_maps_free (void)
+{
+    GSList *link;
+
+    _rsvg_text_pango_lock ();
+
+    for (link = rsvg_text_font_maps; link != NULL; link = link->next) {
+        RsvgTextFontMap *entry = link->data;
+        g_slist_foreach (entry->idle_contexts, (GFunc) g_object_unref, NULL);
+        g_slist_free (entry->idle_contexts);
+        g_slist_foreach (entry->idle_cairo_contexts, (GFunc) g_object_unref, NULL);
+        g_slist_free (entry->idle_cairo_contexts);
+        g_object_unref (entry->fontmap);
+        if (entry->cairo_fontmap)
+            g_object_unref (entry->cairo_fontmap);
+        g_free (entry);
+    }
+    g_slist_free (rsvg_text_font_maps);
+    rsvg_text_font_maps = NULL;
+
+    _rsvg_text_pango_unlock ();
+}
+
 static void
 rsvg_text_layout_free (RsvgTextLayout * layout)
 {
@@ -512,25 +663,98 @@ rsvg_text_layout_free (RsvgTextLayout * layout)
     g_free (layout);
 }
 
+/* Shaping a chunk is by far the most expensive part of drawing text, and a
+ * chunk is shaped twice when text-anchor needs its width first.  A render
+ * keeps the layout each character node was last shaped into, along with
+ * everything that shaping depended on, in its drawing context.  The cache
+ * goes away with the drawing context, so it never outlives the pango
+ * context it was shaped with, and it is never shared between renders or
+ * threads, even when they draw the same shared document. */
+typedef struct {
+    PangoContext *context;
+    cairo_font_options_t *font_options;
+    gdouble matrix[4];
+    gchar *text;
+    PangoFontDescription *font_desc;
+    gint letter_spacing;
+    PangoLanguage *language;
+    PangoDirection base_dir;
+    PangoAlignment alignment;
+    PangoLayout *layout;
+} RsvgTextLayoutCache;
+
+static void
+rsvg_text_layout_cache_free (RsvgTextLayoutCache * cache)
+{
+    _rsvg_text_pango_lock ();
+    g_object_unref (cache->layout);
+    g_object_unref (cache->context);
+    pango_font_description_free (cache->font_desc);
+    _rsvg_text_pango_unlock ();
+    if (cache->font_options)
+        cairo_font_options_destroy (cache->font_options);
+    g_free (cache->text);
+    g_free (cache);
+}
+
+/* The options pango-cairo copied from the target; they change the glyph
+   metrics, so a layout shaped under other options can't be reused */
+static gboolean
+rsvg_text_font_options_equal (const cairo_font_options_t * a, const cairo_font_options_t * b)
+{
+    if (a == NULL || b == NULL)
+        return a == b;
+    return cairo_font_options_equal (a, b);
+}
+
+static void
+rsvg_text_context_get_matrix (PangoContext * context, gdouble matrix[4])
+{
+    const PangoMatrix *m = pango_context_get_matrix (context);
+
+    /* translation does not affect shaping */
+    matrix[0] = m ? m->xx : 1.;
+    matrix[1] = m ? m->xy : 0.;
+    matrix[2] = m ? m->yx : 0.;
+    matrix[3] = m ? m->yy : 1.;
+}
+
 static PangoLayout *
-rsvg_text_create_layout (RsvgDrawingCtx * ctx,
+rsvg_text_create_layout (RsvgDrawingCtx * ctx, RsvgNodeChars * chars,
                          RsvgState * state, const char *text, PangoContext * context)
 {
+    RsvgTextLayoutCache *cache;
+    const cairo_font_options_t *font_options;
     PangoFontDescription *font_desc;
     PangoLayout *layout;
     PangoAttrList *attr_list;
     PangoAttribute *attribute;
+    PangoLanguage *language;
+    PangoDirection base_dir;
+    PangoAlignment alignment;
+    gint letter_spacing;
+    gdouble matrix[4];
+
+    if (text == NULL)
+        text = "";
 
+    /* The context is reused between chunks, so reset what a previous one set */
     if (state->lang)
-        pango_context_set_language (context, pango_language_from_string (state->lang));
+        language = pango_language_from_string (state->lang);
+    else
+        language = pango_language_get_default ();
+    pango_context_set_language (context, language);
 
     if (state->unicode_bidi == UNICODE_BIDI_OVERRIDE || state->unicode_bidi == UNICODE_BIDI_EMBED)
-        pango_context_set_base_dir (context, state->text_dir);
+        base_dir = state->text_dir;
+    else
+        base_dir = PANGO_DIRECTION_WEAK_LTR;
+    pango_context_set_base_dir (context, base_dir);
 
     font_desc = pango_font_description_copy (pango_context_get_font_description (context));
 
     if (state->font_family)
-        pango_font_description_set_family_static (font_desc, state->font_family);
+        pango_font_description_set_family (font_desc, state->font_family);
 
     pango_font_description_set_style (font_desc, state->font_style);
     pango_font_description_set_variant (font_desc, state->font_variant);
@@ -541,43 +765,84 @@ rsvg_text_create_layout (RsvgDrawingCtx * ctx,
                                                                  'v') * PANGO_SCALE / ctx->dpi_y *
                                      72);
 
+    letter_spacing = _rsvg_css_normalize_length (&state->letter_spacing, ctx, 'h') * PANGO_SCALE;
+
+    alignment = (state->text_dir == PANGO_DIRECTION_LTR ||
+                 state->text_dir == PANGO_DIRECTION_TTB_LTR) ? PANGO_ALIGN_LEFT : PANGO_ALIGN_RIGHT;
+
+    rsvg_text_context_get_matrix (context, matrix);
+    font_options = pango_cairo_context_get_font_options (context);
+
+    cache = chars && ctx->layout_cache ? g_hash_table_lookup (ctx->layout_cache, chars) : NULL;
+    if (cache &&
+        cache->context == context &&
+        rsvg_text_font_options_equal (cache->font_options, font_options) &&
+        cache->matrix[0] == matrix[0] && cache->matrix[1] == matrix[1] &&
+        cache->matrix[2] == matrix[2] && cache->matrix[3] == matrix[3] &&
+        cache->letter_spacing == letter_spacing &&
+        cache->language == language &&
+        cache->base_dir == base_dir &&
+        cache->alignment == alignment &&
+        !strcmp (cache->text, text) &&
+        pango_font_description_equal (cache->font_desc, font_desc)) {
+        pango_font_description_free (font_desc);
+        return g_object_ref (cache->layout);
+    }
+
     layout = pango_layout_new (context);
     pango_layout_set_font_description (layout, font_desc);
-    pango_font_description_free (font_desc);
 
     attr_list = pango_attr_list_new ();
-    attribute = pango_attr_letter_spacing_new ( _rsvg_css_normalize_length (&state->letter_spacing, 
-									    ctx, 'h') * PANGO_SCALE);
+    attribute = pango_attr_letter_spacing_new (letter_spacing);
     attribute->start_index = 0;
     attribute->end_index = G_MAXINT;
     pango_attr_list_insert (attr_list, attribute); 
     pango_layout_set_attributes (layout, attr_list);
     pango_attr_list_unref (attr_list);
 
-    if (text)
-        pango_layout_set_text (layout, text, -1);
-    else
-        pango_layout_set_text (layout, NULL, 0);
+    pango_layout_set_text (layout, text, -1);
+
+    pango_layout_set_alignment (layout, alignment);
+
+    if (chars == NULL) {
+        pango_font_description_free (font_desc);
+        return layout;
+    }
 
-    pango_layout_set_alignment (layout, (state->text_dir == PANGO_DIRECTION_LTR ||
-                                         state->text_dir == PANGO_DIRECTION_TTB_LTR) ?
-                                PANGO_ALIGN_LEFT : PANGO_ALIGN_RIGHT);
+    cache = g_new (RsvgTextLayoutCache, 1);
+    cache->context = g_object_ref (context);
+    cache->font_options = font_options ? cairo_font_options_copy (font_options) : NULL;
+    memcpy (cache->matrix, matrix, sizeof (matrix));
+    cache->text = g_strdup (text);
+    cache->font_desc = font_desc;
+    cache->letter_spacing = letter_spacing;
+    cache->language = language;
+    cache->base_dir = base_dir;
+    cache->alignment = alignment;
+    cache->layout = g_object_ref (layout);
+
+    /* replaces, and frees, what the node was shaped into before */
+    if (ctx->layout_cache == NULL)
+        ctx->layout_cache = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+                                                   (GDestroyNotify) rsvg_text_layout_cache_free);
+    g_hash_table_insert (ctx->layout_cache, chars, cache);
 
     return layout;
 }
 
 
 static RsvgTextLayout *
-rsvg_text_layout_new (RsvgDrawingCtx * ctx, RsvgState * state, const char *text)
+rsvg_text_layout_new (RsvgDrawingCtx * ctx, RsvgNodeChars * chars,
+                      RsvgState * state, const char *text)
 {
     RsvgTextLayout *layout;
 
     if (ctx->pango_context == NULL)
-        ctx->pango_context = rsvg_text_get_pango_context (ctx);
+        ctx->pango_context = rsvg_text_pango_context_acquire (ctx, FALSE);
 
     layout = g_new0 (RsvgTextLayout, 1);
 
-    layout->layout = rsvg_text_create_layout (ctx, state, text, ctx->pango_context);
+    layout->layout = rsvg_text_create_layout (ctx, chars, state, text, ctx->pango_context);
     layout->ctx = ctx;
 
     layout->anchor = state->text_anchor;
@@ -599,33 +864,50 @@ rsvg_text_layout_render_flags (RsvgTextLayout * layout)
 }
 
 static void
-rsvg_text_vector_coords (RenderCtx * ctx, const FT_Vector * vector, gdouble * x, gdouble * y)
+rsvg_text_vector_coords (const FT_Vector * vector, gdouble * x, gdouble * y)
 {
-    *x = ctx->offset_x + (double) vector->x / 64;
-    *y = ctx->offset_y - (double) vector->y / 64;
+    *x = (double) vector->x / 64;
+    *y = -(double) vector->y / 64;
 }
 
-static gint
-moveto (const FT_Vector * to, gpointer data)
+/* Glyph outlines are decomposed once, relative to the glyph origin, and
+ * kept on the PangoFont they came from (which pins the face and size).
+ * Only RSVG_MOVETO_OPEN, RSVG_LINETO and RSVG_CURVETO entries are stored;
+ * quadratic segments are raised to cubics while decomposing. */
+typedef struct {
+    RsvgBpath *bpath;
+    gint n_bpath;
+    gint ascender;
+} RsvgGlyphOutline;
+
+typedef struct {
+    GArray *bpath;
+    gdouble cpx, cpy;
+} RsvgGlyphDecompose;
+
+G_LOCK_DEFINE_STATIC (rsvg_text_glyph_outlines);
+
+static void
+rsvg_glyph_outline_free (gpointer data)
 {
-    RenderCtx *ctx;
-    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
-    gdouble x, y;
+    RsvgGlyphOutline *outline = data;
 
-    ctx = (RenderCtx *) data;
+    g_free (outline->bpath);
+    g_free (outline);
+}
 
-    if (ctx->wrote)
-        g_string_append (ctx->path, "Z ");
-    else
-        ctx->wrote = TRUE;
+static gint
+moveto (const FT_Vector * to, gpointer data)
+{
+    RsvgGlyphDecompose *decompose = (RsvgGlyphDecompose *) data;
+    RsvgBpath bpath;
 
-    g_string_append_c (ctx->path, 'M');
+    bpath.code = RSVG_MOVETO_OPEN;
+    rsvg_text_vector_coords (to, &bpath.x3, &bpath.y3);
+    g_array_append_val (decompose->bpath, bpath);
 
-    rsvg_text_vector_coords (ctx, to, &x, &y);
-    g_string_append (ctx->path, g_ascii_dtostr (buf, sizeof (buf), x));
-    g_string_append_c (ctx->path, ',');
-    g_string_append (ctx->path, g_ascii_dtostr (buf, sizeof (buf), y));
-    g_string_append_c (ctx->path, ' ');
+    decompose->cpx = bpath.x3;
+    decompose->cpy = bpath.y3;
 
     return 0;
 }
@@ -633,22 +915,15 @@ moveto (const FT_Vector * to, gpointer data)
 static gint
 lineto (const FT_Vector * to, gpointer data)
 {
-    RenderCtx *ctx;
-    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
-    gdouble x, y;
+    RsvgGlyphDecompose *decompose = (RsvgGlyphDecompose *) data;
+    RsvgBpath bpath;
 
-    ctx = (RenderCtx *) data;
+    bpath.code = RSVG_LINETO;
+    rsvg_text_vector_coords (to, &bpath.x3, &bpath.y3);
+    g_array_append_val (decompose->bpath, bpath);
 
-    if (!ctx->wrote)
-        return 0;
-
-    g_string_append_c (ctx->path, 'L');
-
-    rsvg_text_vector_coords (ctx, to, &x, &y);
-    g_string_append (ctx->path, g_ascii_dtostr (buf, sizeof (buf), x));
-    g_string_append_c (ctx->path, ',');
-    g_string_append (ctx->path, g_ascii_dtostr (buf, sizeof (buf), y));
-    g_string_append_c (ctx->path, ' ');
+    decompose->cpx = bpath.x3;
+    decompose->cpy = bpath.y3;
 
     return 0;
 }
@@ -656,66 +931,103 @@ lineto (const FT_Vector * to, gpointer data)
 static gint
 conicto (const FT_Vector * ftcontrol, const FT_Vector * to, gpointer data)
 {
-    RenderCtx *ctx;
-    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
-    gdouble x, y;
-
-    ctx = (RenderCtx *) data;
+    RsvgGlyphDecompose *decompose = (RsvgGlyphDecompose *) data;
+    RsvgBpath bpath;
+    gdouble xc, yc;
+
+    /* raise quadratic bezier to cubic */
+    rsvg_text_vector_coords (ftcontrol, &xc, &yc);
+    rsvg_text_vector_coords (to, &bpath.x3, &bpath.y3);
+    bpath.code = RSVG_CURVETO;
+    bpath.x1 = (decompose->cpx + 2 * xc) * (1.0 / 3.0);
+    bpath.y1 = (decompose->cpy + 2 * yc) * (1.0 / 3.0);
+    bpath.x2 = (bpath.x3 + 2 * xc) * (1.0 / 3.0);
+    bpath.y2 = (bpath.y3 + 2 * yc) * (1.0 / 3.0);
+    g_array_append_val (decompose->bpath, bpath);
+
+    decompose->cpx = bpath.x3;
+    decompose->cpy = bpath.y3;
 
-    if (!ctx->wrote)
-        return 0;
+    return 0;
+}
 
-    g_string_append_c (ctx->path, 'Q');
+static gint
+cubicto (const FT_Vector * ftcontrol1,
+         const FT_Vector * ftcontrol2, const FT_Vector * to, gpointer data)
+{
+    RsvgGlyphDecompose *decompose = (RsvgGlyphDecompose *) data;
+    RsvgBpath bpath;
 
-    rsvg_text_vector_coords (ctx, ftcontrol, &x, &y);
-    g_string_append (ctx->path, g_ascii_dtostr (buf, sizeof (buf), x));
-    g_string_append_c (ctx->path, ',');
-    g_string_append (ctx->path, g_ascii_dtostr (buf, sizeof (buf), y));
+    bpath.code = RSVG_CURVETO;
+    rsvg_text_vector_coords (ftcontrol1, &bpath.x1, &bpath.y1);
+    rsvg_text_vector_coords (ftcontrol2, &bpath.x2, &bpath.y2);
+    rsvg_text_vector_coords (to, &bpath.x3, &bpath.y3);
+    g_array_append_val (decompose->bpath, bpath);
 
-    rsvg_text_vector_coords (ctx, to, &x, &y);
-    g_string_append_c (ctx->path, ' ');
-    g_string_append (ctx->path, g_ascii_dtostr (buf, sizeof (buf), x));
-    g_string_append_c (ctx->path, ',');
-    g_string_append (ctx->path, g_ascii_dtostr (buf, sizeof (buf), y));
-    g_string_append_c (ctx->path, ' ');
+    decompose->cpx = bpath.x3;
+    decompose->cpy = bpath.y3;
 
     return 0;
 }
 
-static gint
-cubicto (const FT_Vector * ftcontrol1,
-         const FT_Vector * ftcontrol2, const FT_Vector * to, gpointer data)
+/* Must be called with the rsvg_text_glyph_outlines lock held, which also
+ * serialises use of the (shared) FreeType faces. */
+static RsvgGlyphOutline *
+rsvg_text_glyph_outline_lookup (PangoFont * font, PangoGlyph pango_glyph, FT_Int32 flags)
 {
-    RenderCtx *ctx;
-    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
-    gdouble x, y;
+    static const FT_Outline_Funcs outline_funcs = {
+        (FT_Outline_MoveToFunc) moveto,
+        (FT_Outline_LineToFunc) lineto,
+        (FT_Outline_ConicToFunc) conicto,
+        (FT_Outline_CubicToFunc) cubicto,
+        0,
+        0
+    };
 
-    ctx = (RenderCtx *) data;
+    GHashTable *outlines;
+    RsvgGlyphOutline *outline;
+    RsvgGlyphDecompose decompose;
+    FT_Face face;
+    FT_Glyph glyph;
 
-    if (!ctx->wrote)
-        return 0;
+    /* flags are the same for every glyph, see rsvg_text_layout_render_flags */
+    outlines = g_object_get_data (G_OBJECT (font), "rsvg-glyph-outlines");
+    if (outlines == NULL) {
+        outlines = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                          NULL, rsvg_glyph_outline_free);
+        g_object_set_data_full (G_OBJECT (font), "rsvg-glyph-outlines", outlines,
+                                (GDestroyNotify) g_hash_table_destroy);
+    }
 
-    g_string_append_c (ctx->path, 'C');
+    outline = g_hash_table_lookup (outlines, GUINT_TO_POINTER (pango_glyph));
+    if (outline)
+        return outline;
 
-    rsvg_text_vector_coords (ctx, ftcontrol1, &x, &y);
-    g_string_append (ctx->path, g_ascii_dtostr (buf, sizeof (buf), x));
-    g_string_append_c (ctx->path, ',');
-    g_string_append (ctx->path, g_ascii_dtostr (buf, sizeof (buf), y));
+    face = pango_ft2_font_get_face (font);
 
-    rsvg_text_vector_coords (ctx, ftcontrol2, &x, &y);
-    g_string_append_c (ctx->path, ' ');
-    g_string_append (ctx->path, g_ascii_dtostr (buf, sizeof (buf), x));
-    g_string_append_c (ctx->path, ',');
-    g_string_append (ctx->path, g_ascii_dtostr (buf, sizeof (buf), y));
+    if (0 != FT_Load_Glyph (face, (FT_UInt) pango_glyph, flags))
+		return NULL;
 
-    rsvg_text_vector_coords (ctx, to, &x, &y);
-    g_string_append_c (ctx->path, ' ');
-    g_string_append (ctx->path, g_ascii_dtostr (buf, sizeof (buf), x));
-    g_string_append_c (ctx->path, ',');
-    g_string_append (ctx->path, g_ascii_dtostr (buf, sizeof (buf), y));
-    g_string_append_c (ctx->path, ' ');
+    if (0 != FT_Get_Glyph (face->glyph, &glyph))
+		return NULL;
 
-    return 0;
+    decompose.bpath = g_array_new (FALSE, FALSE, sizeof (RsvgBpath));
+    decompose.cpx = decompose.cpy = 0;
+
+    if (face->glyph->format == FT_GLYPH_FORMAT_OUTLINE) {
+        FT_OutlineGlyph outline_glyph = (FT_OutlineGlyph) glyph;
+        FT_Outline_Decompose (&outline_glyph->outline, &outline_funcs, &decompose);
+    }
+
+    FT_Done_Glyph (glyph);
+
+    outline = g_new (RsvgGlyphOutline, 1);
+    outline->n_bpath = decompose.bpath->len;
+    outline->bpath = (RsvgBpath *) g_array_free (decompose.bpath, FALSE);
+    outline->ascender = (int) face->size->metrics.ascender / 64;
+    g_hash_table_insert (outlines, GUINT_TO_POINTER (pango_glyph), outline);
+
+    return outline;
 }
 
 static gint
@@ -750,38 +1062,50 @@ static void
 rsvg_text_render_vectors (PangoFont * font,
                           PangoGlyph pango_glyph, FT_Int32 flags, gint x, gint y, gpointer ud)
 {
-    static const FT_Outline_Funcs outline_funcs = {
-        (FT_Outline_MoveToFunc) moveto,
-        (FT_Outline_LineToFunc) lineto,
-        (FT_Outline_ConicToFunc) conicto,
-        (FT_Outline_CubicToFunc) cubicto,
-        0,
-        0
-    };
-
-    FT_Face face;
-    FT_Glyph glyph;
-
+    RsvgGlyphOutline *outline;
     RenderCtx *context = (RenderCtx *) ud;
+    gdouble offset_x, offset_y;
+    gint i;
 
-    face = pango_ft2_font_get_face (font);
-
-    if (0 != FT_Load_Glyph (face, (FT_UInt) pango_glyph, flags))
-		return;
+    G_LOCK (rsvg_text_glyph_outlines);
 
-    if (0 != FT_Get_Glyph (face->glyph, &glyph))
-		return;
+    outline = rsvg_text_glyph_outline_lookup (font, pango_glyph, flags);
+    if (outline == NULL) {
+        G_UNLOCK (rsvg_text_glyph_outlines);
+        return;
+    }
 
-    if (face->glyph->format == FT_GLYPH_FORMAT_OUTLINE) {
-        FT_OutlineGlyph outline_glyph = (FT_OutlineGlyph) glyph;
+    offset_x = (gdouble) x / PANGO_SCALE;
+    offset_y = (gdouble) y / PANGO_SCALE - outline->ascender;
 
-        context->offset_x = (gdouble) x / PANGO_SCALE;
-        context->offset_y = (gdouble) y / PANGO_SCALE - (int) face->size->metrics.ascender / 64;
+    for (i = 0; i < outline->n_bpath; i++) {
+        const RsvgBpath *bpath = &outline->bpath[i];
 
-        FT_Outline_Decompose (&outline_glyph->outline, &outline_funcs, context);
+        switch (bpath->code) {
+        case RSVG_MOVETO_OPEN:
+            if (context->wrote)
+                rsvg_bpath_def_closepath (context->path);
+            else
+                context->wrote = TRUE;
+            rsvg_bpath_def_moveto (context->path, offset_x + bpath->x3, offset_y + bpath->y3);
+            break;
+        case RSVG_LINETO:
+            if (context->wrote)
+                rsvg_bpath_def_lineto (context->path, offset_x + bpath->x3, offset_y + bpath->y3);
+            break;
+        case RSVG_CURVETO:
+            if (context->wrote)
+                rsvg_bpath_def_curveto (context->path,
+                                        offset_x + bpath->x1, offset_y + bpath->y1,
+                                        offset_x + bpath->x2, offset_y + bpath->y2,
+                                        offset_x + bpath->x3, offset_y + bpath->y3);
+            break;
+        default:
+            break;
+        }
     }
 
-    FT_Done_Glyph (glyph);
+    G_UNLOCK (rsvg_text_glyph_outlines);
 }
 #else 
 static gint
@@ -869,19 +1193,20 @@ rsvg_text_layout_render (RsvgTextLayout * layout,
     pango_layout_iter_free (iter);
 }
 
-static GString *
-rsvg_text_render_text_as_string (RsvgDrawingCtx * ctx, const char *text, gdouble * x, gdouble * y)
+static RsvgBpathDef *
+rsvg_text_render_text_as_bpath (RsvgDrawingCtx * ctx, RsvgNodeChars * chars,
+                                const char *text, gdouble * x, gdouble * y)
 {
     RsvgTextLayout *layout;
     RenderCtx *render;
     RsvgState *state;
-    GString *output;
+    RsvgBpathDef *output;
     state = rsvg_state_current (ctx);
 
     state->fill_rule = FILL_RULE_EVENODD;
     state->has_fill_rule = TRUE;
 
-    layout = rsvg_text_layout_new (ctx, state, text);
+    layout = rsvg_text_layout_new (ctx, chars, state, text);
     layout->x = *x;
     layout->y = *y;
     layout->orientation = rsvg_state_current (ctx)->text_dir == PANGO_DIRECTION_TTB_LTR ||
@@ -891,19 +1216,22 @@ rsvg_text_render_text_as_string (RsvgDrawingCtx * ctx, const char *text, gdouble
     rsvg_text_layout_render (layout, rsvg_text_render_vectors, (gpointer) render);
 
     if (render->wrote)
-        g_string_append_c (render->path, 'Z');
+        rsvg_bpath_def_closepath (render->path);
+    rsvg_bpath_def_art_finish (render->path);
 
     *x = layout->x;
     *y = layout->y;
 
-    output = g_string_new (render->path->str);
+    output = render->path;
+    render->path = NULL;
     rsvg_render_ctx_free (render);
     rsvg_text_layout_free (layout);
     return output;
 }
 
-void
-rsvg_text_render_text (RsvgDrawingCtx * ctx, const char *text, gdouble * x, gdouble * y)
+static void
+rsvg_text_render_text (RsvgDrawingCtx * ctx, RsvgNodeChars * chars,
+                       const char *text, gdouble * x, gdouble * y)
 {
     if (ctx->render->create_pango_context && ctx->render->render_pango_layout) {
         PangoContext *context;
@@ -912,22 +1240,31 @@ rsvg_text_render_text (RsvgDrawingCtx * ctx, const char *text, gdouble * x, gdou
         RsvgState *state;
         gint w, h, baseline;
 
+        _rsvg_text_pango_lock ();
         state = rsvg_state_current (ctx);
         context = ctx->render->create_pango_context (ctx);
-        layout = rsvg_text_create_layout (ctx, state, text, context);
+        layout = rsvg_text_create_layout (ctx, chars, state, text, context);
         pango_layout_get_size (layout, &w, &h);
         iter = pango_layout_get_iter (layout);
         baseline = pango_layout_iter_get_baseline (iter) / (double)PANGO_SCALE;
         pango_layout_iter_free (iter);
+        _rsvg_text_pango_unlock ();
+
+        /* takes the lock itself, only around the pango calls */
         ctx->render->render_pango_layout (ctx, layout, *x, *y - baseline);
         *x += w / (double)PANGO_SCALE;
+
+        _rsvg_text_pango_lock ();
         g_object_unref (layout);
         g_object_unref (context);
+        _rsvg_text_pango_unlock ();
     } else {
-        GString *render;
-        render = rsvg_text_render_text_as_string (ctx, text, x, y);
-        rsvg_render_path (ctx, render->str);
-        g_string_free (render, TRUE);
+        RsvgBpathDef *bpath_def;
+        _rsvg_text_pango_lock ();
+        bpath_def = rsvg_text_render_text_as_bpath (ctx, chars, text, x, y);
+        _rsvg_text_pango_unlock ();
+        rsvg_render_bpath (ctx, bpath_def);
+        rsvg_bpath_def_free (bpath_def);
     }
 }
 
@@ -942,12 +1279,30 @@ rsvg_text_layout_width (RsvgTextLayout * layout)
 }
 
 static gdouble
-rsvg_text_length_text_as_string (RsvgDrawingCtx * ctx, const char *text)
+rsvg_text_length_text_as_string (RsvgDrawingCtx * ctx, RsvgNodeChars * chars, const char *text)
 {
     RsvgTextLayout *layout;
     gdouble x;
 
-    layout = rsvg_text_layout_new (ctx, rsvg_state_current (ctx), text);
+    /* Measure with the context the chunk will be drawn with, so drawing
+     * reuses the layout shaped here */
+    if (ctx->render->create_pango_context && ctx->render->render_pango_layout) {
+        PangoContext *context;
+        PangoLayout *pango_layout;
+        gint w;
+
+        _rsvg_text_pango_lock ();
+        context = ctx->render->create_pango_context (ctx);
+        pango_layout = rsvg_text_create_layout (ctx, chars, rsvg_state_current (ctx), text, context);
+        pango_layout_get_size (pango_layout, &w, NULL);
+        g_object_unref (pango_layout);
+        g_object_unref (context);
+        _rsvg_text_pango_unlock ();
+        return w / (double)PANGO_SCALE;
+    }
+
+    _rsvg_text_pango_lock ();
+    layout = rsvg_text_layout_new (ctx, chars, rsvg_state_current (ctx), text);
     layout->x = layout->y = 0;
     layout->orientation = rsvg_state_current (ctx)->text_dir == PANGO_DIRECTION_TTB_LTR ||
         rsvg_state_current (ctx)->text_dir == PANGO_DIRECTION_TTB_RTL;
@@ -955,5 +1310,6 @@ rsvg_text_length_text_as_string (RsvgDrawingCtx * ctx, const char *text)
     x = rsvg_text_layout_width (layout);
 
     rsvg_text_layout_free (layout);
+    _rsvg_text_pango_unlock ();
     return x;
 }
@@ -31,10 +31,15 @@
 
 G_BEGIN_DECLS 
 
-RsvgNode    *rsvg_new_text	    (void);
-RsvgNode    *rsvg_new_tspan	    (void);
-RsvgNode    *rsvg_new_tref	    (void);
+RsvgNode    *rsvg_new_text	    (RsvgArena * arena);
+RsvgNode    *rsvg_new_tspan	    (RsvgArena * arena);
+RsvgNode    *rsvg_new_tref	    (RsvgArena * arena);
 char	    *rsvg_make_valid_utf8   (const char *str, int len);
+void	     rsvg_text_font_maps_free	(void);
+PangoContext *rsvg_text_pango_context_acquire (RsvgDrawingCtx * ctx, gboolean for_cairo);
+void	     rsvg_text_pango_context_release (PangoContext * context);
+void	     _rsvg_text_pango_lock	(void);
+void	     _rsvg_text_pango_unlock	(void);
 
 G_END_DECLS
 
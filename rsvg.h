@@ -103,6 +103,10 @@ void rsvg_term (void);
 void rsvg_set_default_dpi	(double dpi);
 void rsvg_set_default_dpi_x_y	(double dpi_x, double dpi_y);
 
+void rsvg_set_extern_cache_size	(gsize max_size);
+void rsvg_get_extern_cache_stats	(guint * hits, guint * misses,
+					 guint * n_documents, gsize * size);
+
 void rsvg_handle_set_dpi	(RsvgHandle * handle, double dpi);
 void rsvg_handle_set_dpi_x_y	(RsvgHandle * handle, double dpi_x, double dpi_y);
 
@@ -28,10 +28,219 @@
 #include <glib.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "rsvg.h"
 #include "rsvg-private.h"
 
+/* Generated documents, each built to stress one part of the renderer
+   with @n elements */
+
+/* A chart with @n text labels, for the shared font maps and contexts and
+   the text layout */
+static GString *
+generate_labels (int n, guint64 * bytes)
+{
+    GString *svg = g_string_new (NULL);
+    int i, columns = 100;
+
+    g_string_append_printf (svg, "<svg xmlns=\"http://www.w3.org/2000/svg\" "
+                            "width=\"%d\" height=\"%d\">\n",
+                            columns * 40, (n / columns + 1) * 12);
+    for (i = 0; i < n; i++)
+        g_string_append_printf (svg, "<text x=\"%d\" y=\"%d\" font-family=\"sans-serif\" "
+                                "font-size=\"9\" text-anchor=\"middle\">%d</text>\n",
+                                (i % columns) * 40 + 20, (i / columns) * 12 + 10, i);
+    g_string_append (svg, "</svg>\n");
+
+    *bytes = 0;
+    return svg;
+}
+
+/* @n squares under one filter that offsets them, tiles a corner of them
+   and merges both over the original, for the feOffset, feTile and feMerge
+   copies.  Each of the three writes the whole filter region, which is
+   the whole canvas, and that is what @bytes counts. */
+static GString *
+generate_filters (int n, guint64 * bytes)
+{
+    GString *svg = g_string_new (NULL);
+    int i, columns = 64, width, height;
+
+    width = columns * 16;
+    height = (n + columns - 1) / columns * 16;
+
+    g_string_append_printf (svg, "<svg xmlns=\"http://www.w3.org/2000/svg\" "
+                            "width=\"%d\" height=\"%d\">\n", width, height);
+    g_string_append_printf (svg, "<filter id=\"f\" filterUnits=\"userSpaceOnUse\" "
+                            "x=\"0\" y=\"0\" width=\"%d\" height=\"%d\">\n"
+                            "<feOffset in=\"SourceGraphic\" dx=\"3\" dy=\"5\" result=\"offset\"/>\n"
+                            "<feOffset in=\"SourceGraphic\" x=\"0\" y=\"0\" width=\"64\" height=\"64\" "
+                            "result=\"corner\"/>\n"
+                            "<feTile in=\"corner\" result=\"tiled\"/>\n"
+                            "<feMerge><feMergeNode in=\"tiled\"/><feMergeNode in=\"offset\"/>"
+                            "<feMergeNode in=\"SourceGraphic\"/></feMerge>\n"
+                            "</filter>\n<g filter=\"url(#f)\">\n", width, height);
+    for (i = 0; i < n; i++)
+        g_string_append_printf (svg, "<rect x=\"%d\" y=\"%d\" width=\"12\" height=\"12\" "
+                                "fill=\"#%06x\" fill-opacity=\"0.75\"/>\n",
+                                (i % columns) * 16 + 2, (i / columns) * 16 + 2,
+                                (i * 2654435761u) & 0xffffff);
+    g_string_append (svg, "</g>\n</svg>\n");
+
+    *bytes = (guint64) 3 * width * height * 4;
+    return svg;
+}
+
+/* A grid of map tiles with @n shapes between them, where each tile is
+   cut out by its own clip rectangle and every layer in it is clipped to
+   it again, for the clip path geometry cache and the rectangle clip */
+static GString *
+generate_map (int n, guint64 * bytes)
+{
+    static const char *layers[] = {
+        "fill=\"#aad3df\"",
+        "fill=\"#c8facc\"",
+        "fill=\"none\" stroke=\"#ffffff\" stroke-width=\"6\"",
+        "fill=\"#d9d0c9\" stroke=\"#b9a99f\""
+    };
+    GString *svg = g_string_new (NULL);
+    int n_layers = G_N_ELEMENTS (layers);
+    int tile, tiles, columns = 8, size = 128, per_layer = 8, i, j;
+
+    tiles = (n + n_layers * per_layer - 1) / (n_layers * per_layer);
+
+    g_string_append_printf (svg, "<svg xmlns=\"http://www.w3.org/2000/svg\" "
+                            "width=\"%d\" height=\"%d\">\n",
+                            columns * size, (tiles + columns - 1) / columns * size);
+    for (tile = 0; tile < tiles; tile++) {
+        int x = (tile % columns) * size, y = (tile / columns) * size;
+
+        g_string_append_printf (svg, "<clipPath id=\"t%d\"><rect x=\"%d\" y=\"%d\" "
+                                "width=\"%d\" height=\"%d\"/></clipPath>\n"
+                                "<g clip-path=\"url(#t%d)\">\n", tile, x, y, size, size, tile);
+        for (i = 0; i < n_layers; i++) {
+            g_string_append_printf (svg, "<g clip-path=\"url(#t%d)\" %s>\n", tile, layers[i]);
+            /* the shapes overhang the tile, as they do when a map is cut
+               into tiles */
+            for (j = 0; j < per_layer; j++) {
+                int k = (tile * 31 + i * 7 + j * 13) % size;
+
+                if (i == 2)     /* the roads */
+                    g_string_append_printf (svg, "<path d=\"M%d %d L%d %d L%d %d\"/>\n",
+                                            x - 20, y + k, x + k, y + size / 2,
+                                            x + size + 20, y + size - k);
+                else
+                    g_string_append_printf (svg, "<rect x=\"%d\" y=\"%d\" width=\"%d\" "
+                                            "height=\"%d\"/>\n", x + k - 16, y + (k * 3) % size - 16,
+                                            24 + j * 4, 20 + i * 6);
+            }
+            g_string_append (svg, "</g>\n");
+        }
+        g_string_append (svg, "</g>\n");
+    }
+    g_string_append (svg, "</svg>\n");
+
+    *bytes = 0;
+    return svg;
+}
+
+/* @n shapes, each with a handful of presentation attributes and a style
+   attribute of several declarations, for the style property dispatch */
+static GString *
+generate_styled (int n, guint64 * bytes)
+{
+    GString *svg = g_string_new (NULL);
+    int i, columns = 100;
+
+    g_string_append_printf (svg, "<svg xmlns=\"http://www.w3.org/2000/svg\" "
+                            "width=\"%d\" height=\"%d\">\n",
+                            columns * 10, (n / columns + 1) * 10);
+    for (i = 0; i < n; i++)
+        g_string_append_printf (svg, "<rect x=\"%d\" y=\"%d\" width=\"8\" height=\"8\" "
+                                "fill=\"#%06x\" stroke=\"black\" stroke-linejoin=\"round\" "
+                                "opacity=\"0.9\" style=\"fill-opacity: 0.8; stroke-width: 0.5; "
+                                "stroke-dasharray: 1 1; font-family: serif; visibility: visible\"/>\n",
+                                (i % columns) * 10 + 1, (i / columns) * 10 + 1,
+                                (i * 2654435761u) & 0xffffff);
+    g_string_append (svg, "</svg>\n");
+
+    *bytes = 0;
+    return svg;
+}
+
+typedef GString *(*DocumentGenerator) (int n, guint64 * bytes);
+
+static const struct {
+    const char *name;
+    DocumentGenerator generate;
+} generators[] = {
+    {"labels", generate_labels},
+    {"filters", generate_filters},
+    {"map", generate_map},
+    {"styled", generate_styled}
+};
+
+static int
+time_generated (const char *name, int n, int count)
+{
+    GString *svg = NULL;
+    GTimer *timer;
+    guint64 bytes = 0;
+    double load = 0, render = 0;
+    guint i;
+    int j;
+
+    for (i = 0; i < G_N_ELEMENTS (generators); i++)
+        if (!strcmp (generators[i].name, name)) {
+            svg = generators[i].generate (n, &bytes);
+            break;
+        }
+
+    if (svg == NULL) {
+        g_print ("Unknown document '%s'\n", name);
+        return 1;
+    }
+
+    fprintf (stdout, "Generated '%s' with %d elements, %lu bytes\n", name, n, (unsigned long) svg->len);
+
+    timer = g_timer_new ();
+
+    /* a new handle every time, so nothing but the library's shared state
+       carries over from one render to the next */
+    for (j = 0; j < count; j++) {
+        RsvgHandle *handle;
+        GdkPixbuf *pixbuf;
+
+        g_timer_start (timer);
+        handle = rsvg_handle_new_from_data ((const guint8 *) svg->str, svg->len, NULL);
+        load += g_timer_elapsed (timer, NULL);
+        if (handle == NULL) {
+            g_print ("Could not load the generated document\n");
+            return 1;
+        }
+
+        g_timer_start (timer);
+        pixbuf = rsvg_handle_get_pixbuf (handle);
+        render += g_timer_elapsed (timer, NULL);
+
+        g_object_unref (pixbuf);
+        g_object_unref (handle);
+    }
+
+    fprintf (stdout, "Loading took %g(s), %g(us) per element\n", load / count, load / count / n * 1e6);
+    fprintf (stdout, "Rendering took %g(s), %g(us) per element\n", render / count, render / count / n * 1e6);
+    /* the render time includes drawing the elements, so this is a lower
+       bound on the rate of the code being measured */
+    if (bytes)
+        fprintf (stdout, "Wrote %g(MB) per render, %g(MB/s)\n", bytes / 1e6, bytes / 1e6 / (render / count));
+
+    g_timer_destroy (timer);
+    g_string_free (svg, TRUE);
+
+    return 0;
+}
+
 int
 main (int argc, char **argv)
 {
@@ -45,6 +254,10 @@ main (int argc, char **argv)
     int width = -1;
     int height = -1;
     int bVersion = 0;
+    char *generate = NULL;
+    int n_elements = 10000;
+    int bScaling = 0;
+    int status;
 
     char **args;
     gint n_args = 0;
@@ -57,6 +270,9 @@ main (int argc, char **argv)
         {"width", 'w', 0, G_OPTION_ARG_INT, &width, "width", "<int>"},
         {"height", 'h', 0, G_OPTION_ARG_INT, &height, "height", "<int>"},
         {"count", 'c', 0, G_OPTION_ARG_INT, &count, "number of times to render the SVG", "<int>"},
+        {"generate", 'g', 0, G_OPTION_ARG_STRING, &generate, "time a generated document instead of a file", "[labels|filters|map|styled]"},
+        {"elements", 'n', 0, G_OPTION_ARG_INT, &n_elements, "number of elements in the generated document [default 10000]", "<int>"},
+        {"scaling", 's', 0, G_OPTION_ARG_NONE, &bScaling, "time the generated document at an eighth, a quarter, half and all of the elements", NULL},
         {"version", 'v', 0, G_OPTION_ARG_NONE, &bVersion, "show version information", NULL},
         {G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &args, NULL, N_("[FILE...]")},
         {NULL}
@@ -76,6 +292,17 @@ main (int argc, char **argv)
         return 0;
     }
 
+    if (generate) {
+        rsvg_init ();
+        /* with --scaling the per element times should stay flat as the
+           document grows */
+        status = 0;
+        for (i = bScaling ? 8 : 1; i >= 1 && status == 0; i /= 2)
+            status = time_generated (generate, MAX (n_elements / i, 1), MAX (count, 1));
+        rsvg_term ();
+        return status;
+    }
+
     if (args)
         while (args[n_args] != NULL)
             n_args++;
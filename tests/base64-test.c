@@ -0,0 +1,118 @@
+/* vim: set sw=4 sts=4: -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 8 -*-
+ *
+ * base64-test - Checks loading images from base64 data: URIs
+ *
+ * A small PNG is loaded from a data: URI as it is, broken over lines and
+ * without its padding, and malformed payloads must fail with an
+ * RSVG_ERROR rather than silently.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "rsvg-private.h"
+#include "rsvg-image.h"
+
+/* a 2x3 RGB PNG */
+#define PNG_PREFIX "data:image/png;base64,"
+#define PNG_DATA "iVBORw0KGgoAAAANSUhEUgAAAAIAAAADCAIAAAA2iEnWAAAAEUlEQVR4nGP4z8AARGACTgMAPtYF+1iCz0YAAAAASUVORK5CYII="
+
+static guint failures = 0;
+
+static void
+check_valid (const char *what, const char *href)
+{
+    GError *error = NULL;
+    GdkPixbuf *pixbuf;
+
+    pixbuf = rsvg_pixbuf_new_from_href (href, NULL, &error);
+    if (pixbuf == NULL) {
+        fprintf (stderr, "%s: not loaded: %s\n", what, error ? error->message : "no error set");
+        failures++;
+    } else if (gdk_pixbuf_get_width (pixbuf) != 2 || gdk_pixbuf_get_height (pixbuf) != 3) {
+        fprintf (stderr, "%s: loaded as %dx%d, expected 2x3\n", what,
+                 gdk_pixbuf_get_width (pixbuf), gdk_pixbuf_get_height (pixbuf));
+        failures++;
+    }
+
+    if (pixbuf)
+        g_object_unref (pixbuf);
+    if (error)
+        g_error_free (error);
+}
+
+static void
+check_invalid (const char *what, const char *href)
+{
+    GError *error = NULL;
+    GdkPixbuf *pixbuf;
+
+    pixbuf = rsvg_pixbuf_new_from_href (href, NULL, &error);
+    if (pixbuf != NULL) {
+        fprintf (stderr, "%s: loaded, expected an error\n", what);
+        failures++;
+        g_object_unref (pixbuf);
+    } else if (error == NULL) {
+        fprintf (stderr, "%s: failed without setting an error\n", what);
+        failures++;
+    } else if (error->domain != RSVG_ERROR) {
+        fprintf (stderr, "%s: failed with \"%s\", expected an RSVG_ERROR\n", what,
+                 error->message);
+        failures++;
+    }
+
+    if (error)
+        g_error_free (error);
+}
+
+int
+main (int argc, char **argv)
+{
+    GString *str;
+    gchar *href;
+    guint i;
+
+    g_type_init ();
+
+    check_valid ("plain", PNG_PREFIX PNG_DATA);
+
+    /* line breaks inside the payload, and the final quantum unpadded */
+    str = g_string_new (PNG_PREFIX);
+    for (i = 0; PNG_DATA[i] && PNG_DATA[i] != '='; i++) {
+        if (i && i % 20 == 0)
+            g_string_append (str, "\n  ");
+        g_string_append_c (str, PNG_DATA[i]);
+    }
+    check_valid ("wrapped and unpadded", str->str);
+    g_string_free (str, TRUE);
+
+    check_invalid ("bad character", PNG_PREFIX "iVBO*Rw0KGgo");
+    check_invalid ("padding first", PNG_PREFIX "====");
+    check_invalid ("padding after one character", PNG_PREFIX "i===");
+
+    /* the payload is decoded in 64k chunks; a bad character well past the
+       first one must still be reported */
+    str = g_string_new (PNG_PREFIX "iVBO");
+    for (i = 0; i < 100000; i++)
+        g_string_append_c (str, ' ');
+    g_string_append (str, "Rw0K#Ggo");
+    href = g_string_free (str, FALSE);
+    check_invalid ("bad character in a later chunk", href);
+    g_free (href);
+
+    printf ("%u base64 checks failed\n", failures);
+
+    return failures ? 1 : 0;
+}
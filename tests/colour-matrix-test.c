@@ -0,0 +1,195 @@
+/* vim: set sw=4 sts=4: -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 8 -*-
+ *
+ * colour-matrix-test - Checks the feColorMatrix pixel arithmetic
+ *
+ * The filter divides the colour terms by alpha through a per-alpha
+ * reciprocal.  This checks known outputs for the shorthand matrices and
+ * the quotient the reciprocal gives for every alpha value.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "rsvg-private.h"
+#include "rsvg-filter.h"
+
+typedef struct {
+    const char *name;
+    gint kernel[20];
+} ColourMatrix;
+
+/* Kernels as the filter stores them, in units of 1/255 */
+static const ColourMatrix identity = { "identity", {
+    255, 0, 0, 0, 0,
+    0, 255, 0, 0, 0,
+    0, 0, 255, 0, 0,
+    0, 0, 0, 255, 0}
+};
+
+static const ColourMatrix saturate_0 = { "saturate 0", {
+    54, 182, 18, 0, 0,
+    54, 182, 18, 0, 0,
+    54, 182, 18, 0, 0,
+    0, 0, 0, 255, 0}
+};
+
+static const ColourMatrix hue_rotate_180 = { "hueRotate 180", {
+    -146, 364, 36, 0, 0,
+    108, 109, 36, 0, 0,
+    108, 364, -218, 0, 0,
+    0, 0, 0, 255, 0}
+};
+
+static const ColourMatrix luminance_to_alpha = { "luminanceToAlpha", {
+    0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0,
+    54, 182, 18, 0, 0}
+};
+
+static const ColourMatrix offsets = { "offsets", {
+    128, -64, 32, 255, 40,
+    -255, 510, 0, -128, -20,
+    0, 0, 0, 0, 300,
+    64, 64, 64, 128, 16}
+};
+
+/* The largest coefficients the reciprocal is exact for */
+static const ColourMatrix extremes = { "extremes", {
+    65535, -65535, 65535, -65535, 0,
+    -65535, 65535, -65535, 65535, 255,
+    65535, 65535, 65535, 65535, -255,
+    0, 0, 0, 0, 255}
+};
+
+/* Too large for the reciprocal, these take the division path */
+static const ColourMatrix large = { "large", {
+    1 << 20, 0, 0, 0, 0,
+    0, -(1 << 20), 0, 0, 255,
+    0, 0, 255, 0, 0,
+    0, 0, 0, 255, 0}
+};
+
+typedef struct {
+    const ColourMatrix *matrix;
+    guchar in[4];
+    guchar out[4];
+} ColourMatrixCase;
+
+/* Premultiplied RGBA in and out.  The colour terms are divided by the
+   input alpha, the alpha term by 255, and the results are truncated,
+   clamped and premultiplied by the new alpha. */
+static const ColourMatrixCase cases[] = {
+    {&identity, {10, 200, 255, 255}, {10, 200, 255, 255}},
+    {&identity, {100, 50, 20, 200}, {99, 49, 19, 200}},
+    {&identity, {1, 1, 1, 1}, {1, 1, 1, 1}},
+    {&identity, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    {&saturate_0, {255, 0, 0, 255}, {54, 54, 54, 255}},
+    {&saturate_0, {60, 120, 30, 128}, {99, 99, 99, 128}},
+    {&hue_rotate_180, {255, 0, 0, 255}, {0, 108, 108, 255}},
+    {&luminance_to_alpha, {255, 255, 255, 255}, {0, 0, 0, 254}},
+    {&luminance_to_alpha, {0, 128, 0, 128}, {0, 0, 0, 182}},
+    {&luminance_to_alpha, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    {&offsets, {0, 0, 0, 0}, {2, 0, 16, 16}},
+    {&offsets, {30, 60, 90, 90}, {119, 140, 188, 188}},
+    {&extremes, {1, 2, 3, 3}, {255, 0, 255, 255}},
+    {&extremes, {0, 1, 0, 254}, {0, 255, 255, 255}},
+    {&large, {1, 1, 0, 255}, {255, 0, 0, 255}},
+    {&large, {0, 3, 7, 200}, {0, 0, 6, 200}},
+};
+
+static gboolean
+check_case (const ColourMatrixCase * c)
+{
+    guchar got[4];
+
+    _rsvg_filter_colour_matrix_pixel (c->matrix->kernel, c->in, got);
+    if (memcmp (c->out, got, 4)) {
+        fprintf (stderr, "%s: pixel %d,%d,%d,%d gives %d,%d,%d,%d, expected %d,%d,%d,%d\n",
+                 c->matrix->name, c->in[0], c->in[1], c->in[2], c->in[3],
+                 got[0], got[1], got[2], got[3], c->out[0], c->out[1], c->out[2], c->out[3]);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* With only red and green terms and green equal to red, red out is
+   r * red / alpha + g * red / alpha, each quotient truncated, then clamped
+   and premultiplied again.  Going through every alpha and every
+   premultiplied red catches any quotient the reciprocal gets wrong; pairs
+   that nearly cancel show errors that a single large term would clamp
+   away. */
+static gboolean
+check_terms (gint r, gint g)
+{
+    gint kernel[20];
+    guchar in[4], out[4];
+    gint alpha, red, expected;
+
+    memset (kernel, 0, sizeof (kernel));
+    kernel[0] = r;
+    kernel[1] = g;
+    kernel[18] = 255;
+
+    in[2] = 0;
+    for (alpha = 1; alpha < 256; alpha++)
+        for (red = 0; red <= alpha; red++) {
+            in[0] = in[1] = red;
+            in[3] = alpha;
+            _rsvg_filter_colour_matrix_pixel (kernel, in, out);
+
+            expected = r * red / alpha + g * red / alpha;
+            if (expected > 255)
+                expected = 255;
+            if (expected < 0)
+                expected = 0;
+            expected = expected * alpha / 255;
+
+            if (out[0] != expected || out[1] || out[2] || out[3] != alpha) {
+                fprintf (stderr, "red * %d + green * %d: pixel %d,%d,0,%d gives %d,%d,%d,%d, "
+                         "expected %d,0,0,%d\n", r, g, red, red, alpha,
+                         out[0], out[1], out[2], out[3], expected, alpha);
+                return FALSE;
+            }
+        }
+
+    return TRUE;
+}
+
+int
+main (int argc, char **argv)
+{
+    static const gint terms[][2] = {
+        {1, 0}, {254, 0}, {255, 0}, {256, 0}, {257, 0}, {1000, 0}, {32767, 0},
+        {65535, 0}, {-1, 0}, {-255, 0}, {-65535, 0},
+        {65535, -65280}, {65535, -65535}, {-65535, 65534},
+        {65536 + 255, -65536}, {(1 << 20) + 255, -(1 << 20)}, {1 << 20, 0}
+    };
+    guint i, failed = 0, total = 0;
+
+    g_type_init ();
+
+    for (i = 0; i < G_N_ELEMENTS (cases); i++, total++)
+        if (!check_case (&cases[i]))
+            failed++;
+
+    for (i = 0; i < G_N_ELEMENTS (terms); i++, total++)
+        if (!check_terms (terms[i][0], terms[i][1]))
+            failed++;
+
+    printf ("%u of %u colour matrix checks failed\n", failed, total);
+
+    return failed ? 1 : 0;
+}
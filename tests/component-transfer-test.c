@@ -0,0 +1,160 @@
+/* vim: set sw=4 sts=4: -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 8 -*-
+ *
+ * component-transfer-test - Checks the feComponentTransfer lookup tables
+ *
+ * The render loop looks every channel up in a 256 entry table built from
+ * the feFuncX node.  This checks those tables at the end points and knots
+ * of each transfer function against known outputs.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "rsvg-private.h"
+#include "rsvg-filter.h"
+#include "rsvg-structure.h"
+
+#define MAX_POINTS 8
+
+typedef struct {
+    guchar in, out;
+} TransferPoint;
+
+/* The filter stores every parameter as a whole number of 1/255ths,
+   truncated, so 0.25 is 63, 0.5 is 127, 0.7 is 178 and so on.  The
+   expected outputs below follow from that and the formulas in the spec,
+   with the result truncated and clamped to 0..255. */
+typedef struct {
+    const char *atts[11];
+    gboolean identity;
+    TransferPoint points[MAX_POINTS];
+} TransferCase;
+
+static const TransferCase cases[] = {
+    {{"type", "identity", NULL}, TRUE,
+     {{0, 0}, {1, 1}, {128, 128}, {254, 254}, {255, 255}}},
+
+    /* An empty table leaves the channel alone */
+    {{"type", "table", NULL}, TRUE,
+     {{0, 0}, {128, 128}, {255, 255}}},
+    {{"type", "table", "tableValues", "0 1", NULL}, TRUE,
+     {{0, 0}, {100, 100}, {255, 255}}},
+    {{"type", "table", "tableValues", "1 0", NULL}, FALSE,
+     {{0, 255}, {51, 204}, {128, 127}, {255, 0}}},
+    {{"type", "table", "tableValues", "0.5", NULL}, FALSE,
+     {{0, 127}, {128, 127}, {255, 127}}},
+    /* Knots at 0, 85, 170 and 255, and 17 is a fifth of the first span */
+    {{"type", "table", "tableValues", "0 1 0 1", NULL}, FALSE,
+     {{0, 0}, {17, 51}, {85, 255}, {170, 0}, {255, 255}}},
+    {{"type", "table", "tableValues", "-0.5 1.5 0.25 0.75", NULL}, FALSE,
+     {{0, 0}, {85, 255}, {170, 63}, {255, 191}}},
+
+    /* n values split the input into n equal steps, 255 in the last one */
+    {{"type", "discrete", "tableValues", "0 0.5 1", NULL}, FALSE,
+     {{0, 0}, {84, 0}, {85, 127}, {169, 127}, {170, 255}, {255, 255}}},
+    {{"type", "discrete", "tableValues", "0.7", NULL}, FALSE,
+     {{0, 178}, {128, 178}, {255, 178}}},
+    {{"type", "discrete", "tableValues", "1 0", NULL}, FALSE,
+     {{0, 255}, {127, 255}, {128, 0}, {255, 0}}},
+
+    {{"type", "linear", "slope", "1", "intercept", "0", NULL}, TRUE,
+     {{0, 0}, {128, 128}, {255, 255}}},
+    {{"type", "linear", "slope", "-1", "intercept", "1", NULL}, FALSE,
+     {{0, 255}, {1, 254}, {128, 127}, {255, 0}}},
+    {{"type", "linear", "slope", "0.5", "intercept", "0.25", NULL}, FALSE,
+     {{0, 63}, {128, 126}, {255, 190}}},
+    {{"type", "linear", "slope", "2", "intercept", "-0.5", NULL}, FALSE,
+     {{0, 0}, {63, 0}, {64, 1}, {191, 255}, {255, 255}}},
+
+    /* Whole exponents are evaluated in fixed point, others with pow() */
+    {{"type", "gamma", "amplitude", "1", "exponent", "1", "offset", "0", NULL}, TRUE,
+     {{0, 0}, {128, 128}, {255, 255}}},
+    {{"type", "gamma", "amplitude", "1", "exponent", "2", "offset", "0", NULL}, FALSE,
+     {{0, 0}, {16, 1}, {128, 64}, {255, 255}}},
+    {{"type", "gamma", "amplitude", "0.8", "exponent", "3", "offset", "0.1", NULL}, FALSE,
+     {{0, 25}, {128, 50}, {255, 229}}},
+    {{"type", "gamma", "amplitude", "1", "exponent", "0.45", "offset", "0", NULL}, FALSE,
+     {{0, 0}, {1, 21}, {64, 136}, {128, 186}, {255, 255}}},
+    {{"type", "gamma", "amplitude", "2", "exponent", "2.2", "offset", "-0.5", NULL}, FALSE,
+     {{0, 0}, {128, 0}, {200, 171}, {255, 255}}},
+    /* x^0 is 1 everywhere, 0 included */
+    {{"type", "gamma", "amplitude", "1", "exponent", "0", "offset", "0", NULL}, FALSE,
+     {{0, 255}, {128, 255}, {255, 255}}},
+};
+
+static void
+print_case (const TransferCase * tc)
+{
+    guint i;
+
+    for (i = 0; tc->atts[i]; i += 2)
+        fprintf (stderr, "%s%s=\"%s\"", i ? " " : "", tc->atts[i], tc->atts[i + 1]);
+}
+
+static gboolean
+check_case (const TransferCase * tc)
+{
+    RsvgPropertyBag *bag;
+    RsvgNode *node;
+    guchar lut[256];
+    gboolean identity, ok;
+    guint i;
+
+    /* no arena, so the node is on the heap and freed by its own free */
+    node = rsvg_new_node_component_transfer_function (NULL, 'r');
+    bag = rsvg_property_bag_new ((const char **) tc->atts);
+    node->set_atts (node, NULL, bag);
+    rsvg_property_bag_free (bag);
+
+    identity = _rsvg_filter_component_transfer_lut (node, lut);
+
+    ok = TRUE;
+    for (i = 0; i < MAX_POINTS; i++) {
+        const TransferPoint *p = &tc->points[i];
+
+        if (i && !p->in)
+            break;
+        if (lut[p->in] != p->out) {
+            print_case (tc);
+            fprintf (stderr, ": input %d gives %d, expected %d\n", p->in, lut[p->in], p->out);
+            ok = FALSE;
+        }
+    }
+    if (identity != tc->identity) {
+        print_case (tc);
+        fprintf (stderr, ": identity reported as %d, expected %d\n", identity, tc->identity);
+        ok = FALSE;
+    }
+
+    node->free (node);
+    return ok;
+}
+
+int
+main (int argc, char **argv)
+{
+    guint i, failed = 0;
+
+    g_type_init ();
+
+    for (i = 0; i < G_N_ELEMENTS (cases); i++)
+        if (!check_case (&cases[i]))
+            failed++;
+
+    printf ("%u of %u component transfer cases failed\n", failed,
+            (guint) G_N_ELEMENTS (cases));
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,473 @@
+/* vim: set sw=4 sts=4: -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 8 -*-
+ *
+ * css-test - Checks the CSS number and colour parsers
+ *
+ * _rsvg_css_strtod is checked against known values around the edges of
+ * its fast path and against g_ascii_strtod on random numbers.  Colours are
+ * checked against the keyword values in the CSS3 color module and against
+ * hand worked results for the #rgb, #rrggbb and rgb() forms.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "rsvg-private.h"
+#include "rsvg-css.h"
+
+#define N_RANDOM_NUMBERS 200000
+
+static guint failures = 0;
+
+#define FAIL(...) G_STMT_START { fprintf (stderr, __VA_ARGS__); failures++; } G_STMT_END
+
+#define PACK_RGB(r,g,b) (((r) << 16) | ((g) << 8) | (b))
+
+/* Numbers */
+
+typedef struct {
+    const char *str;
+    double value;
+    gint length;
+} NumberCase;
+
+/* The fast path takes up to 19 significant digits as long as they fit in
+   53 bits, and decimal exponents up to 22 either way; the cases from
+   9007199254740992 on sit just inside or just outside those limits. */
+static const NumberCase number_cases[] = {
+    {"0", 0., 1},
+    {"-0", -0., 2},
+    {"+1", 1., 2},
+    {"-1", -1., 2},
+    {"007", 7., 3},
+    {".5", .5, 2},
+    {"-.5", -.5, 3},
+    {"+.25", .25, 4},
+    {"5.", 5., 2},
+    {"0.1", 0.1, 3},
+    {"3.14159", 3.14159, 7},
+    {"1e5", 1e5, 3},
+    {"1E-3", 1e-3, 4},
+    {"1e+3", 1e3, 4},
+    {"2.5e3px", 2500., 5},
+    {"-1.5E-2", -0.015, 7},
+    {"0e999", 0., 5},
+
+    /* an exponent without digits is not part of the number */
+    {"1e", 1., 1},
+    {"1e+", 1., 1},
+    {"1E-", 1., 1},
+    {"1ex", 1., 1},
+    {"1,2", 1., 1},
+
+    /* leading space is skipped, but there must be a digit */
+    {" 3", 3., 2},
+    {"\t-7.25", -7.25, 6},
+    {".", 0., 0},
+    {"-", 0., 0},
+    {"+", 0., 0},
+    {"", 0., 0},
+    {"e5", 0., 0},
+    {"-.e1", 0., 0},
+
+    {"9007199254740992", 9007199254740992., 16},
+    {"9007199254740993", 9007199254740992., 16},
+    {"1234567890123456789", 1234567890123456789., 19},
+    {"12345678901234567890123", 12345678901234567890123., 23},
+    {"1.00000000000000000000001", 1., 25},
+    {"1e22", 1e22, 4},
+    {"1e23", 1e23, 4},
+    {"1e-22", 1e-22, 5},
+    {"1e-23", 1e-23, 5},
+    {"0.000000000000000000000000001", 1e-27, 29},
+    {"4.9e-324", 4.9e-324, 8},
+    {"1.7976931348623157e308", 1.7976931348623157e308, 22},
+    {"1e400", HUGE_VAL, 5},
+    {"1e-400", 0., 6},
+    {"1e99999", HUGE_VAL, 7},
+    {"0x10", 16., 4}
+};
+
+static void
+check_number_cases (void)
+{
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (number_cases); i++) {
+        const NumberCase *nc = &number_cases[i];
+        char *end;
+        double value;
+
+        value = _rsvg_css_strtod (nc->str, &end);
+        if (end - nc->str != nc->length)
+            FAIL ("strtod \"%s\": stopped after %d characters, expected %d\n", nc->str,
+                  (int) (end - nc->str), nc->length);
+        /* compared bit for bit, so that -0 is told from 0 */
+        else if (memcmp (&value, &nc->value, sizeof (double)))
+            FAIL ("strtod \"%s\": gives %.17g, expected %.17g\n", nc->str, value, nc->value);
+    }
+}
+
+static void
+check_strtod (const char *str)
+{
+    char *end, *expected_end;
+    double value, expected;
+
+    expected = g_ascii_strtod (str, &expected_end);
+    value = _rsvg_css_strtod (str, &end);
+
+    if (end != expected_end)
+        FAIL ("strtod \"%s\": stopped after %d characters, expected %d\n", str,
+              (int) (end - str), (int) (expected_end - str));
+    else if (isnan (expected) ? !isnan (value) : memcmp (&value, &expected, sizeof (double)))
+        FAIL ("strtod \"%s\": gives %.17g, expected %.17g\n", str, value, expected);
+}
+
+static void
+append_digits (GString * str, GRand * rand, gint max)
+{
+    gint i, n = g_rand_int_range (rand, 0, max + 1);
+
+    /* leading zeros now and then, which don't count towards the digits */
+    if (g_rand_int_range (rand, 0, 8) == 0)
+        g_string_append (str, "000");
+    for (i = 0; i < n; i++)
+        g_string_append_c (str, '0' + g_rand_int_range (rand, 0, 10));
+}
+
+/* Something shaped like a number most of the time, with the odd piece
+   missing or out of place */
+static void
+random_number (GString * str, GRand * rand)
+{
+    static const char junk[] = " ,.eE+-x0123456789aifnp";
+
+    g_string_truncate (str, 0);
+
+    if (g_rand_int_range (rand, 0, 10) == 0) {
+        gint i, n = g_rand_int_range (rand, 1, 8);
+        for (i = 0; i < n; i++)
+            g_string_append_c (str, junk[g_rand_int_range (rand, 0, sizeof (junk) - 1)]);
+        return;
+    }
+
+    if (g_rand_int_range (rand, 0, 8) == 0)
+        g_string_append (str, "  ");
+    switch (g_rand_int_range (rand, 0, 4)) {
+    case 0:
+        g_string_append_c (str, '-');
+        break;
+    case 1:
+        g_string_append_c (str, '+');
+        break;
+    }
+    append_digits (str, rand, g_rand_int_range (rand, 0, 4) ? 8 : 25);
+    if (g_rand_int_range (rand, 0, 2)) {
+        g_string_append_c (str, '.');
+        append_digits (str, rand, g_rand_int_range (rand, 0, 4) ? 8 : 25);
+    }
+    if (g_rand_int_range (rand, 0, 3) == 0) {
+        g_string_append_c (str, g_rand_boolean (rand) ? 'e' : 'E');
+        switch (g_rand_int_range (rand, 0, 3)) {
+        case 0:
+            g_string_append_c (str, '-');
+            break;
+        case 1:
+            g_string_append_c (str, '+');
+            break;
+        }
+        append_digits (str, rand, 3);
+    }
+    if (g_rand_boolean (rand))
+        g_string_append_c (str, junk[g_rand_int_range (rand, 0, sizeof (junk) - 1)]);
+}
+
+static void
+check_random_numbers (GRand * rand)
+{
+    GString *str = g_string_new (NULL);
+    guint i;
+
+    for (i = 0; i < N_RANDOM_NUMBERS; i++) {
+        random_number (str, rand);
+        check_strtod (str->str);
+    }
+
+    g_string_free (str, TRUE);
+}
+
+/* Colours */
+
+static void
+check_colour (const char *str, guint32 expected, gboolean expected_inherit)
+{
+    gboolean inherit;
+    guint32 rgb;
+
+    rgb = rsvg_css_parse_color (str, &inherit);
+    if (rgb != expected || inherit != expected_inherit)
+        FAIL ("colour \"%s\": gives %06x (inherit %d), expected %06x (inherit %d)\n",
+              str, rgb, inherit, expected, expected_inherit);
+}
+
+typedef struct {
+    const char *name;
+    guint8 r, g, b;
+} KeywordCase;
+
+/* The 147 keywords of the CSS3 color module, which are also SVG's */
+static const KeywordCase keyword_cases[] = {
+    {"aliceblue", 240, 248, 255},
+    {"antiquewhite", 250, 235, 215},
+    {"aqua", 0, 255, 255},
+    {"aquamarine", 127, 255, 212},
+    {"azure", 240, 255, 255},
+    {"beige", 245, 245, 220},
+    {"bisque", 255, 228, 196},
+    {"black", 0, 0, 0},
+    {"blanchedalmond", 255, 235, 205},
+    {"blue", 0, 0, 255},
+    {"blueviolet", 138, 43, 226},
+    {"brown", 165, 42, 42},
+    {"burlywood", 222, 184, 135},
+    {"cadetblue", 95, 158, 160},
+    {"chartreuse", 127, 255, 0},
+    {"chocolate", 210, 105, 30},
+    {"coral", 255, 127, 80},
+    {"cornflowerblue", 100, 149, 237},
+    {"cornsilk", 255, 248, 220},
+    {"crimson", 220, 20, 60},
+    {"cyan", 0, 255, 255},
+    {"darkblue", 0, 0, 139},
+    {"darkcyan", 0, 139, 139},
+    {"darkgoldenrod", 184, 134, 11},
+    {"darkgray", 169, 169, 169},
+    {"darkgreen", 0, 100, 0},
+    {"darkgrey", 169, 169, 169},
+    {"darkkhaki", 189, 183, 107},
+    {"darkmagenta", 139, 0, 139},
+    {"darkolivegreen", 85, 107, 47},
+    {"darkorange", 255, 140, 0},
+    {"darkorchid", 153, 50, 204},
+    {"darkred", 139, 0, 0},
+    {"darksalmon", 233, 150, 122},
+    {"darkseagreen", 143, 188, 143},
+    {"darkslateblue", 72, 61, 139},
+    {"darkslategray", 47, 79, 79},
+    {"darkslategrey", 47, 79, 79},
+    {"darkturquoise", 0, 206, 209},
+    {"darkviolet", 148, 0, 211},
+    {"deeppink", 255, 20, 147},
+    {"deepskyblue", 0, 191, 255},
+    {"dimgray", 105, 105, 105},
+    {"dimgrey", 105, 105, 105},
+    {"dodgerblue", 30, 144, 255},
+    {"firebrick", 178, 34, 34},
+    {"floralwhite", 255, 250, 240},
+    {"forestgreen", 34, 139, 34},
+    {"fuchsia", 255, 0, 255},
+    {"gainsboro", 220, 220, 220},
+    {"ghostwhite", 248, 248, 255},
+    {"gold", 255, 215, 0},
+    {"goldenrod", 218, 165, 32},
+    {"gray", 128, 128, 128},
+    {"green", 0, 128, 0},
+    {"greenyellow", 173, 255, 47},
+    {"grey", 128, 128, 128},
+    {"honeydew", 240, 255, 240},
+    {"hotpink", 255, 105, 180},
+    {"indianred", 205, 92, 92},
+    {"indigo", 75, 0, 130},
+    {"ivory", 255, 255, 240},
+    {"khaki", 240, 230, 140},
+    {"lavender", 230, 230, 250},
+    {"lavenderblush", 255, 240, 245},
+    {"lawngreen", 124, 252, 0},
+    {"lemonchiffon", 255, 250, 205},
+    {"lightblue", 173, 216, 230},
+    {"lightcoral", 240, 128, 128},
+    {"lightcyan", 224, 255, 255},
+    {"lightgoldenrodyellow", 250, 250, 210},
+    {"lightgray", 211, 211, 211},
+    {"lightgreen", 144, 238, 144},
+    {"lightgrey", 211, 211, 211},
+    {"lightpink", 255, 182, 193},
+    {"lightsalmon", 255, 160, 122},
+    {"lightseagreen", 32, 178, 170},
+    {"lightskyblue", 135, 206, 250},
+    {"lightslategray", 119, 136, 153},
+    {"lightslategrey", 119, 136, 153},
+    {"lightsteelblue", 176, 196, 222},
+    {"lightyellow", 255, 255, 224},
+    {"lime", 0, 255, 0},
+    {"limegreen", 50, 205, 50},
+    {"linen", 250, 240, 230},
+    {"magenta", 255, 0, 255},
+    {"maroon", 128, 0, 0},
+    {"mediumaquamarine", 102, 205, 170},
+    {"mediumblue", 0, 0, 205},
+    {"mediumorchid", 186, 85, 211},
+    {"mediumpurple", 147, 112, 219},
+    {"mediumseagreen", 60, 179, 113},
+    {"mediumslateblue", 123, 104, 238},
+    {"mediumspringgreen", 0, 250, 154},
+    {"mediumturquoise", 72, 209, 204},
+    {"mediumvioletred", 199, 21, 133},
+    {"midnightblue", 25, 25, 112},
+    {"mintcream", 245, 255, 250},
+    {"mistyrose", 255, 228, 225},
+    {"moccasin", 255, 228, 181},
+    {"navajowhite", 255, 222, 173},
+    {"navy", 0, 0, 128},
+    {"oldlace", 253, 245, 230},
+    {"olive", 128, 128, 0},
+    {"olivedrab", 107, 142, 35},
+    {"orange", 255, 165, 0},
+    {"orangered", 255, 69, 0},
+    {"orchid", 218, 112, 214},
+    {"palegoldenrod", 238, 232, 170},
+    {"palegreen", 152, 251, 152},
+    {"paleturquoise", 175, 238, 238},
+    {"palevioletred", 219, 112, 147},
+    {"papayawhip", 255, 239, 213},
+    {"peachpuff", 255, 218, 185},
+    {"peru", 205, 133, 63},
+    {"pink", 255, 192, 203},
+    {"plum", 221, 160, 221},
+    {"powderblue", 176, 224, 230},
+    {"purple", 128, 0, 128},
+    {"red", 255, 0, 0},
+    {"rosybrown", 188, 143, 143},
+    {"royalblue", 65, 105, 225},
+    {"saddlebrown", 139, 69, 19},
+    {"salmon", 250, 128, 114},
+    {"sandybrown", 244, 164, 96},
+    {"seagreen", 46, 139, 87},
+    {"seashell", 255, 245, 238},
+    {"sienna", 160, 82, 45},
+    {"silver", 192, 192, 192},
+    {"skyblue", 135, 206, 235},
+    {"slateblue", 106, 90, 205},
+    {"slategray", 112, 128, 144},
+    {"slategrey", 112, 128, 144},
+    {"snow", 255, 250, 250},
+    {"springgreen", 0, 255, 127},
+    {"steelblue", 70, 130, 180},
+    {"tan", 210, 180, 140},
+    {"teal", 0, 128, 128},
+    {"thistle", 216, 191, 216},
+    {"tomato", 255, 99, 71},
+    {"turquoise", 64, 224, 208},
+    {"violet", 238, 130, 238},
+    {"wheat", 245, 222, 179},
+    {"white", 255, 255, 255},
+    {"whitesmoke", 245, 245, 245},
+    {"yellow", 255, 255, 0},
+    {"yellowgreen", 154, 205, 50},
+};
+
+static void
+check_keywords (void)
+{
+    guint i, j;
+
+    for (i = 0; i < G_N_ELEMENTS (keyword_cases); i++) {
+        const KeywordCase *kc = &keyword_cases[i];
+        guint32 expected = PACK_RGB (kc->r, kc->g, kc->b);
+        gchar *variant;
+
+        check_colour (kc->name, expected, TRUE);
+
+        variant = g_ascii_strup (kc->name, -1);
+        check_colour (variant, expected, TRUE);
+
+        for (j = 0; variant[j]; j += 2)
+            variant[j] = g_ascii_tolower (variant[j]);
+        check_colour (variant, expected, TRUE);
+        g_free (variant);
+    }
+}
+
+/* Anything that is not exactly a keyword is black and clears inherit, as
+   does "inherit" itself */
+static const char *const unknown_names[] = {
+    "", "inherit", "re", "redd", "red ", " red", "red;", "bluex", "grey50",
+    "lightgoldenrodyellowx", "lightgoldenrodyellowlightgoldenrodyellow",
+    "transparent", "currentColor", "navy\tblue", "r\xc3\xa9" "d", "INHERIT"
+};
+
+typedef struct {
+    const char *str;
+    guint32 rgb;
+} ColourCase;
+
+/* Numeric components are clamped to 0..255 and truncated; percentages are
+   clamped and rounded, so 10% is 25.5 and becomes 26 */
+static const ColourCase colour_cases[] = {
+    {"#000", PACK_RGB (0, 0, 0)},
+    {"#f00", PACK_RGB (255, 0, 0)},
+    {"#abc", PACK_RGB (0xaa, 0xbb, 0xcc)},
+    {"#ABC", PACK_RGB (0xaa, 0xbb, 0xcc)},
+    {"#1a2B3c", PACK_RGB (0x1a, 0x2b, 0x3c)},
+    {"#ffffff", PACK_RGB (255, 255, 255)},
+    {"rgb(1,2,3)", PACK_RGB (1, 2, 3)},
+    {"rgb( 10 , 20 , 30 )", PACK_RGB (10, 20, 30)},
+    {"rgb (255, 128, 0)", PACK_RGB (255, 128, 0)},
+    {"rgb(300, -5, 256)", PACK_RGB (255, 0, 255)},
+    {"rgb(+7, 08, 9)", PACK_RGB (7, 8, 9)},
+    {"rgb(10%, 50%, 100%)", PACK_RGB (26, 128, 255)},
+    {"rgb(0%,0%,0%)", PACK_RGB (0, 0, 0)},
+    {"rgb(150%, -10%, 33.3%)", PACK_RGB (255, 0, 85)},
+    {"rgb(1.5, 2.7, 254.9)", PACK_RGB (1, 2, 254)},
+    {"rgb(0.5, 99.99, 255.5)", PACK_RGB (0, 99, 255)},
+    {"rgb(1e2, 2.5e1, 0)", PACK_RGB (100, 25, 0)},
+    {"rgb(.5e3, 1e-3, 12)", PACK_RGB (255, 0, 12)},
+    {"rgb(1, 2)", 0},
+    {"rgb(a, b, c)", 0},
+    {"rgb", 0}
+};
+
+static void
+check_colour_forms (void)
+{
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (unknown_names); i++)
+        check_colour (unknown_names[i], 0, FALSE);
+
+    for (i = 0; i < G_N_ELEMENTS (colour_cases); i++)
+        check_colour (colour_cases[i].str, colour_cases[i].rgb, TRUE);
+}
+
+int
+main (int argc, char **argv)
+{
+    GRand *rand;
+
+    g_type_init ();
+    rand = g_rand_new_with_seed (4242);
+
+    check_number_cases ();
+    check_random_numbers (rand);
+    check_keywords ();
+    check_colour_forms ();
+
+    g_rand_free (rand);
+
+    printf ("%u CSS parser checks failed\n", failures);
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,254 @@
+/* vim: set sw=4 sts=4: -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 8 -*-
+ *
+ * path-test - Checks the path data parser
+ *
+ * A few short paths are checked against the absolute segments they must
+ * give.  Then every d attribute in the test documents is parsed, written
+ * back out as absolute commands with %.17g, and parsed again; since each
+ * coordinate must be read correctly rounded, the second parse has to give
+ * exactly the same segments as the first.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <libxml/parser.h>
+#include <libxml/tree.h>
+
+#include "rsvg-private.h"
+#include "rsvg-path.h"
+
+static guint n_paths = 0, failures = 0;
+
+static void
+append_coord (GString * str, double x, double y)
+{
+    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+    g_string_append_c (str, ' ');
+    g_string_append (str, g_ascii_formatd (buf, sizeof (buf), "%.17g", x));
+    g_string_append_c (str, ' ');
+    g_string_append (str, g_ascii_formatd (buf, sizeof (buf), "%.17g", y));
+}
+
+/* Writes the segments out as absolute path data.  A closepath shows up as
+   a copy of its subpath's start with the code RSVG_MOVETO, and parsing
+   "Z" puts it back. */
+static gchar *
+serialize_path (const RsvgBpathDef * bpd)
+{
+    GString *str = g_string_new (NULL);
+    gint i;
+
+    for (i = 0; i < bpd->n_bpath; i++) {
+        const RsvgBpath *b = &bpd->bpath[i];
+
+        if (str->len)
+            g_string_append_c (str, ' ');
+
+        switch (b->code) {
+        case RSVG_MOVETO_OPEN:
+            g_string_append_c (str, 'M');
+            append_coord (str, b->x3, b->y3);
+            break;
+        case RSVG_MOVETO:
+            g_string_append_c (str, 'Z');
+            break;
+        case RSVG_LINETO:
+            g_string_append_c (str, 'L');
+            append_coord (str, b->x3, b->y3);
+            break;
+        case RSVG_CURVETO:
+            g_string_append_c (str, 'C');
+            append_coord (str, b->x1, b->y1);
+            append_coord (str, b->x2, b->y2);
+            append_coord (str, b->x3, b->y3);
+            break;
+        case RSVG_END:
+            break;
+        }
+    }
+
+    return g_string_free (str, FALSE);
+}
+
+/* Only the coordinates a segment uses are set; the rest are left over
+   from whatever the buffer held */
+static gboolean
+segments_equal (const RsvgBpath * a, const RsvgBpath * b)
+{
+    if (a->code != b->code || a->x3 != b->x3 || a->y3 != b->y3)
+        return FALSE;
+    if (a->code == RSVG_CURVETO)
+        return a->x1 == b->x1 && a->y1 == b->y1 && a->x2 == b->x2 && a->y2 == b->y2;
+    return TRUE;
+}
+
+typedef struct {
+    const char *d;
+    const char *expected;
+} PathCase;
+
+/* Relative and shorthand commands, implicit repeats, and numbers that run
+   into each other, all with results exact in binary */
+static const PathCase path_cases[] = {
+    {"M1 2L3 4", "M 1 2 L 3 4"},
+    {"m1 2l3 4", "M 1 2 L 4 6"},
+    {"M1 2 3 4 5 6", "M 1 2 L 3 4 L 5 6"},
+    {"m1 2 3 4", "M 1 2 L 4 6"},
+    {"M1 1M2 2L3 3", "M 2 2 L 3 3"},
+    {"M0,0h10v10h-10z", "M 0 0 L 10 0 L 10 10 L 0 10 Z"},
+    {"M1 1l1 0zl0 1", "M 1 1 L 2 1 Z L 1 2"},
+    {"M0 0C1 2 3 4 5 6S9 10 11 12", "M 0 0 C 1 2 3 4 5 6 C 7 8 9 10 11 12"},
+    {"M0 0c1 2 3 4 5 6s4 4 6 6", "M 0 0 C 1 2 3 4 5 6 C 7 8 9 10 11 12"},
+    {"M0 0L.5.5", "M 0 0 L 0.5 0.5"},
+    {"M1-.5", "M 1 -0.5"},
+    {"M-1 .5", "M -1 0.5"},
+    {"M.25 .75", "M 0.25 0.75"},
+    {"M1e2-3", "M 100 -3"},
+    {"M1.5e1,2E-1", "M 15 0.20000000000000001"},
+    {"M 1 2 L", "M 1 2"},
+    {"", ""}
+};
+
+static void
+check_path_cases (void)
+{
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (path_cases); i++) {
+        RsvgBpathDef *bpd = rsvg_parse_path (path_cases[i].d);
+        gchar *got = serialize_path (bpd);
+
+        if (strcmp (got, path_cases[i].expected)) {
+            fprintf (stderr, "\"%s\": gives \"%s\", expected \"%s\"\n",
+                     path_cases[i].d, got, path_cases[i].expected);
+            failures++;
+        }
+
+        g_free (got);
+        rsvg_bpath_def_free (bpd);
+    }
+}
+
+static void
+check_path (const char *file, const char *d)
+{
+    RsvgBpathDef *first, *second;
+    gchar *serialized;
+    gint i;
+
+    n_paths++;
+    first = rsvg_parse_path (d);
+    serialized = serialize_path (first);
+    second = rsvg_parse_path (serialized);
+
+    if (first->n_bpath != second->n_bpath) {
+        fprintf (stderr, "%s: \"%.60s\": %d segments, %d after a round trip\n", file, d,
+                 first->n_bpath, second->n_bpath);
+        failures++;
+        goto out;
+    }
+
+    for (i = 0; i < first->n_bpath; i++) {
+        const RsvgBpath *a = &first->bpath[i], *b = &second->bpath[i];
+
+        if (!segments_equal (a, b)) {
+            fprintf (stderr, "%s: \"%.60s\": segment %d is %d %.17g,%.17g "
+                     "and %d %.17g,%.17g after a round trip\n", file, d, i,
+                     a->code, a->x3, a->y3, b->code, b->x3, b->y3);
+            failures++;
+            break;
+        }
+    }
+
+  out:
+    g_free (serialized);
+    rsvg_bpath_def_free (first);
+    rsvg_bpath_def_free (second);
+}
+
+static void
+check_element (const char *file, xmlNode * node)
+{
+    for (; node != NULL; node = node->next) {
+        xmlChar *d;
+
+        if (node->type != XML_ELEMENT_NODE)
+            continue;
+
+        d = xmlGetProp (node, (const xmlChar *) "d");
+        if (d != NULL) {
+            check_path (file, (const char *) d);
+            xmlFree (d);
+        }
+
+        check_element (file, node->children);
+    }
+}
+
+static void
+check_file (const char *filename)
+{
+    xmlDoc *doc;
+
+    doc = xmlReadFile (filename, NULL, XML_PARSE_NONET | XML_PARSE_NOERROR | XML_PARSE_NOWARNING);
+    if (doc == NULL)
+        return;
+
+    check_element (filename, xmlDocGetRootElement (doc));
+    xmlFreeDoc (doc);
+}
+
+static void
+check_directory (const char *dirname)
+{
+    GDir *dir;
+    const char *name;
+
+    dir = g_dir_open (dirname, 0, NULL);
+    if (dir == NULL)
+        return;
+
+    while ((name = g_dir_read_name (dir)) != NULL) {
+        gchar *filename = g_build_filename (dirname, name, NULL);
+
+        if (g_file_test (filename, G_FILE_TEST_IS_DIR))
+            check_directory (filename);
+        else if (g_str_has_suffix (name, ".svg"))
+            check_file (filename);
+
+        g_free (filename);
+    }
+
+    g_dir_close (dir);
+}
+
+int
+main (int argc, char **argv)
+{
+    g_type_init ();
+    xmlInitParser ();
+
+    check_path_cases ();
+    check_directory (TEST_DATA_DIR);
+
+    xmlCleanupParser ();
+
+    printf ("%u of %u path checks failed\n", failures,
+            n_paths + (guint) G_N_ELEMENTS (path_cases));
+
+    return failures || !n_paths ? 1 : 0;
+}